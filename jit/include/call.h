@@ -8,9 +8,26 @@ ptrs_jit_var_t ptrs_jit_ncallnested(ptrs_ast_t *node, jit_function_t func, ptrs_
 	jit_value_t thisPtr, jit_function_t callee, size_t narg, ptrs_jit_var_t *args);
 ptrs_jit_var_t ptrs_jit_callnested(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
 	jit_value_t thisPtr, jit_function_t callee, struct ptrs_astlist *args);
+// emits `return callee(args)` as a tail call or a jump back to the start when callee == func
+// returns false without emitting anything if the current frame cannot be given up
+bool ptrs_jit_tailCallNested(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	jit_function_t callee, struct ptrs_astlist *args);
+
+void ptrs_jit_createFfiSignature(struct ptrs_ffideclaration *ffi);
+ptrs_jit_var_t ptrs_jit_callFfi(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	void *target, struct ptrs_ffideclaration *ffi, struct ptrs_astlist *args);
 
 void *ptrs_jit_function_to_closure(ptrs_ast_t *node, jit_function_t func);
 
+// binds a closure to a frame and returns a C function pointer calling it
+// scripts can import ptrs_callback_release to unbind it when C code no longer calls it
+void *ptrs_callback_acquire(void *closure, void *parentFrame);
+void ptrs_callback_release(void *callback);
+
+// calls a script function from C, argv holds pointers to the value and meta of each argument
+typedef ptrs_var_t (*ptrs_jit_invoker_t)(void *parentFrame, void *thisArg, int argc, void **argv);
+ptrs_jit_invoker_t ptrs_jit_getInvoker(jit_function_t func);
+
 void ptrs_jit_returnFromFunction(jit_function_t func, ptrs_scope_t *scope, ptrs_jit_var_t val);
 void ptrs_jit_returnPtrFromFunction(jit_function_t func, ptrs_scope_t *scope, jit_value_t addr);
 
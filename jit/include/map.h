@@ -0,0 +1,72 @@
+#ifndef _PTRS_MAP
+#define _PTRS_MAP
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <jit/jit.h>
+
+#include "../../parser/common.h"
+
+// entries are kept in insertion order, deleted entries have an undefined key until the map grows
+// the string of a deleted key is only freed then, so it stays valid for loops over the map
+typedef struct
+{
+	ptrs_var_t key;
+	ptrs_var_t value;
+	uint64_t hash;
+} ptrs_mapentry_t;
+
+typedef struct
+{
+	uint8_t *control; // one byte per slot, empty, deleted or the lowest 7 bits of the hash
+	uint32_t *slots; // index of the entry stored in each slot
+	ptrs_mapentry_t *entries;
+	uint32_t slotCount;
+	uint32_t entryCount; // including deleted entries
+	uint32_t entryCapacity;
+	uint32_t size;
+} ptrs_map_t;
+
+ptrs_map_t *ptrs_map_create(uint32_t capacity);
+void ptrs_map_free(ptrs_map_t *map);
+
+// keys are either ints or strings, strings are hashed up to their first zero byte
+uint64_t ptrs_map_hashKey(ptrs_ast_t *node, ptrs_val_t key, ptrs_meta_t keyMeta);
+
+ptrs_var_t ptrs_map_get(ptrs_ast_t *node, ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta);
+void ptrs_map_set(ptrs_ast_t *node, ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta,
+	ptrs_val_t val, ptrs_meta_t valMeta);
+bool ptrs_map_has(ptrs_ast_t *node, ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta);
+bool ptrs_map_delete(ptrs_ast_t *node, ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta);
+
+// the same using a hash computed by ptrs_map_hashKey, used for constant keys
+ptrs_var_t ptrs_map_getHashed(ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta, uint64_t hash);
+void ptrs_map_setHashed(ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta, uint64_t hash,
+	ptrs_val_t val, ptrs_meta_t valMeta);
+bool ptrs_map_hasHashed(ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta, uint64_t hash);
+bool ptrs_map_deleteHashed(ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta, uint64_t hash);
+
+// member access like map.key uses the name as a string key
+ptrs_var_t ptrs_map_getMember(ptrs_ast_t *node, ptrs_map_t *map, const char *key, uint32_t keyLen);
+void ptrs_map_setMember(ptrs_ast_t *node, ptrs_map_t *map, const char *key, uint32_t keyLen,
+	ptrs_val_t val, ptrs_meta_t valMeta);
+
+// yields the next entry at or after *pos, returns false after the last one
+// positions stay valid across deletes but not across inserts, which may rehash and compact the entries
+bool ptrs_map_next(ptrs_map_t *map, size_t *pos, ptrs_var_t *key, ptrs_var_t *value);
+
+ptrs_jit_var_t ptrs_jit_map_get(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t map, ptrs_jit_var_t key);
+void ptrs_jit_map_set(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t map, ptrs_jit_var_t key, ptrs_jit_var_t value);
+ptrs_jit_var_t ptrs_jit_map_has(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t map, ptrs_jit_var_t key);
+void ptrs_jit_map_delete(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t map, ptrs_jit_var_t key);
+
+ptrs_jit_var_t ptrs_jit_map_getMember(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t map, const char *key, uint32_t keyLen);
+void ptrs_jit_map_setMember(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t map, const char *key, uint32_t keyLen, ptrs_jit_var_t value);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef _PTRS_NATIVEINLINE
+#define _PTRS_NATIVEINLINE
+
+#include <stdbool.h>
+#include <jit/jit.h>
+
+#include "../../parser/common.h"
+#include "../../parser/ast.h"
+
+// emits well-known libc and libm functions as jit instructions instead of calling them
+// returns false without emitting anything if the call cannot be inlined
+bool ptrs_jit_inlineNativeCall(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_ast_t *symbol, ptrs_typing_t *typing, struct ptrs_astlist *args, ptrs_jit_var_t *ret);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef _PTRS_REPORT
+#define _PTRS_REPORT
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "../../parser/common.h"
+#include "../../parser/ast.h"
+
+extern bool ptrs_predictionReport;
+
+void ptrs_report_prediction(ptrs_function_t *function, ptrs_ast_t *node,
+	bool knownType, bool knownMeta, bool knownValue);
+void ptrs_report_fallback(jit_function_t func, ptrs_ast_t *node, const char *kind);
+void ptrs_report_print(FILE *out, const char *file);
+
+#endif
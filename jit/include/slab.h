@@ -0,0 +1,35 @@
+#ifndef _PTRS_SLAB
+#define _PTRS_SLAB
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <jit/jit.h>
+
+#include "../../parser/common.h"
+
+// instances of larger structs are allocated using malloc
+#define PTRS_SLAB_MAX_SIZE 1024
+
+extern bool ptrs_slabStats;
+
+bool ptrs_slab_isUsed(ptrs_struct_t *struc);
+
+// the ids are also used to refer to the element type of arrays of structs
+uint32_t ptrs_slab_getId(ptrs_struct_t *struc);
+ptrs_struct_t *ptrs_slab_getStruct(uint32_t id);
+
+typedef struct ptrs_slabthread ptrs_slabthread_t;
+ptrs_slabthread_t *ptrs_slab_getThread();
+
+void *ptrs_slab_allocate(ptrs_struct_t *struc);
+// memory that is not an instance allocated for struc by a slab is passed to free
+void ptrs_slab_free(ptrs_struct_t *struc, void *instance);
+
+// emit the free list and bump pointer fast paths, falling back to the functions above
+jit_value_t ptrs_jit_slabAllocate(jit_function_t func, ptrs_struct_t *struc);
+jit_value_t ptrs_jit_slabAllocateDynamic(jit_function_t func, jit_value_t struc);
+void ptrs_jit_slabFree(jit_function_t func, ptrs_struct_t *struc, jit_value_t instance);
+
+void ptrs_slab_printStats(FILE *out);
+
+#endif
@@ -1,13 +1,29 @@
 #ifndef _PTRS_STRUCT
 #define _PTRS_STRUCT
 
+#include <stdio.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 #include "../../parser/common.h"
 
-struct ptrs_opoverload *ptrs_struct_getOverloadInfo(ptrs_struct_t *struc, void *handler, bool isInstance);
-jit_function_t ptrs_struct_getOverload(ptrs_struct_t *struc, void *handler, bool isInstance);
-void *ptrs_struct_getOverloadClosure(ptrs_struct_t *struc, void *handler, bool isInstance);
+// walks the list of overloads, usable before the struct was compiled
+struct ptrs_opoverload *ptrs_struct_getOverloadInfo(ptrs_struct_t *struc, enum ptrs_structop op, bool isInstance);
+void ptrs_struct_fillOverloadTable(ptrs_struct_t *struc);
+jit_function_t ptrs_struct_getOverload(ptrs_struct_t *struc, enum ptrs_structop op, bool isInstance);
+void *ptrs_struct_getOverloadClosure(ptrs_struct_t *struc, enum ptrs_structop op, bool isInstance);
+
+// the members visited by foreach, filled by ptrs_handle_struct
+void ptrs_struct_fillForeachPlan(ptrs_struct_t *struc);
+struct ptrs_structmember **ptrs_struct_getForeachPlan(ptrs_struct_t *struc, bool isInstance, uint16_t *count);
+
+extern bool ptrs_structProfile;
+void ptrs_struct_addToProfile(ptrs_struct_t *struc);
+void ptrs_struct_writeProfile(FILE *out);
+bool ptrs_struct_readProfile(FILE *in);
+// returns -1 when no profile was read or it does not contain the member
+int64_t ptrs_struct_getProfiledCount(const char *structName, const char *memberName);
+void ptrs_jit_struct_countAccess(jit_function_t func, struct ptrs_structmember *member);
 
 bool ptrs_struct_canAccess(ptrs_ast_t *ast, ptrs_struct_t *struc, struct ptrs_structmember *member);
 
@@ -25,6 +41,9 @@ ptrs_var_t ptrs_struct_get(ptrs_ast_t *ast, void *instance, ptrs_meta_t meta,
 	const char *key, uint32_t keyLen);
 ptrs_jit_var_t ptrs_jit_struct_get(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
 	ptrs_jit_var_t base, jit_value_t key, jit_value_t keyLen);
+// emits a direct access of a member already found, e.g. using ptrs_struct_find
+ptrs_jit_var_t ptrs_jit_struct_getMember(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_jit_var_t base, ptrs_struct_t *struc, struct ptrs_structmember *member);
 
 void ptrs_struct_setMember(ptrs_ast_t *ast, void *data, ptrs_struct_t *struc,
 	struct ptrs_structmember *member, ptrs_val_t val, ptrs_meta_t meta);
@@ -45,6 +64,6 @@ ptrs_jit_var_t ptrs_jit_struct_call(ptrs_ast_t *node, jit_function_t func, ptrs_
 	ptrs_typing_t *retType, struct ptrs_astlist *args);
 
 ptrs_jit_var_t ptrs_struct_construct(ptrs_ast_t *ast, jit_function_t func, ptrs_scope_t *scope,
-	ptrs_jit_var_t constructor, struct ptrs_astlist *arguments, bool allocateOnStack);
+	ptrs_jit_var_t constructor, struct ptrs_astlist *arguments, bool allocateOnStack, bool allowReuse);
 
 #endif
@@ -0,0 +1,41 @@
+#ifndef _PTRS_STRUCTARRAY
+#define _PTRS_STRUCTARRAY
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <jit/jit.h>
+
+#include "../../parser/common.h"
+
+// arrays of structs use PTRS_NATIVETYPE_INDEX_STRUCT and store the slab id of the struct in meta.array.structId
+// the highest bit marks arrays storing every member in its own column
+#define PTRS_STRUCTARRAY_SOA 0x8000
+#define PTRS_STRUCTARRAY_MAXID 0x7FFF
+
+bool ptrs_structarray_isArray(ptrs_meta_t meta);
+bool ptrs_structarray_isSoa(ptrs_meta_t meta);
+ptrs_struct_t *ptrs_structarray_getStruct(ptrs_meta_t meta);
+size_t ptrs_structarray_getStride(ptrs_struct_t *struc);
+ptrs_meta_t ptrs_structarray_getMeta(ptrs_ast_t *node, ptrs_struct_t *struc, bool soa, uint32_t size);
+ptrs_meta_t ptrs_structarray_getElementMeta(ptrs_meta_t meta);
+
+ptrs_jit_var_t ptrs_jit_structarray_create(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_jit_var_t constructor, ptrs_jit_var_t length, bool soa, bool onStack);
+
+// the index is expected to be bounds checked already
+// the jit versions only use the struct of meta, the size of the array may differ at runtime
+ptrs_var_t ptrs_structarray_index(ptrs_ast_t *node, void *base, ptrs_meta_t meta, int64_t index);
+ptrs_jit_var_t ptrs_jit_structarray_index(ptrs_ast_t *node, jit_function_t func,
+	ptrs_meta_t meta, jit_value_t base, jit_value_t index);
+void ptrs_structarray_assignIndex(ptrs_ast_t *node, void *base, ptrs_meta_t meta, int64_t index,
+	ptrs_val_t val, ptrs_meta_t valMeta);
+void ptrs_jit_structarray_assignIndex(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_meta_t meta, jit_value_t base, jit_value_t index, ptrs_jit_var_t val);
+
+// columns of structure of arrays are returned as typed arrays
+ptrs_var_t ptrs_structarray_getColumn(ptrs_ast_t *node, void *base, ptrs_meta_t meta,
+	const char *key, uint32_t keyLen);
+ptrs_jit_var_t ptrs_jit_structarray_getColumn(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t base, const char *key, uint32_t keyLen);
+
+#endif
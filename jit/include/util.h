@@ -18,6 +18,9 @@ jit_value_t ptrs_jit_getArrayTypeSize(ptrs_ast_t *node, jit_function_t func,
 
 jit_type_t ptrs_jit_getVarType();
 
+// returns an interned signature owned by the cache, it must not be freed
+jit_type_t ptrs_jit_getSignature(jit_abi_t abi, jit_type_t retType, jit_type_t *params, unsigned int count);
+
 ptrs_jit_var_t ptrs_jit_valToVar(jit_function_t func, jit_value_t val);
 jit_value_t ptrs_jit_varToVal(jit_function_t func, ptrs_jit_var_t var);
 
@@ -32,9 +35,17 @@ ptrs_val_t ptrs_jit_value_getValConstant(jit_value_t val);
 ptrs_meta_t ptrs_jit_value_getMetaConstant(jit_value_t meta);
 ptrs_jit_var_t ptrs_jit_varFromConstant(jit_function_t func, ptrs_var_t val);
 
+// pointers into the stack frame of func might be alive, it must not be replaced by a tail call
+void ptrs_jit_markFrameReferenced(jit_function_t func);
+bool ptrs_jit_isFrameReferenced(jit_function_t func);
+
 jit_value_t ptrs_jit_allocate(jit_function_t func, jit_value_t size, bool onStack, bool allowReuse);
 
 jit_value_t ptrs_jit_import(ptrs_ast_t *node, jit_function_t func, jit_value_t val, bool asPtr);
+// the frame a closure of target has to be called with
+jit_value_t ptrs_jit_getParentFrame(jit_function_t func, jit_function_t target);
+// calls callee without arguments at its first use in a call of func and caches the non-NULL result
+jit_value_t ptrs_jit_hoistedCall(jit_function_t func, const char *name, void *callee, jit_type_t retType);
 
 #define ptrs_jit_reusableSignature(func, name, retType, types) \
 	static jit_type_t name = NULL; \
@@ -44,8 +55,8 @@ jit_value_t ptrs_jit_import(ptrs_ast_t *node, jit_function_t func, jit_value_t v
 			ptrs_util_pasteTuple types \
 		}; \
 		\
-		name = jit_type_create_signature(jit_abi_cdecl, retType, argDef, \
-			sizeof(argDef) / sizeof(jit_type_t), 0); \
+		name = ptrs_jit_getSignature(jit_abi_cdecl, retType, argDef, \
+			sizeof(argDef) / sizeof(jit_type_t)); \
 	}
 
 #define ptrs_jit_reusableCall(func, callee, retVal, retType, types, args) \
@@ -63,24 +74,12 @@ jit_value_t ptrs_jit_import(ptrs_ast_t *node, jit_function_t func, jit_value_t v
 #define ptrs_jit_reusableCallVoid(func, callee, types, args) \
 	ptrs_jit_reusableCall(func, callee, jit_value_t dummy, jit_type_void, types, args)
 
-//TODO libjit needs jit_function_apply_nested and jit_apply_nested
-//TODO, dont use ptrs_jit_function_to_closure but instead call it using the custom ABI
 #define ptrs_jit_applyNested(func, ret, parentFrame, thisArg, argPtrs) \
 	do \
 	{ \
-		void *closure = ptrs_jit_function_to_closure(NULL, func); \
-		void *args[] = {&parentFrame, &thisArg, ptrs_util_pasteTuple argPtrs}; \
-		\
-		jit_type_t argDef[sizeof(args) / sizeof(void *)]; \
-		for(int i = 0; i < sizeof(argDef) / sizeof(jit_type_t); i++) \
-			argDef[i] = jit_type_ulong; \
-		\
-		jit_type_t signature = jit_type_create_signature(jit_abi_cdecl, \
-			ptrs_jit_getVarType(), argDef, \
-			sizeof(argDef) / sizeof(jit_type_t), 0); \
-		\
-		jit_apply(signature, closure, args, sizeof(args) / sizeof(void *), ret); \
-		jit_type_free(signature); \
+		void *argv[] = {NULL, ptrs_util_pasteTuple argPtrs}; \
+		ptrs_jit_invoker_t invoker = ptrs_jit_getInvoker(func); \
+		*(ret) = invoker(parentFrame, thisArg, sizeof(argv) / sizeof(void *) - 1, argv + 1); \
 	} while(0)
 
 
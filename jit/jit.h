@@ -33,8 +33,11 @@ ptrs_jit_var_t ptrs_handle_scopestatement(ptrs_ast_t *node, jit_function_t func,
 ptrs_jit_var_t ptrs_handle_exprstatement(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope);
 
 ptrs_jit_var_t ptrs_handle_call(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope);
+ptrs_jit_var_t ptrs_handle_expand(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope);
 ptrs_jit_var_t ptrs_handle_stringformat(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope);
 ptrs_jit_var_t ptrs_handle_new(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope);
+ptrs_jit_var_t ptrs_handle_structarray(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope);
+ptrs_jit_var_t ptrs_handle_map(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope);
 ptrs_jit_var_t ptrs_handle_member(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope);
 ptrs_jit_var_t ptrs_handle_indexlength(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope);
 ptrs_jit_var_t ptrs_handle_index(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope);
@@ -70,6 +73,12 @@ ptrs_jit_var_t ptrs_call_member(ptrs_ast_t *node, jit_function_t func, ptrs_scop
 ptrs_jit_var_t ptrs_call_importedsymbol(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
 	ptrs_ast_t *caller, ptrs_typing_t *typing, struct ptrs_astlist *arguments);
 
+// indexing of values that were already evaluated, e.g. by delete
+ptrs_var_t ptrs_intrinsic_index(ptrs_ast_t *node, ptrs_val_t base, ptrs_meta_t baseMeta,
+	ptrs_val_t index, ptrs_meta_t indexMeta);
+ptrs_jit_var_t ptrs_jit_index(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_jit_var_t base, ptrs_jit_var_t index);
+
 ptrs_jit_var_t ptrs_handle_op_ternary(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope);
 ptrs_jit_var_t ptrs_handle_op_instanceof(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope);
 ptrs_jit_var_t ptrs_handle_op_in(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope);
@@ -121,5 +130,7 @@ void ptrs_handle_native_getFloat(void *target, size_t size, ptrs_var_t *value);
 void ptrs_handle_native_setFloat(void *target, size_t size, ptrs_var_t *value);
 void ptrs_handle_native_getVar(void *target, size_t size, ptrs_var_t *value);
 void ptrs_handle_native_setVar(void *target, size_t size, ptrs_var_t *value);
+void ptrs_handle_native_getStruct(void *target, size_t size, ptrs_var_t *value);
+void ptrs_handle_native_setStruct(void *target, size_t size, ptrs_var_t *value);
 
 #endif
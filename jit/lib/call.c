@@ -1,4 +1,7 @@
+#include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+#include <pthread.h>
 
 #include "../../parser/common.h"
 #include "../../parser/ast.h"
@@ -8,39 +11,330 @@
 #include "../include/astlist.h"
 #include "../include/conversion.h"
 #include "../include/call.h"
+#include "../include/report.h"
+#include "../jit.h"
+
+// expanded arrays with up to this many elements get their own call sequence when calling a function
+// value or native function, longer ones are passed to ptrs_callExpanded
+#define PTRS_INLINE_EXPANDED_ARGS 2
 
 int ptrs_optimizationLevel = -1;
+int ptrs_maxSpecializations = 4;
+
+struct ptrs_specialization
+{
+	jit_function_t func;
+	struct ptrs_specialization *next;
+	int8_t argTypes[];
+};
 
 void *ptrs_jit_createCallback(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope, void *closure);
+static void *getVariadicClosure(jit_function_t func, int narg);
+static size_t getParameterCount(ptrs_function_t *ast);
 
-ptrs_jit_var_t ptrs_jit_call(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
-	ptrs_typing_t *retType, jit_value_t thisPtr, ptrs_jit_var_t callee, struct ptrs_astlist *args)
+// entries are never changed or freed once published, so a call site always reads
+// a closure together with its own unchecked entry point
+struct ptrs_callcacheentry
 {
-	int narg = ptrs_astlist_length(args);
-	jit_type_t paramDef[narg * 2 + 1];
-	ptrs_jit_var_t evaledArgs[narg];
-	jit_value_t _args[narg * 2 + 1];
+	void *closure;
+	void *checked; // the closure itself or the one of a variadic function taking all arguments
+	void *unchecked; // NULL when the closure cannot be called without its checks
+	uint8_t retType; // PTRS_TYPE_INT or PTRS_TYPE_FLOAT when unchecked returns a single register, -1 for a var
+	struct ptrs_callcacheentry *next;
+};
+
+// per call site cache for calls through function values, see callThroughInlineCache
+struct ptrs_callcache
+{
+	struct ptrs_callcacheentry *current;
+	struct ptrs_callcacheentry *entries; // one per closure seen by the call site
+	size_t narg;
+	int8_t argTypes[];
+};
 
-	jit_value_t zero = jit_const_int(func, long, 0);
-	jit_value_t undefined = ptrs_jit_const_meta(func, PTRS_TYPE_UNDEFINED);
-	struct ptrs_astlist *curr = args;
+static bool passesMetaOnCallSite(int8_t argType)
+{
+	return argType != PTRS_TYPE_UNDEFINED && argType != PTRS_TYPE_INT && argType != PTRS_TYPE_FLOAT;
+}
+
+static void *getUncheckedClosure(struct ptrs_callcache *cache, void *closure, uint8_t *retType)
+{
+	*retType = (uint8_t)-1;
+
+	// functions using the default ABI are their own closure and have no checks to skip
+	jit_function_t checker = jit_function_from_closure(ptrs_jit_context, closure);
+	if(checker == NULL)
+		return NULL;
+	jit_function_t unchecked = jit_function_get_meta(checker, PTRS_JIT_FUNCTIONMETA_UNCHECKED);
+	if(unchecked == NULL)
+		return NULL;
+
+	ptrs_function_t *ast = jit_function_get_meta(unchecked, PTRS_JIT_FUNCTIONMETA_FUNCAST);
+	if(ast == NULL || ast->vararg != NULL)
+		return NULL;
+
+	// int and float returns, also inferred ones, come back in a register the call site knows how to read
+	uint8_t type = ast->retType.meta.type;
+	if(type == PTRS_TYPE_UNDEFINED
+		|| (type == PTRS_TYPE_STRUCT && ptrs_meta_getPointer(ast->retType.meta) != NULL))
+		return NULL;
+
+	// the unchecked function has to take the arguments in the form the call site passes them
+	// and the checks done by the .checked wrapper have to be implied by the argument types
+	size_t i = 0;
+	for(ptrs_funcparameter_t *curr = ast->args; curr != NULL; curr = curr->next, i++)
+	{
+		if(i >= cache->narg || curr->argv != NULL)
+			return NULL;
+
+		ptrs_meta_t typing = curr->typing.meta;
+		int8_t argType = cache->argTypes[i];
+		switch(typing.type)
+		{
+			case (uint8_t)-1:
+				if(!passesMetaOnCallSite(argType))
+					return NULL;
+				break;
+			case PTRS_TYPE_UNDEFINED:
+			case PTRS_TYPE_INT:
+			case PTRS_TYPE_FLOAT:
+			case PTRS_TYPE_FUNCTION:
+			case PTRS_TYPE_MAP:
+				if(argType != typing.type)
+					return NULL;
+				break;
+			case PTRS_TYPE_POINTER:
+				if(argType != PTRS_TYPE_POINTER || typing.array.size != 0)
+					return NULL;
+				break;
+			case PTRS_TYPE_STRUCT:
+				if(argType != PTRS_TYPE_STRUCT || ptrs_meta_getPointer(typing) != NULL)
+					return NULL;
+				break;
+			default:
+				return NULL;
+		}
+	}
+
+	if(i != cache->narg)
+		return NULL;
+
+	if(type == PTRS_TYPE_INT || type == PTRS_TYPE_FLOAT)
+		*retType = type;
+	return jit_function_to_closure(unchecked);
+}
+
+// the closure of a variadic function only takes its parameters, the call site
+// needs one that also takes the arguments it passes in addition
+static void *getCheckedClosure(struct ptrs_callcache *cache, void *closure)
+{
+	jit_function_t checker = jit_function_from_closure(ptrs_jit_context, closure);
+	jit_function_t unchecked = checker == NULL ? NULL
+		: jit_function_get_meta(checker, PTRS_JIT_FUNCTIONMETA_UNCHECKED);
+	ptrs_function_t *ast = unchecked == NULL ? NULL
+		: jit_function_get_meta(unchecked, PTRS_JIT_FUNCTIONMETA_FUNCAST);
+
+	if(ast == NULL || ast->vararg == NULL || cache->narg <= getParameterCount(ast))
+		return closure;
+	else
+		return getVariadicClosure(unchecked, cache->narg);
+}
+
+struct ptrs_callcacheentry *ptrs_callcache_update(struct ptrs_callcache *cache, void *closure)
+{
+	struct ptrs_callcacheentry *entry = __atomic_load_n(&cache->entries, __ATOMIC_ACQUIRE);
+	while(entry != NULL && entry->closure != closure)
+		entry = entry->next;
+
+	if(entry == NULL)
+	{
+		// two threads adding the same closure at once only results in a duplicate entry
+		entry = malloc(sizeof(struct ptrs_callcacheentry));
+		entry->closure = closure;
+		entry->checked = getCheckedClosure(cache, closure);
+		entry->unchecked = getUncheckedClosure(cache, closure, &entry->retType);
+		entry->next = __atomic_load_n(&cache->entries, __ATOMIC_RELAXED);
+		while(!__atomic_compare_exchange_n(&cache->entries, &entry->next, entry,
+			true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	}
+
+	__atomic_store_n(&cache->current, entry, __ATOMIC_RELEASE);
+	return entry;
+}
+
+// returns the closure to call with all arguments as value and meta pairs
+static jit_value_t callThroughInlineCache(jit_function_t func, jit_value_t thisPtr, ptrs_jit_var_t callee,
+	jit_value_t parentFrame, size_t narg, ptrs_jit_var_t *args, ptrs_jit_var_t ret, jit_label_t *done)
+{
+	// without arguments a variadic function gets an empty var[] from its usual closure
+	if(narg == 0)
+		return callee.val;
+
+	bool hasKnownType = false;
 	for(int i = 0; i < narg; i++)
 	{
-		ptrs_jit_var_t val;
-		if(curr->entry == NULL)
+		if(args[i].constType != -1)
+			hasKnownType = true;
+	}
+
+	struct ptrs_callcache *cache = malloc(sizeof(struct ptrs_callcache) + narg * sizeof(int8_t));
+	cache->current = NULL;
+	cache->entries = NULL;
+	cache->narg = narg;
+
+	size_t jitArgc = 1;
+	for(int i = 0; i < narg; i++)
+	{
+		cache->argTypes[i] = args[i].constType;
+		if(args[i].constType == PTRS_TYPE_INT || args[i].constType == PTRS_TYPE_FLOAT)
+			jitArgc++;
+		else if(passesMetaOnCallSite(args[i].constType))
+			jitArgc += 2;
+	}
+
+	jit_value_t cacheVal = jit_const_int(func, void_ptr, (uintptr_t)cache);
+	jit_label_t update = jit_label_undefined;
+	jit_label_t hit = jit_label_undefined;
+	jit_label_t miss = jit_label_undefined;
+
+	// the closure and unchecked entry point are read from the same immutable entry
+	jit_value_t entry = jit_value_create(func, jit_type_void_ptr);
+	jit_insn_store(func, entry, jit_insn_load_relative(func, cacheVal,
+		offsetof(struct ptrs_callcache, current), jit_type_void_ptr));
+	jit_insn_branch_if_not(func, entry, &update);
+
+	jit_value_t cachedClosure = jit_insn_load_relative(func, entry,
+		offsetof(struct ptrs_callcacheentry, closure), jit_type_void_ptr);
+	jit_insn_branch_if(func, jit_insn_eq(func, cachedClosure, callee.val), &hit);
+
+	jit_insn_label(func, &update);
+	jit_value_t newEntry;
+	ptrs_jit_reusableCall(func, ptrs_callcache_update, newEntry, jit_type_void_ptr,
+		(jit_type_void_ptr, jit_type_void_ptr), (cacheVal, callee.val));
+	jit_insn_store(func, entry, newEntry);
+
+	jit_insn_label(func, &hit);
+	jit_value_t checked = jit_insn_load_relative(func, entry,
+		offsetof(struct ptrs_callcacheentry, checked), jit_type_void_ptr);
+
+	// without any known argument type no function with a .checked wrapper can match
+	if(!hasKnownType)
+		return checked;
+
+	jit_value_t unchecked = jit_insn_load_relative(func, entry,
+		offsetof(struct ptrs_callcacheentry, unchecked), jit_type_void_ptr);
+	jit_insn_branch_if_not(func, unchecked, &miss);
+
+	jit_type_t paramDef[jitArgc];
+	jit_value_t jitArgs[jitArgc];
+	paramDef[0] = jit_type_void_ptr;
+	jitArgs[0] = thisPtr;
+
+	size_t pos = 1;
+	for(int i = 0; i < narg; i++)
+	{
+		if(args[i].constType == PTRS_TYPE_INT)
 		{
-			evaledArgs[i].val = zero;
-			evaledArgs[i].meta = undefined;
-			evaledArgs[i].constType = PTRS_TYPE_UNDEFINED;
+			paramDef[pos] = jit_type_long;
+			jitArgs[pos++] = ptrs_jit_reinterpretCast(func, args[i].val, jit_type_long);
 		}
-		else
+		else if(args[i].constType == PTRS_TYPE_FLOAT)
 		{
-			evaledArgs[i] = curr->entry->vtable->get(curr->entry, func, scope);
+			paramDef[pos] = jit_type_float64;
+			jitArgs[pos++] = ptrs_jit_reinterpretCast(func, args[i].val, jit_type_float64);
+		}
+		else if(passesMetaOnCallSite(args[i].constType))
+		{
+			paramDef[pos] = jit_type_long;
+			jitArgs[pos++] = ptrs_jit_reinterpretCast(func, args[i].val, jit_type_long);
+			paramDef[pos] = jit_type_ulong;
+			jitArgs[pos++] = args[i].meta;
 		}
+	}
 
-		curr = curr->next;
+	// the return ABI of the unchecked function depends on its return type, which can be inferred
+	jit_value_t retType = jit_insn_load_relative(func, entry,
+		offsetof(struct ptrs_callcacheentry, retType), jit_type_ubyte);
+	jit_label_t notInt = jit_label_undefined;
+	jit_label_t notFloat = jit_label_undefined;
+
+	jit_insn_branch_if(func, jit_insn_ne(func, retType, jit_const_int(func, ubyte, PTRS_TYPE_INT)), &notInt);
+	jit_type_t signature = ptrs_jit_getSignature(jit_abi_cdecl, jit_type_long, paramDef, jitArgc);
+	jit_value_t retVal = jit_insn_call_nested_indirect(func, unchecked,
+		parentFrame, signature, jitArgs, jitArgc, 0);
+	jit_insn_store(func, ret.val, retVal);
+	jit_insn_store(func, ret.meta, ptrs_jit_const_meta(func, PTRS_TYPE_INT));
+	jit_insn_branch(func, done);
+
+	jit_insn_label(func, &notInt);
+	jit_insn_branch_if(func, jit_insn_ne(func, retType, jit_const_int(func, ubyte, PTRS_TYPE_FLOAT)), &notFloat);
+	signature = ptrs_jit_getSignature(jit_abi_cdecl, jit_type_float64, paramDef, jitArgc);
+	retVal = jit_insn_call_nested_indirect(func, unchecked,
+		parentFrame, signature, jitArgs, jitArgc, 0);
+	jit_insn_store(func, ret.val, ptrs_jit_reinterpretCast(func, retVal, jit_type_long));
+	jit_insn_store(func, ret.meta, ptrs_jit_const_meta(func, PTRS_TYPE_FLOAT));
+	jit_insn_branch(func, done);
+
+	jit_insn_label(func, &notFloat);
+	signature = ptrs_jit_getSignature(jit_abi_cdecl, ptrs_jit_getVarType(), paramDef, jitArgc);
+	retVal = jit_insn_call_nested_indirect(func, unchecked,
+		parentFrame, signature, jitArgs, jitArgc, 0);
+
+	ptrs_jit_var_t _ret = ptrs_jit_valToVar(func, retVal);
+	jit_insn_store(func, ret.val, _ret.val);
+	jit_insn_store(func, ret.meta, _ret.meta);
+	jit_insn_branch(func, done);
+
+	jit_insn_label(func, &miss);
+	return checked;
+}
+
+static ptrs_ast_t *getExpansion(struct ptrs_astlist *args)
+{
+	while(args != NULL && args->next != NULL)
+		args = args->next;
+
+	if(args != NULL && args->entry != NULL && args->entry->vtable == &ptrs_ast_vtable_expand)
+		return args->entry;
+	else
+		return NULL;
+}
+static ptrs_jit_var_t evaluateExpansion(jit_function_t func, ptrs_scope_t *scope, ptrs_ast_t *expansion)
+{
+	ptrs_ast_t *value = expansion->arg.astval;
+	ptrs_jit_var_t array = value->vtable->get(value, func, scope);
+
+	ptrs_jit_typeCheck(expansion, func, scope, array, PTRS_TYPE_POINTER, "Cannot expand a value of type %t");
+	if(ptrs_enableSafety)
+	{
+		jit_value_t typeIndex = ptrs_jit_getArrayTypeIndex(func, array.meta);
+		ptrs_jit_assert(expansion, func, scope,
+			jit_insn_eq(func, typeIndex, jit_const_long(func, ulong, PTRS_NATIVETYPE_INDEX_VAR)),
+			0, "Only arrays of type var can be expanded");
 	}
 
+	array.val = ptrs_jit_reinterpretCast(func, array.val, jit_type_void_ptr);
+	return array;
+}
+static ptrs_jit_var_t loadExpandedArgument(jit_function_t func, jit_value_t array, int index)
+{
+	ptrs_jit_var_t ret;
+	ret.val = jit_insn_load_relative(func, array, index * sizeof(ptrs_var_t), jit_type_long);
+	ret.meta = jit_insn_load_relative(func, array, index * sizeof(ptrs_var_t) + sizeof(ptrs_val_t), jit_type_ulong);
+	ret.constType = -1;
+	ret.addressable = false;
+	return ret;
+}
+
+static ptrs_jit_var_t callValue(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_typing_t *retType, jit_value_t thisPtr, ptrs_jit_var_t callee, int narg, ptrs_jit_var_t *evaledArgs)
+{
+	jit_type_t paramDef[narg * 2 + 1];
+	jit_value_t _args[narg * 2 + 1];
+
+	if(callee.constType == -1)
+		ptrs_report_fallback(func, node, "call");
+
 	ptrs_jit_var_t ret = {
 		jit_value_create(func, jit_type_long),
 		jit_value_create(func, jit_type_ulong),
@@ -52,6 +346,11 @@ ptrs_jit_var_t ptrs_jit_call(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t
 		(PTRS_TYPE_FUNCTION, PTRS_TYPE_POINTER),
 		case PTRS_TYPE_FUNCTION:
 			{
+				jit_label_t done = jit_label_undefined;
+				jit_value_t parentFrame = ptrs_jit_getMetaPointer(func, callee.meta);
+				jit_value_t target = callThroughInlineCache(func, thisPtr, callee, parentFrame,
+					narg, evaledArgs, ret, &done);
+
 				paramDef[0] = jit_type_void_ptr;
 				_args[0] = thisPtr;
 
@@ -64,17 +363,17 @@ ptrs_jit_var_t ptrs_jit_call(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t
 					_args[i * 2 + 2] = evaledArgs[i].meta;
 				}
 
-				jit_value_t parentFrame = ptrs_jit_getMetaPointer(func, callee.meta);
-				jit_type_t signature = jit_type_create_signature(jit_abi_cdecl,
-					ptrs_jit_getVarType(), paramDef, narg * 2 + 1, 0);
+				jit_type_t signature = ptrs_jit_getSignature(jit_abi_cdecl,
+					ptrs_jit_getVarType(), paramDef, narg * 2 + 1);
 
-				jit_value_t retVal = jit_insn_call_nested_indirect(func, callee.val,
+				jit_value_t retVal = jit_insn_call_nested_indirect(func, target,
 					parentFrame, signature, _args, narg * 2 + 1, 0);
-				jit_type_free(signature);
 
 				ptrs_jit_var_t _ret = ptrs_jit_valToVar(func, retVal);
 				jit_insn_store(func, ret.val, _ret.val);
 				jit_insn_store(func, ret.meta, _ret.meta);
+
+				jit_insn_label(func, &done);
 			}
 			break;
 
@@ -89,8 +388,23 @@ ptrs_jit_var_t ptrs_jit_call(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t
 							_args[i] = jit_const_int(func, long, 0);
 							break;
 						case -1:
-							//TODO this should get special care
-							/* fallthrough */
+							paramDef[i] = jit_type_long;
+							_args[i] = jit_value_create(func, jit_type_long);
+							jit_insn_store(func, _args[i], ptrs_jit_reinterpretCast(func, evaledArgs[i].val, jit_type_long));
+
+							jit_label_t noFunction = jit_label_undefined;
+							jit_value_t argType = ptrs_jit_getType(func, evaledArgs[i].meta);
+							jit_insn_branch_if(func, jit_insn_ne(func, argType,
+								jit_const_int(func, ubyte, PTRS_TYPE_FUNCTION)), &noFunction);
+
+							jit_value_t trampoline;
+							ptrs_jit_reusableCall(func, ptrs_callback_acquire, trampoline, jit_type_void_ptr,
+								(jit_type_void_ptr, jit_type_void_ptr),
+								(evaledArgs[i].val, ptrs_jit_getMetaPointer(func, evaledArgs[i].meta)));
+							jit_insn_store(func, _args[i], trampoline);
+
+							jit_insn_label(func, &noFunction);
+							break;
 						case PTRS_TYPE_INT:
 							paramDef[i] = jit_type_long;
 							_args[i] = evaledArgs[i].val;
@@ -113,20 +427,11 @@ ptrs_jit_var_t ptrs_jit_call(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t
 								}
 							}
 
-							if(!ptrs_compileAot) // XXX hacky to not throw an error with --asmdump --no-aot
-							{
-								paramDef[i] = jit_type_void_ptr;
-								_args[i] = evaledArgs[i].val;
-								break;
-							}
-
-							//TODO create callbacks at runtime
-							curr = args;
-							while(i-- > 0)
-								curr = curr->next;
-							ptrs_error(curr->entry, "Cannot pass nested PointerScript function"
-								" as an argument to a native function");
-
+							// closures capturing a frame get a trampoline binding the frame at runtime
+							paramDef[i] = jit_type_void_ptr;
+							ptrs_jit_reusableCall(func, ptrs_callback_acquire, _args[i], jit_type_void_ptr,
+								(jit_type_void_ptr, jit_type_void_ptr),
+								(evaledArgs[i].val, ptrs_jit_getMetaPointer(func, evaledArgs[i].meta)));
 							break;
 						default: //pointer type
 							paramDef[i] = jit_type_void_ptr;
@@ -142,9 +447,8 @@ ptrs_jit_var_t ptrs_jit_call(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t
 				else
 					memcpy(&retMeta, &retType->meta, sizeof(ptrs_meta_t));
 
-				jit_type_t signature = jit_type_create_signature(jit_abi_cdecl, _retType, paramDef, narg, 0);
+				jit_type_t signature = ptrs_jit_getSignature(jit_abi_cdecl, _retType, paramDef, narg);
 				jit_value_t retVal = jit_insn_call_indirect(func, callee.val, signature, _args, narg, 0);
-				jit_type_free(signature);
 
 				retVal = ptrs_jit_normalizeForVar(func, retVal);
 				jit_value_t retMetaVal = jit_const_long(func, ulong, *(uint64_t *)&retMeta);
@@ -167,6 +471,354 @@ ptrs_jit_var_t ptrs_jit_call(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t
 	return ret;
 }
 
+static ptrs_var_t convertNativeReturn(ptrs_typing_t *retType, jit_type_t jitRetType, void *retBuff)
+{
+	ptrs_var_t ret;
+	memset(&ret.meta, 0, sizeof(ptrs_meta_t));
+	if(retType == NULL || retType->meta.type == (uint8_t)-1)
+		ret.meta.type = PTRS_TYPE_INT;
+	else
+		memcpy(&ret.meta, &retType->meta, sizeof(ptrs_meta_t));
+
+	switch(jit_type_get_kind(jit_type_normalize(jitRetType)))
+	{
+		case JIT_TYPE_SBYTE:
+			ret.value.intval = *(int8_t *)retBuff;
+			break;
+		case JIT_TYPE_UBYTE:
+			ret.value.intval = *(uint8_t *)retBuff;
+			break;
+		case JIT_TYPE_SHORT:
+			ret.value.intval = *(int16_t *)retBuff;
+			break;
+		case JIT_TYPE_USHORT:
+			ret.value.intval = *(uint16_t *)retBuff;
+			break;
+		case JIT_TYPE_INT:
+			ret.value.intval = *(int32_t *)retBuff;
+			break;
+		case JIT_TYPE_UINT:
+			ret.value.intval = *(uint32_t *)retBuff;
+			break;
+		case JIT_TYPE_FLOAT32:
+			ret.value.floatval = *(float *)retBuff;
+			break;
+		case JIT_TYPE_FLOAT64:
+			ret.value.floatval = *(double *)retBuff;
+			break;
+		default:
+			ret.value.intval = *(int64_t *)retBuff;
+			break;
+	}
+
+	return ret;
+}
+
+static void *acquireTrampoline(void *closure, void *parentFrame, bool *wasBound);
+
+// signatures of native calls with expanded arguments, one list per call site
+// entries are never changed or freed once published
+struct ptrs_expandedsignature
+{
+	jit_type_t signature;
+	int narg;
+	struct ptrs_expandedsignature *next;
+	jit_type_t params[];
+};
+
+static jit_type_t getExpandedSignature(struct ptrs_expandedsignature **cache, jit_type_t retType,
+	int narg, jit_type_t *params)
+{
+	struct ptrs_expandedsignature *curr = __atomic_load_n(cache, __ATOMIC_ACQUIRE);
+	for(; curr != NULL; curr = curr->next)
+	{
+		if(curr->narg == narg && memcmp(curr->params, params, narg * sizeof(jit_type_t)) == 0)
+			return curr->signature;
+	}
+
+	// ptrs_jit_getSignature is only used while compiling, this runs on any thread
+	curr = malloc(sizeof(struct ptrs_expandedsignature) + narg * sizeof(jit_type_t));
+	curr->signature = jit_type_create_signature(jit_abi_cdecl, retType, params, narg, 1);
+	curr->narg = narg;
+	memcpy(curr->params, params, narg * sizeof(jit_type_t));
+
+	// two threads adding the same signature at once only results in a duplicate entry
+	curr->next = __atomic_load_n(cache, __ATOMIC_RELAXED);
+	while(!__atomic_compare_exchange_n(cache, &curr->next, curr,
+		true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+	return curr->signature;
+}
+
+// calls a function value or native function with the arguments before the expansion
+// followed by the elements of the expanded array, neither of them is copied
+ptrs_var_t ptrs_callExpanded(ptrs_ast_t *node, struct ptrs_expandedsignature **cache,
+	ptrs_typing_t *retType, void *thisPtr, ptrs_val_t callee, ptrs_meta_t calleeMeta,
+	int narg, ptrs_var_t *args, int nexpanded, ptrs_var_t *expanded)
+{
+	int total = narg + nexpanded;
+	if(calleeMeta.type == PTRS_TYPE_FUNCTION)
+	{
+		jit_function_t func = jit_function_from_closure(ptrs_jit_context, callee.ptrval);
+		if(func == NULL)
+			ptrs_error(node, "Cannot expand arguments into a function not created by PointerScript");
+
+		jit_function_t unchecked = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_UNCHECKED);
+		if(unchecked != NULL)
+			func = unchecked;
+
+		void *argv[total * 2];
+		for(int i = 0; i < total; i++)
+		{
+			ptrs_var_t *arg = i < narg ? &args[i] : &expanded[i - narg];
+			argv[i * 2] = &arg->value;
+			argv[i * 2 + 1] = &arg->meta;
+		}
+
+		ptrs_jit_invoker_t invoker = ptrs_jit_getInvoker(func);
+		return invoker(ptrs_meta_getPointer(calleeMeta), thisPtr, total * 2, argv);
+	}
+	else if(calleeMeta.type != PTRS_TYPE_POINTER)
+	{
+		ptrs_error(node, "Cannot call variable of type %m", calleeMeta);
+	}
+
+	jit_type_t paramDef[total];
+	ptrs_val_t values[total];
+	void *argv[total];
+	void *callbacks[total];
+	int callbackCount = 0;
+	for(int i = 0; i < total; i++)
+	{
+		ptrs_var_t *arg = i < narg ? &args[i] : &expanded[i - narg];
+		bool wasBound;
+		values[i] = arg->value;
+		argv[i] = &values[i];
+
+		switch(arg->meta.type)
+		{
+			case PTRS_TYPE_UNDEFINED:
+				paramDef[i] = jit_type_long;
+				values[i].intval = 0;
+				break;
+			case PTRS_TYPE_INT:
+				paramDef[i] = jit_type_long;
+				break;
+			case PTRS_TYPE_FLOAT:
+				paramDef[i] = jit_type_float64;
+				break;
+			case PTRS_TYPE_FUNCTION:
+				paramDef[i] = jit_type_void_ptr;
+				values[i].ptrval = acquireTrampoline(arg->value.ptrval, ptrs_meta_getPointer(arg->meta), &wasBound);
+				// only unbind trampolines bound by this call, C code may still hold the others
+				if(!wasBound)
+					callbacks[callbackCount++] = values[i].ptrval;
+				break;
+			default: //pointer type
+				paramDef[i] = jit_type_void_ptr;
+				break;
+		}
+	}
+
+	jit_type_t jitRetType = ptrs_jit_jitTypeFromTyping(retType);
+	jit_type_t signature = getExpandedSignature(cache, jitRetType, total, paramDef);
+
+	uint64_t retBuff[2] = {0};
+	jit_apply(signature, callee.ptrval, argv, total, retBuff);
+
+	for(int i = 0; i < callbackCount; i++)
+		ptrs_callback_release(callbacks[i]);
+
+	return convertNativeReturn(retType, jitRetType, retBuff);
+}
+
+// the number of arguments is only known at runtime, short arrays get one call for each
+// possible count, longer ones are called through ptrs_callExpanded
+static ptrs_jit_var_t callValueExpanded(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_typing_t *retType, jit_value_t thisPtr, ptrs_jit_var_t callee,
+	int narg, ptrs_jit_var_t *evaledArgs, ptrs_ast_t *expansion)
+{
+	ptrs_jit_var_t array = evaluateExpansion(func, scope, expansion);
+	jit_value_t count = ptrs_jit_getArraySize(func, array.meta);
+
+	ptrs_jit_var_t ret = {
+		jit_value_create(func, jit_type_long),
+		jit_value_create(func, jit_type_ulong),
+		-1
+	};
+
+	jit_label_t done = jit_label_undefined;
+	for(int i = 0; i <= PTRS_INLINE_EXPANDED_ARGS; i++)
+	{
+		jit_label_t next = jit_label_undefined;
+		jit_insn_branch_if(func, jit_insn_ne(func, count, jit_const_long(func, ulong, i)), &next);
+
+		for(int j = 0; j < i; j++)
+			evaledArgs[narg + j] = loadExpandedArgument(func, array.val, j);
+
+		ptrs_jit_var_t val = callValue(node, func, scope, retType, thisPtr, callee, narg + i, evaledArgs);
+		jit_insn_store(func, ret.val, ptrs_jit_reinterpretCast(func, val.val, jit_type_long));
+		jit_insn_store(func, ret.meta, val.meta);
+		jit_insn_branch(func, &done);
+
+		jit_insn_label(func, &next);
+	}
+
+	// the arguments before the expansion go into a frame slot of constant size that is reused by
+	// every call, the expanded array is passed as it is
+	jit_value_t leading = jit_const_int(func, void_ptr, 0);
+	if(narg > 0)
+	{
+		leading = ptrs_jit_allocate(func, jit_const_int(func, nuint, narg * sizeof(ptrs_var_t)), true, true);
+		for(int i = 0; i < narg; i++)
+		{
+			jit_value_t val = ptrs_jit_reinterpretCast(func, evaledArgs[i].val, jit_type_long);
+			jit_insn_store_relative(func, leading, i * sizeof(ptrs_var_t), val);
+			jit_insn_store_relative(func, leading, i * sizeof(ptrs_var_t) + sizeof(ptrs_val_t), evaledArgs[i].meta);
+		}
+	}
+
+	struct ptrs_expandedsignature **cache = calloc(1, sizeof(struct ptrs_expandedsignature *));
+
+	jit_value_t retVal;
+	ptrs_jit_reusableCall(func, ptrs_callExpanded, retVal, ptrs_jit_getVarType(),
+		(jit_type_void_ptr, jit_type_void_ptr, jit_type_void_ptr, jit_type_void_ptr, jit_type_long,
+			jit_type_ulong, jit_type_int, jit_type_void_ptr, jit_type_int, jit_type_void_ptr),
+		(jit_const_int(func, void_ptr, (uintptr_t)node), jit_const_int(func, void_ptr, (uintptr_t)cache),
+			jit_const_int(func, void_ptr, (uintptr_t)retType), thisPtr,
+			ptrs_jit_reinterpretCast(func, callee.val, jit_type_long), callee.meta,
+			jit_const_int(func, int, narg), leading,
+			jit_insn_convert(func, count, jit_type_int, 0), array.val)
+	);
+
+	ptrs_jit_var_t val = ptrs_jit_valToVar(func, retVal);
+	jit_insn_store(func, ret.val, val.val);
+	jit_insn_store(func, ret.meta, val.meta);
+
+	jit_insn_label(func, &done);
+	return ret;
+}
+
+ptrs_jit_var_t ptrs_jit_call(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_typing_t *retType, jit_value_t thisPtr, ptrs_jit_var_t callee, struct ptrs_astlist *args)
+{
+	ptrs_ast_t *expansion = getExpansion(args);
+	int narg = ptrs_astlist_length(args);
+	if(expansion != NULL)
+		narg--;
+
+	ptrs_jit_var_t evaledArgs[narg + (expansion != NULL ? PTRS_INLINE_EXPANDED_ARGS : 0)];
+
+	jit_value_t zero = jit_const_int(func, long, 0);
+	jit_value_t undefined = ptrs_jit_const_meta(func, PTRS_TYPE_UNDEFINED);
+	struct ptrs_astlist *curr = args;
+	for(int i = 0; i < narg; i++)
+	{
+		if(curr->entry == NULL)
+		{
+			evaledArgs[i].val = zero;
+			evaledArgs[i].meta = undefined;
+			evaledArgs[i].constType = PTRS_TYPE_UNDEFINED;
+		}
+		else
+		{
+			evaledArgs[i] = curr->entry->vtable->get(curr->entry, func, scope);
+		}
+
+		curr = curr->next;
+	}
+
+	if(expansion != NULL)
+		return callValueExpanded(node, func, scope, retType, thisPtr, callee, narg, evaledArgs, expansion);
+	else
+		return callValue(node, func, scope, retType, thisPtr, callee, narg, evaledArgs);
+}
+
+void ptrs_jit_createFfiSignature(struct ptrs_ffideclaration *ffi)
+{
+	if(ffi->signature != NULL)
+		return;
+
+	jit_type_t paramDef[ffi->argc];
+	for(int i = 0; i < ffi->argc; i++)
+		paramDef[i] = ffi->argTypes[i]->jitType;
+
+	jit_type_t retType = ffi->retType == NULL ? jit_type_void : ffi->retType->jitType;
+	ffi->signature = ptrs_jit_getSignature(jit_abi_cdecl, retType, paramDef, ffi->argc);
+}
+
+ptrs_jit_var_t ptrs_jit_callFfi(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	void *target, struct ptrs_ffideclaration *ffi, struct ptrs_astlist *args)
+{
+	int narg = ptrs_astlist_length(args);
+	if(getExpansion(args) != NULL)
+		ptrs_error(node, "Arrays cannot be expanded into the arguments of a typed native function");
+	if(narg != ffi->argc)
+		ptrs_error(node, "Native function expects %d arguments but %d were given", ffi->argc, narg);
+
+	ptrs_jit_createFfiSignature(ffi);
+
+	jit_value_t _args[narg > 0 ? narg : 1];
+	struct ptrs_astlist *curr = args;
+	for(int i = 0; i < narg; i++)
+	{
+		ptrs_nativetype_info_t *type = ffi->argTypes[i];
+		ptrs_jit_var_t val;
+		if(curr->entry == NULL)
+		{
+			val.val = jit_const_long(func, long, 0);
+			val.meta = ptrs_jit_const_meta(func, PTRS_TYPE_UNDEFINED);
+			val.constType = PTRS_TYPE_UNDEFINED;
+		}
+		else
+		{
+			val = curr->entry->vtable->get(curr->entry, func, scope);
+		}
+
+		// the declared type decides the conversion, no type switch is needed
+		if(type->varType == PTRS_TYPE_INT)
+		{
+			_args[i] = jit_insn_convert(func, ptrs_jit_vartoi(func, val), type->jitType, 0);
+		}
+		else if(type->varType == PTRS_TYPE_FLOAT)
+		{
+			_args[i] = jit_insn_convert(func, ptrs_jit_vartof(func, val), type->jitType, 0);
+		}
+		else if(val.constType == PTRS_TYPE_FUNCTION)
+		{
+			ptrs_jit_reusableCall(func, ptrs_callback_acquire, _args[i], jit_type_void_ptr,
+				(jit_type_void_ptr, jit_type_void_ptr),
+				(val.val, ptrs_jit_getMetaPointer(func, val.meta)));
+		}
+		else
+		{
+			_args[i] = ptrs_jit_reinterpretCast(func, val.val, jit_type_void_ptr);
+		}
+
+		curr = curr->next;
+	}
+
+	jit_value_t callee = jit_const_int(func, void_ptr, (uintptr_t)target);
+	jit_value_t retVal = jit_insn_call_indirect(func, callee, ffi->signature, _args, narg, 0);
+
+	ptrs_jit_var_t ret;
+	ret.addressable = false;
+	if(ffi->retType == NULL)
+	{
+		ret.val = jit_const_long(func, long, 0);
+		ret.meta = ptrs_jit_const_meta(func, PTRS_TYPE_UNDEFINED);
+		ret.constType = PTRS_TYPE_UNDEFINED;
+	}
+	else
+	{
+		ret.val = ptrs_jit_normalizeForVar(func, retVal);
+		ret.meta = ptrs_jit_const_meta(func, ffi->retType->varType);
+		ret.constType = ffi->retType->varType;
+	}
+
+	return ret;
+}
+
 static size_t getParameterCount(ptrs_function_t *ast)
 {
 	size_t count = 0;
@@ -289,6 +941,7 @@ static bool retrieveParameterArray(ptrs_function_t *ast, jit_function_t func)
 					// else falthrough
 				case PTRS_TYPE_POINTER:
 				case PTRS_TYPE_FUNCTION:
+				case PTRS_TYPE_MAP:
 					param.val = jit_value_get_param(func, argPos);
 					param.meta = jit_value_get_param(func, argPos + 1);
 					argPos += 2;
@@ -306,6 +959,17 @@ static bool retrieveParameterArray(ptrs_function_t *ast, jit_function_t func)
 		argDef->arg = param;
 	}
 
+	if(ast->vararg != NULL)
+	{
+		ast->vararg->val = jit_value_get_param(func, argPos);
+		ast->vararg->meta = jit_value_get_param(func, argPos + 1);
+		ast->vararg->constType = -1;
+		ast->vararg->addressable = false;
+
+		// the closure of a function has no way of knowing how many arguments were passed
+		usesCustomAbi = true;
+	}
+
 	return usesCustomAbi;
 }
 static size_t fillCustomAbiArgumentArray(ptrs_function_t *ast, jit_type_t *typeDef, jit_value_t *jitArgs,
@@ -317,8 +981,9 @@ static size_t fillCustomAbiArgumentArray(ptrs_function_t *ast, jit_type_t *typeD
 	if(typeDef != NULL)
 		typeDef[0] = jit_type_void_ptr;
 
+	int i = 0;
 	ptrs_funcparameter_t *argDef = ast->args;
-	for(int i = 0; argDef != NULL; i++)
+	for(; argDef != NULL; i++)
 	{
 		if(i >= narg)
 			ptrs_error(NULL, "Internal error: parameter counts dont match");
@@ -357,6 +1022,7 @@ static size_t fillCustomAbiArgumentArray(ptrs_function_t *ast, jit_type_t *typeD
 					// else falthrough
 				case PTRS_TYPE_POINTER:
 				case PTRS_TYPE_FUNCTION:
+				case PTRS_TYPE_MAP:
 					if(jitArgs != NULL && args != NULL)
 					{
 						jitArgs[argCount] = args[i].val;
@@ -389,6 +1055,25 @@ static size_t fillCustomAbiArgumentArray(ptrs_function_t *ast, jit_type_t *typeD
 		argDef = argDef->next;
 	}
 
+	// variadic arguments are passed as a single var[] after all other parameters
+	if(ast->vararg != NULL)
+	{
+		if(jitArgs != NULL && args != NULL)
+		{
+			if(i >= narg)
+				ptrs_error(NULL, "Internal error: parameter counts dont match");
+
+			jitArgs[argCount] = args[i].val;
+			jitArgs[argCount + 1] = args[i].meta;
+		}
+		if(typeDef != NULL)
+		{
+			typeDef[argCount] = jit_type_long;
+			typeDef[argCount + 1] = jit_type_ulong;
+		}
+		argCount += 2;
+	}
+
 	return argCount;
 }
 static ptrs_jit_var_t handleCustomAbiReturn(jit_function_t func, ptrs_function_t *ast, jit_value_t jitRet)
@@ -446,6 +1131,14 @@ static jit_type_t getCustomAbiReturnType(ptrs_function_t *ast)
 			return ptrs_jit_getVarType();
 	}
 }
+static bool returnsVar(ptrs_function_t *ast)
+{
+	uint8_t type = ast->retType.meta.type;
+	if(type == PTRS_TYPE_STRUCT)
+		return ptrs_meta_getPointer(ast->retType.meta) == NULL;
+	else
+		return type != PTRS_TYPE_UNDEFINED && type != PTRS_TYPE_INT && type != PTRS_TYPE_FLOAT;
+}
 static ptrs_jit_var_t callWithCustomAbi(jit_function_t func, jit_function_t uncheckedCallee, jit_value_t calleeParentFrame,
 	ptrs_function_t *ast, jit_value_t thisArg, size_t narg, ptrs_jit_var_t *args, int callflags)
 {
@@ -463,49 +1156,307 @@ static ptrs_jit_var_t callWithCustomAbi(jit_function_t func, jit_function_t unch
 	else
 	{
 		jit_type_t retType = getCustomAbiReturnType(ast);
-		jit_type_t signature = jit_type_create_signature(jit_abi_cdecl, retType, typeDef, customAbiArgCount, 0);
+		jit_type_t signature = ptrs_jit_getSignature(jit_abi_cdecl, retType, typeDef, customAbiArgCount);
+
+		jit_value_t closure = jit_const_int(func, void_ptr, (uintptr_t)jit_function_to_closure(uncheckedCallee));
+
+		jitRet = jit_insn_call_nested_indirect(func, closure, calleeParentFrame, signature,
+			jitArgs, customAbiArgCount, callflags);
+	}
+
+	return handleCustomAbiReturn(func, ast, jitRet);
+}
+
+// only int and float returns, declared or inferred, use a single register. a var is still returned as a
+// {value, meta} struct, libjit has no way to return it in two registers and passing the meta through a
+// slot of the caller would cost a store and a load on every return
+void ptrs_jit_returnFromFunction(jit_function_t func, ptrs_scope_t *scope, ptrs_jit_var_t val)
+{
+	int8_t retType = scope->returnType.type;
+	if(retType == PTRS_TYPE_UNDEFINED)
+		jit_insn_default_return(func);
+	else if(retType == PTRS_TYPE_INT)
+		jit_insn_return(func, ptrs_jit_reinterpretCast(func, val.val, jit_type_long));
+	else if(retType == PTRS_TYPE_FLOAT)
+		jit_insn_return(func, ptrs_jit_reinterpretCast(func, val.val, jit_type_float64));
+	else
+		jit_insn_return_struct_from_values(func, val.val, val.meta);
+}
+
+void ptrs_jit_returnPtrFromFunction(jit_function_t func, ptrs_scope_t *scope, jit_value_t addr)
+{
+	ptrs_jit_var_t ret;
+	ret.val = jit_insn_load_relative(func, addr, 0, jit_type_long);
+	ret.meta = jit_insn_load_relative(func, addr, sizeof(ptrs_val_t), jit_type_ulong);
+	ret.constType = -1;
+	ret.addressable = false;
+	ptrs_jit_returnFromFunction(func, scope, ret);
+}
+
+static void setSpecializedTyping(ptrs_function_t *ast, int8_t *argTypes, ptrs_meta_t *saved)
+{
+	ptrs_funcparameter_t *curr = ast->args;
+	for(int i = 0; curr != NULL; i++)
+	{
+		saved[i] = curr->typing.meta;
+		if(argTypes[i] != -1)
+		{
+			memset(&curr->typing.meta, 0, sizeof(ptrs_meta_t));
+			curr->typing.meta.type = argTypes[i];
+		}
+
+		curr = curr->next;
+	}
+}
+static void restoreTyping(ptrs_function_t *ast, ptrs_meta_t *saved)
+{
+	ptrs_funcparameter_t *curr = ast->args;
+	for(int i = 0; curr != NULL; i++)
+	{
+		curr->typing.meta = saved[i];
+		curr = curr->next;
+	}
+}
+
+static jit_function_t getSpecialization(jit_function_t callee, ptrs_scope_t *scope,
+	ptrs_function_t *ast, ptrs_jit_var_t *args, int8_t *argTypes)
+{
+	if(!ast->canSpecialize || !ast->isBuilt)
+		return NULL; // the function is still being built (e.g. recursion) or might define structs
+
+	size_t argc = getParameterCount(ast);
+	bool hasTypes = false;
+
+	ptrs_funcparameter_t *curr = ast->args;
+	for(int i = 0; curr != NULL; i++)
+	{
+		int8_t type = args[i].constType;
+		if(curr->typing.meta.type == (uint8_t)-1 && curr->neverAssigned
+			&& (type == PTRS_TYPE_INT || type == PTRS_TYPE_FLOAT))
+		{
+			argTypes[i] = type;
+			hasTypes = true;
+		}
+		else
+		{
+			argTypes[i] = -1;
+		}
+
+		curr = curr->next;
+	}
+
+	if(!hasTypes)
+		return NULL;
+
+	int count = 0;
+	struct ptrs_specialization *spec = ast->specializations;
+	for(; spec != NULL; spec = spec->next)
+	{
+		if(memcmp(spec->argTypes, argTypes, argc) == 0)
+			return spec->func;
+		count++;
+	}
+
+	ptrs_ast_t *funcNode = jit_function_get_meta(callee, PTRS_JIT_FUNCTIONMETA_AST);
+	if(count >= ptrs_maxSpecializations || funcNode == NULL)
+		return NULL;
+
+	ptrs_meta_t saved[argc];
+	setSpecializedTyping(ast, argTypes, saved);
+
+	jit_function_t parent = jit_function_get_nested_parent(callee);
+	jit_function_t clone = ptrs_jit_createFunctionFromAst(funcNode, parent, ast);
+
+	char *name = malloc(strlen(ast->name) + strlen(".specialized") + 1);
+	sprintf(name, "%s.specialized", ast->name);
+	jit_function_set_meta(clone, PTRS_JIT_FUNCTIONMETA_NAME, name, NULL, 0);
+
+	ptrs_jit_buildFunction(funcNode, clone, scope, ast, ast->thisType);
+	restoreTyping(ast, saved);
+
+	spec = malloc(sizeof(struct ptrs_specialization) + argc);
+	spec->func = clone;
+	memcpy(spec->argTypes, argTypes, argc);
+	spec->next = ast->specializations;
+	ast->specializations = spec;
+
+	return clone;
+}
+
+static ptrs_jit_var_t callNested(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	jit_value_t thisPtr, jit_function_t callee, size_t narg, ptrs_jit_var_t *args, int callflags)
+{
+	ptrs_function_t *calleeAst = jit_function_get_meta(callee, PTRS_JIT_FUNCTIONMETA_FUNCAST);
+	if(calleeAst == NULL)
+		ptrs_error(node, "Internal error: Could not get function ast for unchecked entry point of target function");
+
+	checkFunctionParameter(node, func, scope, calleeAst, args);
+
+	// call a clone of the function compiled for the types of the arguments if possible
+	int8_t argTypes[getParameterCount(calleeAst) + 1];
+	jit_function_t specialized = getSpecialization(callee, scope, calleeAst, args, argTypes);
+	if(specialized != NULL)
+	{
+		for(int i = 0; i < narg; i++)
+		{
+			if(i < sizeof(argTypes) - 1 && argTypes[i] == PTRS_TYPE_FLOAT)
+				args[i].val = ptrs_jit_reinterpretCast(func, args[i].val, jit_type_float64);
+		}
+
+		ptrs_meta_t saved[sizeof(argTypes)];
+		setSpecializedTyping(calleeAst, argTypes, saved);
+		ptrs_jit_var_t ret = callWithCustomAbi(func, specialized, NULL, calleeAst, thisPtr, narg, args, callflags);
+		restoreTyping(calleeAst, saved);
+
+		return ret;
+	}
+
+	return callWithCustomAbi(func, callee, NULL, calleeAst, thisPtr, narg, args, callflags);
+}
+
+// stores variadic arguments in a var[] living in the frame of the caller
+static ptrs_jit_var_t packVarArgs(jit_function_t func, size_t count, ptrs_jit_var_t *values)
+{
+	ptrs_jit_var_t ret;
+	ret.meta = ptrs_jit_const_arrayMeta(func, count, PTRS_NATIVETYPE_INDEX_VAR);
+	ret.constType = PTRS_TYPE_POINTER;
+	ret.addressable = false;
+
+	if(count == 0)
+	{
+		ret.val = jit_const_long(func, long, 0);
+		return ret;
+	}
+
+	jit_value_t size = jit_const_int(func, nuint, count * sizeof(ptrs_var_t));
+	jit_value_t area = ptrs_jit_allocate(func, size, true, true);
+	for(int i = 0; i < count; i++)
+	{
+		jit_value_t val = ptrs_jit_reinterpretCast(func, values[i].val, jit_type_long);
+		jit_insn_store_relative(func, area, i * sizeof(ptrs_var_t), val);
+		jit_insn_store_relative(func, area, i * sizeof(ptrs_var_t) + sizeof(ptrs_val_t), values[i].meta);
+	}
+
+	ret.val = ptrs_jit_reinterpretCast(func, area, jit_type_long);
+	return ret;
+}
+
+ptrs_jit_var_t ptrs_jit_ncallnested(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	jit_value_t thisPtr, jit_function_t callee, size_t narg, ptrs_jit_var_t *args)
+{
+	ptrs_function_t *calleeAst = jit_function_get_meta(callee, PTRS_JIT_FUNCTIONMETA_FUNCAST);
+	if(calleeAst == NULL || calleeAst->vararg == NULL)
+		return callNested(node, func, scope, thisPtr, callee, narg, args, 0);
+
+	size_t argc = getParameterCount(calleeAst);
+	ptrs_jit_var_t _args[argc + 1];
+	for(int i = 0; i < argc; i++)
+	{
+		if(i < narg)
+		{
+			_args[i] = args[i];
+		}
+		else
+		{
+			_args[i].val = jit_const_int(func, long, 0);
+			_args[i].meta = ptrs_jit_const_meta(func, PTRS_TYPE_UNDEFINED);
+			_args[i].constType = PTRS_TYPE_UNDEFINED;
+			_args[i].addressable = false;
+		}
+	}
+	_args[argc] = packVarArgs(func, narg > argc ? narg - argc : 0, args + argc);
+
+	return callNested(node, func, scope, thisPtr, callee, argc + 1, _args, 0);
+}
+
+static int getArgumentCount(ptrs_function_t *calleeAst, struct ptrs_astlist *args)
+{
+	int minArgs = getParameterCount(calleeAst);
+	int narg = ptrs_astlist_length(args);
+	if(minArgs > narg)
+		narg = minArgs;
+
+	return narg;
+}
+static void evaluateArguments(jit_function_t func, ptrs_scope_t *scope,
+	struct ptrs_astlist *args, int narg, ptrs_jit_var_t *_args)
+{
+	for(int i = 0; i < narg; i++)
+	{
+		if(args == NULL || args->entry == NULL)
+		{
+			_args[i].val = jit_const_int(func, long, 0);
+			_args[i].meta = ptrs_jit_const_meta(func, PTRS_TYPE_UNDEFINED);
+			_args[i].constType = PTRS_TYPE_UNDEFINED;
+			_args[i].addressable = false;
+		}
+		else
+		{
+			_args[i] = args->entry->vtable->get(args->entry, func, scope);
+		}
+
+		if(args != NULL)
+			args = args->next;
+	}
+}
+
+// parameters without an argument before the expansion take the elements of the array,
+// a variadic function gets the elements left over without copying them
+static void expandArguments(jit_function_t func, ptrs_function_t *ast,
+	int narg, ptrs_jit_var_t *args, ptrs_jit_var_t array)
+{
+	int argc = getParameterCount(ast);
+	jit_value_t size = ptrs_jit_getArraySize(func, array.meta);
+
+	for(int i = narg; i < argc; i++)
+	{
+		args[i].val = jit_value_create(func, jit_type_long);
+		args[i].meta = jit_value_create(func, jit_type_ulong);
+		args[i].constType = -1;
+		args[i].addressable = false;
+
+		jit_label_t missing = jit_label_undefined;
+		jit_label_t done = jit_label_undefined;
+		jit_insn_branch_if_not(func,
+			jit_insn_lt(func, jit_const_long(func, ulong, i - narg), size), &missing);
 
-		jit_value_t closure = jit_const_int(func, void_ptr, (uintptr_t)jit_function_to_closure(uncheckedCallee));
+		ptrs_jit_var_t element = loadExpandedArgument(func, array.val, i - narg);
+		jit_insn_store(func, args[i].val, element.val);
+		jit_insn_store(func, args[i].meta, element.meta);
+		jit_insn_branch(func, &done);
 
-		jitRet = jit_insn_call_nested_indirect(func, closure, calleeParentFrame, signature,
-			jitArgs, customAbiArgCount, callflags);
+		jit_insn_label(func, &missing);
+		jit_insn_store(func, args[i].val, jit_const_long(func, long, 0));
+		jit_insn_store(func, args[i].meta, ptrs_jit_const_meta(func, PTRS_TYPE_UNDEFINED));
 
-		jit_type_free(signature);
+		jit_insn_label(func, &done);
 	}
 
-	return handleCustomAbiReturn(func, ast, jitRet);
-}
+	if(ast->vararg == NULL)
+		return;
 
-void ptrs_jit_returnFromFunction(jit_function_t func, ptrs_scope_t *scope, ptrs_jit_var_t val)
-{
-	int8_t retType = scope->returnType.type;
-	if(retType == PTRS_TYPE_UNDEFINED)
-		jit_insn_default_return(func);
-	else if(retType == PTRS_TYPE_INT || retType == PTRS_TYPE_FLOAT)
-		jit_insn_return(func, val.val);
-	else
-		jit_insn_return_struct_from_values(func, val.val, val.meta);
-}
+	args[argc].constType = PTRS_TYPE_POINTER;
+	args[argc].addressable = false;
+	if(argc == narg)
+	{
+		args[argc].val = ptrs_jit_reinterpretCast(func, array.val, jit_type_long);
+		args[argc].meta = array.meta;
+		return;
+	}
 
-void ptrs_jit_returnPtrFromFunction(jit_function_t func, ptrs_scope_t *scope, jit_value_t addr)
-{
-	ptrs_jit_var_t ret;
-	ret.val = jit_insn_load_relative(func, addr, 0, jit_type_long);
-	ret.meta = jit_insn_load_relative(func, addr, sizeof(ptrs_val_t), jit_type_ulong);
-	ret.constType = -1;
-	ret.addressable = false;
-	ptrs_jit_returnFromFunction(func, scope, ret);
-}
+	jit_value_t skip = jit_const_long(func, ulong, argc - narg);
+	jit_value_t rest = jit_value_create(func, jit_type_ulong);
+	jit_insn_store(func, rest, jit_const_long(func, ulong, 0));
 
-ptrs_jit_var_t ptrs_jit_ncallnested(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
-	jit_value_t thisPtr, jit_function_t callee, size_t narg, ptrs_jit_var_t *args)
-{
-	ptrs_function_t *calleeAst = jit_function_get_meta(callee, PTRS_JIT_FUNCTIONMETA_FUNCAST);
-	if(calleeAst == NULL)
-		ptrs_error(node, "Internal error: Could not get function ast for unchecked entry point of target function");
+	jit_label_t empty = jit_label_undefined;
+	jit_insn_branch_if_not(func, jit_insn_gt(func, size, skip), &empty);
+	jit_insn_store(func, rest, jit_insn_sub(func, size, skip));
+	jit_insn_label(func, &empty);
 
-	checkFunctionParameter(node, func, scope, calleeAst, args);
-	return callWithCustomAbi(func, callee, NULL, calleeAst, thisPtr, narg, args, 0);
+	jit_value_t start = jit_insn_add(func, array.val,
+		jit_const_int(func, nuint, (argc - narg) * sizeof(ptrs_var_t)));
+	args[argc].val = ptrs_jit_reinterpretCast(func, start, jit_type_long);
+	args[argc].meta = ptrs_jit_arrayMetaKnownType(func, rest, PTRS_NATIVETYPE_INDEX_VAR);
 }
 
 ptrs_jit_var_t ptrs_jit_callnested(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
@@ -515,32 +1466,159 @@ ptrs_jit_var_t ptrs_jit_callnested(ptrs_ast_t *node, jit_function_t func, ptrs_s
 	if(calleeAst == NULL)
 		ptrs_error(node, "Internal error: Could not get function ast for unchecked entry point of target function");
 
-	int minArgs = getParameterCount(calleeAst);
-	int narg = ptrs_astlist_length(args);
-	if(minArgs > narg)
-		narg = minArgs;
+	ptrs_ast_t *expansion = getExpansion(args);
+	if(expansion == NULL)
+	{
+		int narg = getArgumentCount(calleeAst, args);
+		ptrs_jit_var_t _args[narg];
+		evaluateArguments(func, scope, args, narg, _args);
 
-	ptrs_jit_var_t _args[narg];
+		return ptrs_jit_ncallnested(node, func, scope, thisPtr, callee, narg, _args);
+	}
 
-	for(int i = 0; i < narg; i++)
+	int narg = ptrs_astlist_length(args) - 1;
+	int argc = getParameterCount(calleeAst);
+	if(calleeAst->vararg != NULL && narg > argc)
+		ptrs_error(expansion, "Function %s takes %d arguments before its variadic arguments, "
+			"an array can only be expanded after at most that many arguments", calleeAst->name, argc);
+
+	ptrs_jit_var_t _args[(narg > argc ? narg : argc) + 1];
+	evaluateArguments(func, scope, args, narg, _args);
+
+	ptrs_jit_var_t array = evaluateExpansion(func, scope, expansion);
+	expandArguments(func, calleeAst, narg, _args, array);
+
+	int count = calleeAst->vararg != NULL ? argc + 1 : argc;
+	return callNested(node, func, scope, thisPtr, callee, count, _args, 0);
+}
+
+static bool canLoopToSelf(ptrs_function_t *ast, ptrs_jit_var_t *args)
+{
+	if(ast->thisType != NULL || ast->vararg != NULL)
+		return false;
+
+	// default values are only applied in the body of functions using the default ABI
+	bool checksInBody = returnsVar(ast);
+
+	ptrs_funcparameter_t *curr = ast->args;
+	for(int i = 0; curr != NULL; i++)
 	{
-		if(args == NULL || args->entry == NULL)
+		uint8_t type = curr->typing.meta.type;
+		if(curr->arg.addressable)
+			return false;
+
+		if(type != (uint8_t)-1)
 		{
-			_args[i].val = jit_const_int(func, long, 0);
-			_args[i].meta = ptrs_jit_const_meta(func, PTRS_TYPE_UNDEFINED);
-			_args[i].constType = PTRS_TYPE_UNDEFINED;
-			_args[i].addressable = false;
+			// the parameter is stored without checks, make sure the type is known to be right
+			if((type != PTRS_TYPE_INT && type != PTRS_TYPE_FLOAT) || args[i].constType != type)
+				return false;
+
+			checksInBody = false;
 		}
-		else
+
+		curr = curr->next;
+	}
+
+	for(curr = ast->args; curr != NULL; curr = curr->next)
+	{
+		if(curr->argv != NULL && !checksInBody)
+			return false;
+	}
+
+	return true;
+}
+static void loopToSelf(jit_function_t func, ptrs_function_t *ast, ptrs_jit_var_t *args)
+{
+	size_t argc = getParameterCount(ast);
+	jit_value_t vals[argc];
+	jit_value_t metas[argc];
+
+	// copy all arguments first, they might refer to the current values of the parameters
+	ptrs_funcparameter_t *curr = ast->args;
+	for(int i = 0; curr != NULL; i++)
+	{
+		jit_type_t type = jit_type_long;
+		if(curr->typing.meta.type == PTRS_TYPE_FLOAT)
+			type = jit_type_float64;
+
+		vals[i] = jit_value_create(func, type);
+		jit_insn_store(func, vals[i], ptrs_jit_reinterpretCast(func, args[i].val, type));
+
+		if(curr->typing.meta.type == (uint8_t)-1)
 		{
-			_args[i] = args->entry->vtable->get(args->entry, func, scope);
+			metas[i] = jit_value_create(func, jit_type_ulong);
+			jit_insn_store(func, metas[i], args[i].meta);
 		}
 
-		if(args != NULL)
-			args = args->next;
+		curr = curr->next;
+	}
+
+	// see retrieveParameterArray for the layout of the parameters
+	size_t argPos = 1;
+	curr = ast->args;
+	for(int i = 0; curr != NULL; i++)
+	{
+		jit_insn_store(func, jit_value_get_param(func, argPos), vals[i]);
+		argPos++;
+
+		if(curr->typing.meta.type == (uint8_t)-1)
+		{
+			jit_insn_store(func, jit_value_get_param(func, argPos), metas[i]);
+			argPos++;
+		}
+
+		curr = curr->next;
+	}
+
+	jit_insn_branch(func, &ast->selfCallLabel);
+}
+
+bool ptrs_jit_tailCallNested(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	jit_function_t callee, struct ptrs_astlist *args)
+{
+	ptrs_function_t *calleeAst = jit_function_get_meta(callee, PTRS_JIT_FUNCTIONMETA_FUNCAST);
+	ptrs_function_t *funcAst = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_FUNCAST);
+	if(calleeAst == NULL || funcAst == NULL || funcAst->usesTryCatch
+		|| ptrs_jit_isFrameReferenced(func))
+		return false;
+
+	// variadic arguments might live in our frame
+	if(calleeAst->vararg != NULL || getExpansion(args) != NULL)
+		return false;
+
+	// the value returned by the callee is returned as is
+	if(memcmp(&calleeAst->retType.meta, &funcAst->retType.meta, sizeof(ptrs_meta_t)) != 0)
+		return false;
+
+	// the callee would get the frame we are replacing as its parent frame
+	if(jit_function_get_nested_parent(callee) == func)
+		return false;
+
+	int narg = getArgumentCount(calleeAst, args);
+	ptrs_jit_var_t _args[narg];
+	evaluateArguments(func, scope, args, narg, _args);
+
+	jit_value_t thisPtr = jit_const_int(func, void_ptr, 0);
+
+	// evaluating the arguments might have created references to our frame
+	if(ptrs_jit_isFrameReferenced(func))
+	{
+		ptrs_jit_var_t ret = ptrs_jit_ncallnested(node, func, scope, thisPtr, callee, narg, _args);
+		ret.val = ptrs_jit_reinterpretCast(func, ret.val, jit_type_long);
+		ptrs_jit_returnFromFunction(func, scope, ret);
+	}
+	else if(calleeAst == funcAst && canLoopToSelf(funcAst, _args))
+	{
+		loopToSelf(func, funcAst, _args);
+	}
+	else
+	{
+		ptrs_jit_var_t ret = callNested(node, func, scope, thisPtr, callee, narg, _args, JIT_CALL_TAIL);
+		ret.val = ptrs_jit_reinterpretCast(func, ret.val, jit_type_long);
+		ptrs_jit_returnFromFunction(func, scope, ret);
 	}
 
-	return ptrs_jit_ncallnested(node, func, scope, thisPtr, callee, narg, _args);
+	return true;
 }
 
 jit_function_t ptrs_jit_createFunction(ptrs_ast_t *node, jit_function_t parent,
@@ -575,11 +1653,8 @@ jit_function_t ptrs_jit_createFunctionFromAst(ptrs_ast_t *node, jit_function_t p
 	
 	jit_type_t retType = getCustomAbiReturnType(ast);
 
-	if(ast->vararg != NULL)
-		ptrs_error(ast->body, "Support for variadic argument functions is not implemented");
-
-	jit_type_t signature = jit_type_create_signature(jit_abi_cdecl,
-		retType, paramDef, count, 0);
+	jit_type_t signature = ptrs_jit_getSignature(jit_abi_cdecl,
+		retType, paramDef, count);
 
 	jit_function_t func = ptrs_jit_createFunction(node, parent, signature, ast->name);
 	jit_function_set_meta(func, PTRS_JIT_FUNCTIONMETA_FUNCAST, ast, NULL, 0);
@@ -590,22 +1665,15 @@ jit_function_t ptrs_jit_createFunctionFromAst(ptrs_ast_t *node, jit_function_t p
 	return func;
 }
 
-void *ptrs_jit_createCallback(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope, void *closure)
+// builds a function with a plain C signature calling `func` with the frame stored at `frameSlot`
+static jit_function_t buildCallback(ptrs_ast_t *node, jit_function_t func, void **frameSlot, const char *suffix)
 {
-	jit_function_t unchecked = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_UNCHECKED);
-	if(unchecked != NULL)
-		func = unchecked; // `func` is actually a type checking closure for `unchecked` 
-
-	void *callbackClosure = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_CALLBACK);
-	if(callbackClosure != NULL)
-		return callbackClosure;
-
 	char *funcName = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_NAME);
 	if(funcName == NULL)
 		funcName = "?";
 
-	char callbackName[strlen(".callback") + strlen(funcName) + 1];
-	sprintf(callbackName, "%s.callback", funcName);
+	char callbackName[strlen(suffix) + strlen(funcName) + 1];
+	sprintf(callbackName, "%s%s", funcName, suffix);
 
 	ptrs_function_t *ast = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_FUNCAST);
 	ptrs_funcparameter_t *curr;
@@ -634,16 +1702,15 @@ void *ptrs_jit_createCallback(ptrs_ast_t *node, jit_function_t func, ptrs_scope_
 	else
 		callbackReturnType = jit_type_long;
 
-	jit_type_t callbackSignature = jit_type_create_signature(jit_abi_cdecl, callbackReturnType, argDef, argc, 0);
+	jit_type_t callbackSignature = ptrs_jit_getSignature(jit_abi_cdecl, callbackReturnType, argDef, argc);
 	jit_function_t callback = ptrs_jit_createFunction(node, NULL, callbackSignature, strdup(callbackName));
 
-	// TODO currently this is hardcoded to the root frame
 	jit_value_t parentFrame = jit_insn_load_relative(callback,
-		jit_const_int(callback, void_ptr, (uintptr_t)scope->rootFrame),
+		jit_const_int(callback, void_ptr, (uintptr_t)frameSlot),
 		0, jit_type_void_ptr
 	);
 
-	ptrs_jit_var_t args[argc];
+	ptrs_jit_var_t args[argc + 1];
 
 	curr = ast->args;
 	for(int i = 0; i < argc; i++)
@@ -672,8 +1739,14 @@ void *ptrs_jit_createCallback(ptrs_ast_t *node, jit_function_t func, ptrs_scope_
 		curr = curr->next;
 	}
 
+	// the callback signature only has the declared parameters, native code
+	// cannot pass anything more so the variable arguments are always empty
+	int customArgc = argc;
+	if(ast->vararg != NULL)
+		args[customArgc++] = packVarArgs(callback, 0, NULL);
+
 	jit_value_t thisArg = jit_const_int(callback, void_ptr, 0);
-	ptrs_jit_var_t retVar = callWithCustomAbi(callback, func, parentFrame, ast, thisArg, argc, args, 0);
+	ptrs_jit_var_t retVar = callWithCustomAbi(callback, func, parentFrame, ast, thisArg, customArgc, args, 0);
 	jit_value_t ret = retVar.val;
 
 	if(ast->retType.nativetype != NULL)
@@ -684,67 +1757,205 @@ void *ptrs_jit_createCallback(ptrs_ast_t *node, jit_function_t func, ptrs_scope_
 
 		ret = jit_insn_convert(callback, ret, retType->jitType, 0);
 	}
+	else
+	{
+		ret = ptrs_jit_reinterpretCast(callback, ret, jit_type_long);
+	}
 
 	jit_insn_return(callback, ret);
 
 	if(ptrs_compileAot && jit_function_compile(callback) == 0)
 		ptrs_error(node, "Failed compiling function %s", callbackName);
 
+	return callback;
+}
+
+void *ptrs_jit_createCallback(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope, void *closure)
+{
+	jit_function_t unchecked = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_UNCHECKED);
+	if(unchecked != NULL)
+		func = unchecked; // `func` is actually a type checking closure for `unchecked`
+
+	void *callbackClosure = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_CALLBACK);
+	if(callbackClosure != NULL)
+		return callbackClosure;
+
+	jit_function_t callback = buildCallback(node, func, scope->rootFrame, ".callback");
+
 	callbackClosure = jit_function_to_closure(callback);
 	jit_function_set_meta(func, PTRS_JIT_FUNCTIONMETA_CALLBACK, callbackClosure, NULL, 0);
 	return callbackClosure;
 }
 
-void *ptrs_jit_function_to_closure(ptrs_ast_t *node, jit_function_t func)
+// a trampoline stays bound to its frame until it is released, C code may still hold it
+// binding a frame that is already bound reuses its trampoline, so a pool only grows to the
+// number of frames of its function that are bound at the same time
+typedef struct ptrs_trampolinepool
 {
-	jit_function_t closureFunc = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_CLOSURE);
-	if(closureFunc != NULL)
-		return jit_function_to_closure(closureFunc);
+	struct ptrs_trampoline *active; // most recently acquired first
+	struct ptrs_trampoline *free;
+} ptrs_trampolinepool_t;
+typedef struct ptrs_trampoline
+{
+	void *parentFrame; // read by the compiled callback on every call
+	void *code;
+	ptrs_trampolinepool_t *pool;
+	struct ptrs_trampoline *next;
+} ptrs_trampoline_t;
 
-	if(node == NULL)
-		node = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_AST);
-	if(node == NULL)
-		ptrs_error(NULL, "Cannot create a closure for a function, failed to get AST");
+// callbacks can be acquired and released by any thread, e.g. in a function started by pthread_create
+static pthread_mutex_t trampolineLock = PTHREAD_MUTEX_INITIALIZER;
 
-	ptrs_function_t *ast = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_FUNCAST);
-	if(ast == NULL)
-		ptrs_error(node, "Cannot create a closure for function, failed to get function AST");
+// wasBound is set when the frame already had a trampoline, which then must not be released
+static void *acquireTrampoline(void *closure, void *parentFrame, bool *wasBound)
+{
+	*wasBound = true;
+	jit_function_t func = jit_function_from_closure(ptrs_jit_context, closure);
+	if(func == NULL)
+		return closure; // not a PointerScript function
+
+	jit_function_t unchecked = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_UNCHECKED);
+	if(unchecked != NULL)
+		func = unchecked;
+
+	pthread_mutex_lock(&trampolineLock);
+
+	ptrs_trampolinepool_t *pool = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_TRAMPOLINES);
+	if(pool == NULL)
+	{
+		pool = calloc(1, sizeof(ptrs_trampolinepool_t));
+		jit_function_set_meta(func, PTRS_JIT_FUNCTIONMETA_TRAMPOLINES, pool, NULL, 0);
+	}
+
+	// registering the same closure again, e.g. in a loop, returns the same trampoline
+	ptrs_trampoline_t *trampoline = NULL;
+	ptrs_trampoline_t **prev = &pool->active;
+	while(*prev != NULL && (*prev)->parentFrame != parentFrame)
+		prev = &(*prev)->next;
+
+	*wasBound = *prev != NULL;
+	if(*prev != NULL)
+	{
+		trampoline = *prev;
+		*prev = trampoline->next;
+	}
+	else if(pool->free != NULL)
+	{
+		trampoline = pool->free;
+		pool->free = trampoline->next;
+	}
+	else
+	{
+		trampoline = malloc(sizeof(ptrs_trampoline_t));
+		trampoline->pool = pool;
+
+		ptrs_ast_t *node = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_AST);
+		jit_function_t callback = buildCallback(node, func, &trampoline->parentFrame, ".trampoline");
+		jit_function_set_meta(callback, PTRS_JIT_FUNCTIONMETA_TRAMPOLINES, trampoline, NULL, 0);
+		trampoline->code = jit_function_to_closure(callback);
+	}
+
+	trampoline->parentFrame = parentFrame;
+	trampoline->next = pool->active;
+	pool->active = trampoline;
+
+	pthread_mutex_unlock(&trampolineLock);
+	return trampoline->code;
+}
+
+void *ptrs_callback_acquire(void *closure, void *parentFrame)
+{
+	bool wasBound;
+	return acquireTrampoline(closure, parentFrame, &wasBound);
+}
+
+void ptrs_callback_release(void *callback)
+{
+	jit_function_t func = jit_function_from_closure(ptrs_jit_context, callback);
+	ptrs_trampoline_t *trampoline = func == NULL ? NULL
+		: jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_TRAMPOLINES);
+	if(trampoline == NULL)
+		return; // callbacks of root functions live as long as the function
+
+	pthread_mutex_lock(&trampolineLock);
+
+	ptrs_trampolinepool_t *pool = trampoline->pool;
+	ptrs_trampoline_t **prev = &pool->active;
+	while(*prev != NULL && *prev != trampoline)
+		prev = &(*prev)->next;
+
+	if(*prev != NULL) // otherwise already released
+	{
+		*prev = trampoline->next;
+		trampoline->parentFrame = NULL;
+		trampoline->next = pool->free;
+		pool->free = trampoline;
+	}
+
+	pthread_mutex_unlock(&trampolineLock);
+}
 
+// builds a wrapper taking all arguments as value and meta pairs, checking them before calling func
+// variadic functions get one wrapper per argument count, the arguments after the parameters are
+// packed into the variable arguments. PTRS_CHECKER_PACKED takes them as one more var[] pair instead
+#define PTRS_CHECKER_PACKED -1
+static jit_function_t buildChecker(ptrs_ast_t *node, jit_function_t func, ptrs_function_t *ast, int narg)
+{
 	size_t argc = getParameterCount(ast);
-	int jitArgc = argc * 2 + 1;
+	int pairs = narg == PTRS_CHECKER_PACKED ? argc + 1 : narg;
+	int jitArgc = pairs * 2 + 1;
 
 	jit_type_t argDef[jitArgc];
 	argDef[0] = jit_type_void_ptr;
-	for(int i = 0; i < argc; i++)
+	for(int i = 0; i < pairs; i++)
 	{
 		argDef[i * 2 + 1] = jit_type_long;
 		argDef[i * 2 + 2] = jit_type_ulong;
 	}
-	jit_type_t checkerSig = jit_type_create_signature(jit_abi_cdecl, ptrs_jit_getVarType(),
-		argDef, jitArgc, 0);
-
-	char checkerName[strlen(".checked") + strlen(ast->name) + 1];
-	sprintf(checkerName, "%s.checked", ast->name);
+	jit_type_t checkerSig = ptrs_jit_getSignature(jit_abi_cdecl, ptrs_jit_getVarType(),
+		argDef, jitArgc);
+
+	char checkerName[strlen(".checked") + strlen(ast->name) + 12];
+	if(narg == argc)
+		sprintf(checkerName, "%s.checked", ast->name);
+	else if(narg == PTRS_CHECKER_PACKED)
+		sprintf(checkerName, "%s.checked.packed", ast->name);
+	else
+		sprintf(checkerName, "%s.checked%d", ast->name, narg);
 
 	jit_function_t funcParent = jit_function_get_nested_parent(func);
 	jit_function_t checker = ptrs_jit_createFunction(node, funcParent, checkerSig, strdup(checkerName));
 	jit_function_set_meta(checker, PTRS_JIT_FUNCTIONMETA_UNCHECKED, func, NULL, 0);
 
 	jit_value_t thisArg = jit_value_get_param(checker, 0);
-	ptrs_jit_var_t args[argc];
-	for(int i = 0; i < argc; i++)
+	ptrs_jit_var_t params[pairs > argc ? pairs : argc];
+	for(int i = 0; i < pairs; i++)
 	{
-		args[i].val = jit_value_get_param(checker, i * 2 + 1);
-		args[i].meta = jit_value_get_param(checker, i * 2 + 2);
-		args[i].constType = -1;
-		args[i].addressable = false;
+		params[i].val = jit_value_get_param(checker, i * 2 + 1);
+		params[i].meta = jit_value_get_param(checker, i * 2 + 2);
+		params[i].constType = -1;
+		params[i].addressable = false;
+	}
+
+	ptrs_jit_var_t args[argc + 1];
+	memcpy(args, params, argc * sizeof(ptrs_jit_var_t));
+
+	size_t callArgc = argc;
+	if(ast->vararg != NULL && narg == PTRS_CHECKER_PACKED)
+	{
+		args[callArgc] = params[argc];
+		args[callArgc++].constType = PTRS_TYPE_POINTER;
+	}
+	else if(ast->vararg != NULL)
+	{
+		args[callArgc++] = packVarArgs(checker, narg - argc, params + argc);
 	}
 
 	ptrs_scope_t checkerScope;
 	ptrs_initScope(&checkerScope, NULL);
 
 	checkFunctionParameter(node, checker, &checkerScope, ast, args);
-	ptrs_jit_var_t ret = callWithCustomAbi(checker, func, NULL, ast, thisArg, argc, args, JIT_CALL_TAIL);
+	ptrs_jit_var_t ret = callWithCustomAbi(checker, func, NULL, ast, thisArg, callArgc, args, JIT_CALL_TAIL);
 
 	jit_insn_return_struct_from_values(checker, ret.val, ret.meta);
 
@@ -754,10 +1965,188 @@ void *ptrs_jit_function_to_closure(ptrs_ast_t *node, jit_function_t func)
 	if(ptrs_compileAot && jit_function_compile(checker) == 0)
 		ptrs_error(node, "Failed compiling function %s", checkerName);
 
+	return checker;
+}
+
+void *ptrs_jit_function_to_closure(ptrs_ast_t *node, jit_function_t func)
+{
+	jit_function_t closureFunc = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_CLOSURE);
+	if(closureFunc != NULL)
+		return jit_function_to_closure(closureFunc);
+
+	if(node == NULL)
+		node = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_AST);
+	if(node == NULL)
+		ptrs_error(NULL, "Cannot create a closure for a function, failed to get AST");
+
+	ptrs_function_t *ast = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_FUNCAST);
+	if(ast == NULL)
+		ptrs_error(node, "Cannot create a closure for function, failed to get function AST");
+
+	// variadic functions called with more arguments use getVariadicClosure, see callThroughInlineCache
+	jit_function_t checker = buildChecker(node, func, ast, getParameterCount(ast));
 	jit_function_set_meta(func, PTRS_JIT_FUNCTIONMETA_CLOSURE, checker, NULL, 0);
 	return jit_function_to_closure(checker);
 }
 
+struct ptrs_variadicclosure
+{
+	int narg;
+	void *closure;
+	struct ptrs_variadicclosure *next;
+};
+static pthread_mutex_t variadicLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *getVariadicClosure(jit_function_t func, int narg)
+{
+	pthread_mutex_lock(&variadicLock);
+
+	struct ptrs_variadicclosure *curr = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_VARIADICCLOSURES);
+	struct ptrs_variadicclosure *first = curr;
+	for(; curr != NULL; curr = curr->next)
+	{
+		if(curr->narg == narg)
+			break;
+	}
+
+	if(curr == NULL)
+	{
+		ptrs_ast_t *node = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_AST);
+		ptrs_function_t *ast = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_FUNCAST);
+
+		curr = malloc(sizeof(struct ptrs_variadicclosure));
+		curr->narg = narg;
+		curr->closure = jit_function_to_closure(buildChecker(node, func, ast, narg));
+		curr->next = first;
+		jit_function_set_meta(func, PTRS_JIT_FUNCTIONMETA_VARIADICCLOSURES, curr, NULL, 0);
+	}
+
+	pthread_mutex_unlock(&variadicLock);
+	return curr->closure;
+}
+
+ptrs_jit_invoker_t ptrs_jit_getInvoker(jit_function_t func)
+{
+	void *invokerClosure = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_INVOKER);
+	if(invokerClosure != NULL)
+		return invokerClosure;
+
+	ptrs_ast_t *node = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_AST);
+	ptrs_function_t *ast = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_FUNCAST);
+	if(ast == NULL)
+		ptrs_error(node, "Cannot create an invoker for function, failed to get function AST");
+
+	// variadic functions get the arguments after the parameters packed into one more pair
+	size_t argc = getParameterCount(ast);
+	int jitArgc = (ast->vararg != NULL ? argc + 1 : argc) * 2 + 1;
+	void *closure;
+	if(ast->vararg != NULL)
+		closure = getVariadicClosure(func, PTRS_CHECKER_PACKED);
+	else
+		closure = ptrs_jit_function_to_closure(node, func);
+
+	jit_type_t argDef[jitArgc];
+	argDef[0] = jit_type_void_ptr;
+	for(int i = 1; i < jitArgc; i += 2)
+	{
+		argDef[i] = jit_type_long;
+		argDef[i + 1] = jit_type_ulong;
+	}
+	jit_type_t checkerSig = ptrs_jit_getSignature(jit_abi_cdecl, ptrs_jit_getVarType(),
+		argDef, jitArgc);
+
+	ptrs_jit_reusableSignature(invoker, invokerSig, ptrs_jit_getVarType(),
+		(jit_type_void_ptr, jit_type_void_ptr, jit_type_int, jit_type_void_ptr));
+
+	char invokerName[strlen(".invoker") + strlen(ast->name) + 1];
+	sprintf(invokerName, "%s.invoker", ast->name);
+
+	jit_function_t invoker = ptrs_jit_createFunction(node, NULL, invokerSig, strdup(invokerName));
+
+	jit_value_t parentFrame = jit_value_get_param(invoker, 0);
+	jit_value_t count = jit_value_get_param(invoker, 2);
+	jit_value_t argv = jit_value_get_param(invoker, 3);
+
+	jit_value_t args[jitArgc];
+	args[0] = jit_value_get_param(invoker, 1);
+	for(int i = 0; i < argc; i++)
+	{
+		jit_value_t val = jit_value_create(invoker, jit_type_long);
+		jit_value_t meta = jit_value_create(invoker, jit_type_ulong);
+
+		// arguments the caller did not pass are undefined
+		jit_label_t missing = jit_label_undefined;
+		jit_label_t done = jit_label_undefined;
+		jit_insn_branch_if_not(invoker,
+			jit_insn_lt(invoker, jit_const_int(invoker, int, i * 2 + 1), count), &missing);
+
+		jit_value_t valPtr = jit_insn_load_relative(invoker, argv, i * 2 * sizeof(void *), jit_type_void_ptr);
+		jit_value_t metaPtr = jit_insn_load_relative(invoker, argv, (i * 2 + 1) * sizeof(void *), jit_type_void_ptr);
+		jit_insn_store(invoker, val, jit_insn_load_relative(invoker, valPtr, 0, jit_type_long));
+		jit_insn_store(invoker, meta, jit_insn_load_relative(invoker, metaPtr, 0, jit_type_ulong));
+		jit_insn_branch(invoker, &done);
+
+		jit_insn_label(invoker, &missing);
+		jit_insn_store(invoker, val, jit_const_long(invoker, long, 0));
+		jit_insn_store(invoker, meta, ptrs_jit_const_meta(invoker, PTRS_TYPE_UNDEFINED));
+
+		jit_insn_label(invoker, &done);
+		args[i * 2 + 1] = val;
+		args[i * 2 + 2] = meta;
+	}
+
+	if(ast->vararg != NULL)
+	{
+		jit_value_t extra = jit_value_create(invoker, jit_type_int);
+		jit_label_t hasExtra = jit_label_undefined;
+		jit_insn_store(invoker, extra, jit_insn_sub(invoker,
+			jit_insn_shr(invoker, count, jit_const_int(invoker, int, 1)), jit_const_int(invoker, int, argc)));
+		jit_insn_branch_if(invoker, jit_insn_ge(invoker, extra, jit_const_int(invoker, int, 0)), &hasExtra);
+		jit_insn_store(invoker, extra, jit_const_int(invoker, int, 0));
+		jit_insn_label(invoker, &hasExtra);
+
+		jit_value_t size = jit_insn_mul(invoker, jit_insn_convert(invoker, extra, jit_type_nuint, 0),
+			jit_const_int(invoker, nuint, sizeof(ptrs_var_t)));
+		jit_value_t area = ptrs_jit_allocate(invoker, size, true, false);
+
+		jit_value_t index = jit_value_create(invoker, jit_type_int);
+		jit_label_t loop = jit_label_undefined;
+		jit_label_t end = jit_label_undefined;
+		jit_insn_store(invoker, index, jit_const_int(invoker, int, 0));
+		jit_insn_label(invoker, &loop);
+		jit_insn_branch_if_not(invoker, jit_insn_lt(invoker, index, extra), &end);
+
+		jit_value_t argIndex = jit_insn_mul(invoker,
+			jit_insn_add(invoker, index, jit_const_int(invoker, int, argc)), jit_const_int(invoker, int, 2));
+		jit_value_t valPtr = jit_insn_load_elem(invoker, argv, argIndex, jit_type_void_ptr);
+		jit_value_t metaPtr = jit_insn_load_elem(invoker, argv,
+			jit_insn_add(invoker, argIndex, jit_const_int(invoker, int, 1)), jit_type_void_ptr);
+
+		jit_value_t element = jit_insn_load_elem_address(invoker, area, index, ptrs_jit_getVarType());
+		jit_insn_store_relative(invoker, element, 0, jit_insn_load_relative(invoker, valPtr, 0, jit_type_long));
+		jit_insn_store_relative(invoker, element, sizeof(ptrs_val_t),
+			jit_insn_load_relative(invoker, metaPtr, 0, jit_type_ulong));
+
+		jit_insn_store(invoker, index, jit_insn_add(invoker, index, jit_const_int(invoker, int, 1)));
+		jit_insn_branch(invoker, &loop);
+		jit_insn_label(invoker, &end);
+
+		args[argc * 2 + 1] = ptrs_jit_reinterpretCast(invoker, area, jit_type_long);
+		args[argc * 2 + 2] = ptrs_jit_arrayMetaKnownType(invoker, extra, PTRS_NATIVETYPE_INDEX_VAR);
+	}
+
+	jit_value_t ret = jit_insn_call_nested_indirect(invoker, jit_const_int(invoker, void_ptr, (uintptr_t)closure),
+		parentFrame, checkerSig, args, jitArgc, 0);
+	jit_insn_return(invoker, ret);
+
+	if(ptrs_compileAot && jit_function_compile(invoker) == 0)
+		ptrs_error(node, "Failed compiling function %s", invokerName);
+
+	invokerClosure = jit_function_to_closure(invoker);
+	jit_function_set_meta(func, PTRS_JIT_FUNCTIONMETA_INVOKER, invokerClosure, NULL, 0);
+	return invokerClosure;
+}
+
 void ptrs_jit_buildFunction(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
 	ptrs_function_t *ast, ptrs_struct_t *thisType)
 {
@@ -765,6 +2154,9 @@ void ptrs_jit_buildFunction(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t
 	ptrs_initScope(&funcScope, scope);
 	funcScope.returnType = ast->retType.meta;
 
+	ast->isBuilt = false;
+	ast->thisType = thisType;
+
 	jit_insn_mark_offset(func, node->codepos);
 
 	if(thisType == NULL)
@@ -782,7 +2174,11 @@ void ptrs_jit_buildFunction(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t
 		ast->thisVal.addressable = false;
 	}
 
-	bool usesCustomAbi = retrieveParameterArray(ast, func);
+	// functions returning a value in a register need a .checked closure returning a ptrs_var_t
+	bool usesCustomAbi = retrieveParameterArray(ast, func) || !returnsVar(ast);
+
+	ast->selfCallLabel = jit_label_undefined;
+	jit_insn_label(func, &ast->selfCallLabel);
 
 	if(!usesCustomAbi)
 	{
@@ -798,6 +2194,7 @@ void ptrs_jit_buildFunction(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t
 		if(curr->arg.addressable)
 		{
 			ptrs_jit_var_t param = curr->arg;
+			ptrs_jit_markFrameReferenced(func);
 			curr->arg.val = jit_value_create(func, ptrs_jit_getVarType());
 			jit_value_t ptr = jit_insn_address_of(func, curr->arg.val);
 			jit_insn_store_relative(func, ptr, 0, param.val);
@@ -822,4 +2219,6 @@ void ptrs_jit_buildFunction(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t
 
 	if(ptrs_compileAot && jit_function_compile(func) == 0)
 		ptrs_error(node, "Failed compiling function %s", ast->name);
+
+	ast->isBuilt = true;
 }
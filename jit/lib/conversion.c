@@ -14,6 +14,7 @@
 #include "../include/util.h"
 #include "../include/struct.h"
 #include "../include/run.h"
+#include "../include/report.h"
 #include "../jit.h"
 #include "jit/jit-function.h"
 #include "jit/jit-value.h"
@@ -148,7 +149,7 @@ jit_value_t ptrs_jit_vartoi(jit_function_t func, ptrs_jit_var_t val)
 			{
 				ptrs_meta_t meta = ptrs_jit_value_getMetaConstant(val.meta);
 				ptrs_struct_t *struc = ptrs_meta_getPointer(meta);
-				if(ptrs_struct_getOverload(struc, ptrs_handle_cast_builtin, true) == NULL)
+				if(ptrs_struct_getOverload(struc, PTRS_STRUCTOP_CAST, true) == NULL)
 					return val.val;
 			}
 			break; //use intrinsic
@@ -162,6 +163,7 @@ jit_value_t ptrs_jit_vartoi(jit_function_t func, ptrs_jit_var_t val)
 
 	jit_value_t ret;
 	val.val = ptrs_jit_reinterpretCast(func, val.val, jit_type_long);
+	ptrs_report_fallback(func, NULL, "int conversion");
 	ptrs_jit_reusableCall(func, ptrs_vartoi, ret, jit_type_long,
 		(jit_type_long, jit_type_ulong), (val.val, val.meta));
 
@@ -188,7 +190,7 @@ jit_value_t ptrs_jit_vartof(jit_function_t func, ptrs_jit_var_t val)
 			{
 				ptrs_meta_t meta = ptrs_jit_value_getMetaConstant(val.meta);
 				ptrs_struct_t *struc = ptrs_meta_getPointer(meta);
-				if(ptrs_struct_getOverload(struc, ptrs_handle_cast_builtin, true) == NULL)
+				if(ptrs_struct_getOverload(struc, PTRS_STRUCTOP_CAST, true) == NULL)
 					return jit_insn_convert(func, val.val, jit_type_float64, 0);
 			}
 			break; //use intrinsic
@@ -202,6 +204,7 @@ jit_value_t ptrs_jit_vartof(jit_function_t func, ptrs_jit_var_t val)
 
 	jit_value_t ret;
 	val.val = ptrs_jit_reinterpretCast(func, val.val, jit_type_long);
+	ptrs_report_fallback(func, NULL, "float conversion");
 	ptrs_jit_reusableCall(func, ptrs_vartof, ret, jit_type_float64,
 		(jit_type_long, jit_type_ulong), (val.val, val.meta));
 
@@ -230,7 +233,7 @@ const char *ptrs_ptoa(ptrs_val_t val, ptrs_meta_t meta, char *buff)
 const char *ptrs_stoa(ptrs_val_t val, ptrs_meta_t meta, char *buff)
 {
 	ptrs_struct_t *struc = ptrs_meta_getPointer(meta);
-	jit_function_t overload = ptrs_struct_getOverload(struc, ptrs_handle_tostring, val.ptrval != NULL);
+	jit_function_t overload = ptrs_struct_getOverload(struc, PTRS_STRUCTOP_TOSTRING, val.ptrval != NULL);
 	if(overload != NULL)
 	{
 		ptrs_var_t ret;
@@ -255,6 +258,10 @@ void ptrs_functoa(char *buff, ptrs_val_t val)
 		snprintf(buff, 32, "function:%p", val.ptrval);
 	}
 }
+void ptrs_maptoa(char *buff, ptrs_val_t val)
+{
+	snprintf(buff, 32, "map:%p", val.ptrval);
+}
 ptrs_jit_var_t ptrs_jit_vartoa(jit_function_t func, ptrs_jit_var_t val)
 {
 	jit_value_t buff;
@@ -264,6 +271,7 @@ ptrs_jit_var_t ptrs_jit_vartoa(jit_function_t func, ptrs_jit_var_t val)
 	if(val.constType == -1)
 	{
 		buff = jit_insn_array(func, 32);
+		ptrs_jit_markFrameReferenced(func);
 
 		val.val = ptrs_jit_reinterpretCast(func, val.val, jit_type_long);
 		jit_value_t retVal;
@@ -291,6 +299,7 @@ ptrs_jit_var_t ptrs_jit_vartoa(jit_function_t func, ptrs_jit_var_t val)
 		}
 
 		buff = jit_insn_array(func, 32);
+		ptrs_jit_markFrameReferenced(func);
 		ptrs_jit_var_t ret;
 		ret.constType = PTRS_TYPE_POINTER;
 		ret.val = buff;
@@ -339,6 +348,13 @@ ptrs_jit_var_t ptrs_jit_vartoa(jit_function_t func, ptrs_jit_var_t val)
 				(buff, val.val)
 			);
 		}
+		else if(val.constType == PTRS_TYPE_MAP)
+		{
+			ptrs_jit_reusableCallVoid(func, ptrs_maptoa,
+				(jit_type_void_ptr, jit_type_long),
+				(buff, val.val)
+			);
+		}
 		else
 		{
 			ptrs_error(NULL, "Cannot convert unknown type to string: %t", val.constType);
@@ -394,7 +410,7 @@ int64_t ptrs_vartoi(ptrs_val_t val, ptrs_meta_t meta)
 		case PTRS_TYPE_STRUCT:
 			;
 			ptrs_struct_t *struc = ptrs_meta_getPointer(meta);
-			jit_function_t overload = ptrs_struct_getOverload(struc, ptrs_handle_cast_builtin, val.ptrval != NULL);
+			jit_function_t overload = ptrs_struct_getOverload(struc, PTRS_STRUCTOP_CAST, val.ptrval != NULL);
 			if(overload != NULL)
 			{
 				ptrs_var_t ret;
@@ -440,7 +456,7 @@ double ptrs_vartof(ptrs_val_t val, ptrs_meta_t meta)
 		case PTRS_TYPE_STRUCT:
 			;
 			ptrs_struct_t *struc = ptrs_meta_getPointer(meta);
-			jit_function_t overload = ptrs_struct_getOverload(struc, ptrs_handle_cast_builtin, val.ptrval != NULL);
+			jit_function_t overload = ptrs_struct_getOverload(struc, PTRS_STRUCTOP_CAST, val.ptrval != NULL);
 			if(overload != NULL)
 			{
 				ptrs_var_t ret;
@@ -500,7 +516,7 @@ ptrs_var_t ptrs_vartoa(ptrs_val_t val, ptrs_meta_t meta, char *buff, size_t maxl
 		case PTRS_TYPE_STRUCT:
 			;
 			ptrs_struct_t *struc = ptrs_meta_getPointer(meta);
-			jit_function_t overload = ptrs_struct_getOverload(struc, ptrs_handle_tostring, val.ptrval != NULL);
+			jit_function_t overload = ptrs_struct_getOverload(struc, PTRS_STRUCTOP_TOSTRING, val.ptrval != NULL);
 			if(overload != NULL)
 			{
 				ptrs_var_t ret;
@@ -523,6 +539,9 @@ ptrs_var_t ptrs_vartoa(ptrs_val_t val, ptrs_meta_t meta, char *buff, size_t maxl
 				snprintf(buff, maxlen, "function:%p", val.ptrval);
 			}
 			break;
+		case PTRS_TYPE_MAP:
+			snprintf(buff, maxlen, "map:%p", val.ptrval);
+			break;
 	}
 
 	buff[maxlen - 1] = 0;
@@ -557,6 +576,7 @@ const char * const ptrs_typeStrings[] = {
 	[PTRS_TYPE_POINTER] = "pointer",
 	[PTRS_TYPE_STRUCT] = "struct",
 	[PTRS_TYPE_FUNCTION] = "function",
+	[PTRS_TYPE_MAP] = "map",
 };
 const char *ptrs_typetoa(ptrs_vartype_t type)
 {
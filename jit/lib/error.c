@@ -457,13 +457,12 @@ void ptrs_jit_placeAssertions(jit_function_t func, ptrs_scope_t *scope)
 		for(int i = 0; i < curr->argCount; i++)
 			argDef[i] = jit_type_void_ptr;
 
-		jit_type_t signature = jit_type_create_signature(jit_abi_vararg, jit_type_void, argDef, curr->argCount, 1);
+		jit_type_t signature = ptrs_jit_getSignature(jit_abi_vararg, jit_type_void, argDef, curr->argCount);
 		jit_insn_call_native(func, "ptrs_error", ptrs_error, signature, curr->args, curr->argCount, JIT_CALL_NORETURN);
 
 		struct ptrs_assertion *old = curr;
 		curr = curr->next;
 
-		jit_type_free(signature);
 		free(argDef);
 		free(old);
 	}
@@ -7,6 +7,8 @@
 #include "../include/conversion.h"
 #include "../include/error.h"
 #include "../include/util.h"
+#include "../include/report.h"
+#include "../include/structarray.h"
 #include "../ops/intrinsics.h"
 #include "../jit.h"
 
@@ -17,6 +19,7 @@ typedef struct
 	uint8_t knownValue : 1;
 	uint8_t knownMeta : 1;
 	uint8_t knownType : 1;
+	uint8_t knownArray : 1; // meta is an array of structs, only its size is unknown
 } ptrs_prediction_t;
 
 typedef struct ptrs_flowprediction
@@ -28,13 +31,55 @@ typedef struct ptrs_flowprediction
 	struct ptrs_flowprediction *next;
 } ptrs_predictions_t;
 
+typedef struct ptrs_flowescape
+{
+	ptrs_jit_var_t *variable;
+	ptrs_ast_t *allocation; // new or array expression the variable was initialized with
+	ptrs_struct_t *struc; // type of the allocation or of 'this' inside a struct function
+	struct ptrs_astlist *deletes;
+	unsigned depth;
+	uint8_t escapes : 1;
+	uint8_t isThis : 1;
+	uint8_t isAssigned : 1;
+	struct ptrs_flowescape *next;
+} ptrs_escapes_t;
+
+typedef struct ptrs_flowfield
+{
+	struct ptrs_structmember *member; // NULL for writes to members called name of any struct
+	const char *name;
+	size_t namelen;
+	ptrs_prediction_t prediction;
+	struct ptrs_flowfield *next;
+} ptrs_fieldpredictions_t;
+
+typedef struct
+{
+	ptrs_escapes_t *escapes;
+	ptrs_fieldpredictions_t *fields;
+	struct ptrs_astlist *structs;
+	bool hasDynamicWrites; // any member of any struct might be written
+} ptrs_flowstate_t;
+
+typedef struct
+{
+	uint8_t type; // PTRS_NUM_TYPES before the first return
+	bool mixed; // values of different types were returned
+	bool hasUnknown; // a value of unknown type was returned
+} ptrs_returns_t;
+
 typedef struct
 {
 	bool dryRun;
 	bool endsInDead;
 	bool inTryBlock;
+	bool borrowing;
+	bool definesStructs;
 	unsigned depth;
+	ptrs_function_t *function; // NULL for the root function
+	ptrs_returns_t *returns; // NULL when the return type of the function is not inferred
 	ptrs_predictions_t *predictions;
+	ptrs_flowstate_t *state;
 	//...
 } ptrs_flow_t;
 
@@ -47,6 +92,8 @@ typedef struct
 
 static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_prediction_t *ret);
 static void analyzeStatement(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_prediction_t *ret);
+static bool analyzeFunctionBody(ptrs_flow_t *outerFlow, ptrs_function_t *ast, ptrs_struct_t *thisType,
+	ptrs_returns_t *returns);
 
 bool ptrs_dumpFlow = false;
 static int preductionDumpOrder(ptrs_prediction_dump_t *a, ptrs_prediction_dump_t *b)
@@ -176,6 +223,7 @@ static inline void clearPrediction(ptrs_prediction_t *prediction)
 	prediction->knownType = false;
 	prediction->knownValue = false;
 	prediction->knownMeta = false;
+	prediction->knownArray = false;
 }
 
 static void dupFlow(ptrs_flow_t *dest, ptrs_flow_t *src)
@@ -206,6 +254,53 @@ static void freePredictions(ptrs_predictions_t *curr)
 	}
 }
 
+static bool isStructArrayPrediction(ptrs_prediction_t *prediction)
+{
+	return prediction->knownType && (prediction->knownMeta || prediction->knownArray)
+		&& ptrs_structarray_isArray(prediction->meta);
+}
+
+static void mergePrediction(ptrs_prediction_t *dest, ptrs_prediction_t *src)
+{
+	int8_t currType = dest->meta.type;
+
+	// arrays of the same struct keep a known struct even if their sizes differ
+	ptrs_meta_t arrayMeta = dest->meta;
+	bool sameArray = isStructArrayPrediction(dest) && isStructArrayPrediction(src)
+		&& dest->meta.array.structId == src->meta.array.structId;
+
+	if(!dest->knownMeta || !src->knownMeta
+		|| memcmp(&dest->meta, &src->meta, sizeof(ptrs_meta_t)))
+	{
+		dest->knownMeta = false;
+		memset(&dest->meta, 0, sizeof(ptrs_meta_t));
+	}
+
+	if(!dest->knownType || !src->knownType
+		|| currType != src->meta.type)
+	{
+		dest->knownType = false;
+	}
+	else
+	{
+		dest->meta.type = currType;
+	}
+
+	if(!dest->knownMeta || !src->knownMeta
+		|| memcmp(&dest->value, &src->value, sizeof(ptrs_val_t)))
+	{
+		dest->knownValue = false;
+		memset(&dest->value, 0, sizeof(ptrs_val_t));
+	}
+
+	dest->knownArray = sameArray && !dest->knownMeta;
+	if(dest->knownArray)
+	{
+		dest->meta = arrayMeta;
+		dest->meta.array.size = 0;
+	}
+}
+
 static void mergePredictions(ptrs_flow_t *dest, ptrs_flow_t *srcFlow)
 {
 	ptrs_predictions_t *src = srcFlow->predictions;
@@ -240,32 +335,7 @@ static void mergePredictions(ptrs_flow_t *dest, ptrs_flow_t *srcFlow)
 		{
 			if(curr->variable == src->variable && curr->depth == src->depth)
 			{
-				int8_t currType = curr->prediction.meta.type;
-
-				if(!curr->prediction.knownMeta || !src->prediction.knownMeta
-					|| memcmp(&curr->prediction.meta, &src->prediction.meta, sizeof(ptrs_meta_t)))
-				{
-					curr->prediction.knownMeta = false;
-					memset(&curr->prediction.meta, 0, sizeof(ptrs_meta_t));
-				}
-
-				if(!curr->prediction.knownType || !src->prediction.knownType
-					|| currType != src->prediction.meta.type)
-				{
-					curr->prediction.knownType = false;
-				}
-				else
-				{
-					curr->prediction.meta.type = currType;
-				}
-
-				if(!curr->prediction.knownMeta || !src->prediction.knownMeta
-					|| memcmp(&curr->prediction.value, &src->prediction.value, sizeof(ptrs_val_t)))
-				{
-					curr->prediction.knownValue = false;
-					memset(&curr->prediction.value, 0, sizeof(ptrs_val_t));
-				}
-
+				mergePrediction(&curr->prediction, &src->prediction);
 				found = true;
 				break;
 			}
@@ -358,6 +428,10 @@ static void setVariablePrediction(ptrs_flow_t *flow, ptrs_jit_var_t *var, ptrs_p
 						|| memcmp(&curr->prediction.meta, &prediction->meta, sizeof(ptrs_meta_t)) != 0)
 						curr->prediction.knownMeta = false;
 
+					if(curr->prediction.knownArray != prediction->knownArray
+						|| memcmp(&curr->prediction.meta, &prediction->meta, sizeof(ptrs_meta_t)) != 0)
+						curr->prediction.knownArray = false;
+
 					if(curr->prediction.knownValue != prediction->knownValue
 						|| memcmp(&curr->prediction.value, &prediction->value, sizeof(ptrs_val_t)) != 0)
 						curr->prediction.knownValue = false;
@@ -423,7 +497,7 @@ static void getVariablePrediction(ptrs_flow_t *flow, ptrs_jit_var_t *var, ptrs_p
 }
 
 static void clearAddressablePredictionsIfOverloadExists(ptrs_flow_t *flow,
-	ptrs_struct_t *struc, void *overload)
+	ptrs_struct_t *struc, enum ptrs_structop overload)
 {
 	if(struc == NULL)
 	{
@@ -438,7 +512,7 @@ static void clearAddressablePredictionsIfOverloadExists(ptrs_flow_t *flow,
 	}
 }
 static void clearAddressablePredictionsIfOverloadExistsOrUnavailable(
-	ptrs_flow_t *flow, ptrs_prediction_t *prediction, void *overload)
+	ptrs_flow_t *flow, ptrs_prediction_t *prediction, enum ptrs_structop overload)
 {
 	if(prediction->knownType && prediction->knownMeta
 		&& prediction->meta.type == PTRS_TYPE_STRUCT)
@@ -449,12 +523,154 @@ static void clearAddressablePredictionsIfOverloadExistsOrUnavailable(
 		else
 			clearAddressablePredictionsIfOverloadExists(flow, struc, overload);
 	}
+	else if(prediction->knownType && prediction->meta.type == PTRS_TYPE_MAP)
+	{
+		// maps have no overloads
+	}
 	else
 	{
 		clearAddressablePredictions(flow);
 	}
 }
 
+static ptrs_escapes_t *getEscapeInfo(ptrs_flow_t *flow, ptrs_jit_var_t *var)
+{
+	ptrs_escapes_t *curr = flow->state->escapes;
+	while(curr != NULL)
+	{
+		if(curr->variable == var)
+		{
+			// the variable is used by a nested function
+			if(curr->depth != flow->depth)
+				curr->escapes = true;
+
+			return curr;
+		}
+
+		curr = curr->next;
+	}
+
+	curr = calloc(1, sizeof(ptrs_escapes_t));
+	curr->variable = var;
+	curr->depth = flow->depth;
+	curr->next = flow->state->escapes;
+	flow->state->escapes = curr;
+	return curr;
+}
+static void escapeVariable(ptrs_flow_t *flow, ptrs_ast_t *node)
+{
+	if(node != NULL && node->vtable == &ptrs_ast_vtable_identifier)
+		getEscapeInfo(flow, node->arg.identifier.location)->escapes = true;
+}
+static void setAllocation(ptrs_flow_t *flow, ptrs_jit_var_t *var,
+	ptrs_ast_t *value, ptrs_prediction_t *prediction)
+{
+	ptrs_escapes_t *info = getEscapeInfo(flow, var);
+
+	if(value == NULL || (value->vtable != &ptrs_ast_vtable_new && value->vtable != &ptrs_ast_vtable_array))
+		return;
+
+	info->allocation = value;
+	if(value->vtable == &ptrs_ast_vtable_array || flow->dryRun)
+		return;
+
+	// only instances of a struct known at compile time get a constant size
+	ptrs_struct_t *struc = NULL;
+	if(prediction->knownType && prediction->knownMeta && prediction->meta.type == PTRS_TYPE_STRUCT
+		&& value->arg.newexpr.value->vtable == &ptrs_ast_vtable_identifier)
+		struc = ptrs_meta_getPointer(prediction->meta);
+
+	if(struc == NULL || (info->struc != NULL && info->struc != struc))
+		info->escapes = true;
+	else
+		info->struc = struc;
+}
+
+static void addFieldPrediction(ptrs_flow_t *flow, struct ptrs_structmember *member,
+	const char *name, size_t namelen, ptrs_prediction_t *prediction)
+{
+	if(flow->dryRun)
+		return;
+
+	ptrs_fieldpredictions_t *curr = flow->state->fields;
+	while(curr != NULL)
+	{
+		if(member != NULL && curr->member == member)
+		{
+			mergePrediction(&curr->prediction, prediction);
+			return;
+		}
+		else if(member == NULL && curr->member == NULL
+			&& curr->namelen == namelen && strncmp(curr->name, name, namelen) == 0)
+		{
+			return;
+		}
+
+		curr = curr->next;
+	}
+
+	curr = malloc(sizeof(ptrs_fieldpredictions_t));
+	curr->member = member;
+	curr->name = name;
+	curr->namelen = namelen;
+	memcpy(&curr->prediction, prediction, sizeof(ptrs_prediction_t));
+	curr->next = flow->state->fields;
+	flow->state->fields = curr;
+}
+static void analyzeMemberWrite(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_prediction_t *base,
+	const char *name, size_t namelen, ptrs_prediction_t *value)
+{
+	if(flow->dryRun)
+		return;
+
+	if(base->knownType && base->knownMeta && base->meta.type == PTRS_TYPE_STRUCT)
+	{
+		ptrs_struct_t *struc = ptrs_meta_getPointer(base->meta);
+		if(struc == NULL || name == NULL)
+		{
+			flow->state->hasDynamicWrites = true;
+			return;
+		}
+
+		struct ptrs_structmember *member = ptrs_struct_find(struc,
+			name, namelen, PTRS_STRUCTMEMBER_GETTER, node);
+
+		if(member != NULL && member->type == PTRS_STRUCTMEMBER_VAR)
+			addFieldPrediction(flow, member, NULL, 0, value);
+	}
+	else if(base->knownType && base->meta.type != PTRS_TYPE_STRUCT)
+	{
+		// not a struct, no members are written
+	}
+	else if(name != NULL)
+	{
+		addFieldPrediction(flow, NULL, name, namelen, value);
+	}
+	else
+	{
+		flow->state->hasDynamicWrites = true;
+	}
+}
+static void analyzeIndexWrite(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_prediction_t *base,
+	ptrs_prediction_t *key, ptrs_prediction_t *value)
+{
+	if(key->knownType && key->knownValue && key->meta.type == PTRS_TYPE_POINTER
+		&& key->meta.array.typeIndex == PTRS_NATIVETYPE_INDEX_CHAR)
+	{
+		const char *name = key->value.ptrval;
+		analyzeMemberWrite(flow, node, base, name, strnlen(name, key->meta.array.size), value);
+	}
+	else if(key->knownType && (key->meta.type == PTRS_TYPE_INT || key->meta.type == PTRS_TYPE_FLOAT)
+		&& !(base->knownType && base->meta.type == PTRS_TYPE_STRUCT))
+	{
+		// indexing an array
+	}
+	else
+	{
+		analyzeMemberWrite(flow, node, base, NULL, 0, value);
+	}
+}
+
 static bool prediction2bool(ptrs_prediction_t *prediction, bool *ret)
 {
 	if(!prediction->knownType || !prediction->knownValue)
@@ -518,7 +734,7 @@ static void structMemberPrediction(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_str
 
 	if(member == NULL)
 	{
-		clearAddressablePredictionsIfOverloadExists(flow, struc, ptrs_handle_member);
+		clearAddressablePredictionsIfOverloadExists(flow, struc, PTRS_STRUCTOP_MEMBER);
 		clearPrediction(ret);
 		return;
 	}
@@ -582,6 +798,23 @@ static void analyzeStatementList(ptrs_flow_t *flow, struct ptrs_astlist *list, p
 	}
 }
 
+static void addReturnPrediction(ptrs_returns_t *returns, ptrs_prediction_t *value)
+{
+	// return; has no value, functions with a return type cannot use it
+	if(value == NULL)
+	{
+		returns->mixed = true;
+		return;
+	}
+
+	if(!value->knownType)
+		returns->hasUnknown = true;
+	else if(returns->type == PTRS_NUM_TYPES)
+		returns->type = value->meta.type;
+	else if(returns->type != value->meta.type)
+		returns->mixed = true;
+}
+
 static void analyzeFunction(ptrs_flow_t *outerFlow, ptrs_function_t *ast, ptrs_struct_t *thisType)
 {
 	ptrs_prediction_t prediction;
@@ -592,14 +825,86 @@ static void analyzeFunction(ptrs_flow_t *outerFlow, ptrs_function_t *ast, ptrs_s
 		//in a dry run we analyze the function in the outer flow to make sure addressable bits
 		// for values used by the inner function are set globally
 		outerFlow->depth++;
+
+		if(thisType != NULL)
+		{
+			ptrs_escapes_t *info = getEscapeInfo(outerFlow, &ast->thisVal);
+			info->isThis = true;
+			info->struc = thisType;
+		}
+
+		bool definesStructs = outerFlow->definesStructs;
+		outerFlow->definesStructs = false;
+
 		analyzeStatement(outerFlow, ast->body, &prediction);
+
+		// compiling the body again would define its structs twice
+		ast->canSpecialize = !outerFlow->definesStructs;
+		outerFlow->definesStructs = outerFlow->definesStructs || definesStructs;
+
+		for(ptrs_funcparameter_t *curr = ast->args; curr != NULL; curr = curr->next)
+			curr->neverAssigned = !getEscapeInfo(outerFlow, &curr->arg)->isAssigned;
+
 		outerFlow->depth--;
 		return;
 	}
 
+	if(ast->retTypeInferred)
+	{
+		// the body is analyzed again, e.g. in a loop or while inferring an outer function
+		ast->retTypeInferred = false;
+		ast->retType.meta.type = (uint8_t)-1;
+	}
+
+	if(ast->retType.meta.type != (uint8_t)-1)
+	{
+		analyzeFunctionBody(outerFlow, ast, thisType, NULL);
+		return;
+	}
+
+	// functions always returning an int or float return it in a register instead of a ptrs_var_t
+	ptrs_returns_t returns = {PTRS_NUM_TYPES, false, false};
+	bool endsInDead = analyzeFunctionBody(outerFlow, ast, thisType, &returns);
+
+	uint8_t type = returns.type;
+	if(!endsInDead || returns.mixed || (type != PTRS_TYPE_INT && type != PTRS_TYPE_FLOAT))
+		return;
+
+	if(returns.hasUnknown)
+	{
+		// values returned by recursive calls are unknown until we assume the return type
+		memset(&ast->retType.meta, 0, sizeof(ptrs_meta_t));
+		ast->retType.meta.type = type;
+
+		returns = (ptrs_returns_t){PTRS_NUM_TYPES, false, false};
+		endsInDead = analyzeFunctionBody(outerFlow, ast, thisType, &returns);
+
+		if(!endsInDead || returns.mixed || returns.hasUnknown || returns.type != type)
+		{
+			// redo the analysis so no prediction relies on the wrong assumption
+			ast->retType.meta.type = (uint8_t)-1;
+			analyzeFunctionBody(outerFlow, ast, thisType, NULL);
+			return;
+		}
+	}
+
+	memset(&ast->retType.meta, 0, sizeof(ptrs_meta_t));
+	ast->retType.meta.type = type;
+	ast->retTypeInferred = true;
+}
+
+static bool analyzeFunctionBody(ptrs_flow_t *outerFlow, ptrs_function_t *ast, ptrs_struct_t *thisType,
+	ptrs_returns_t *returns)
+{
+	ptrs_prediction_t prediction;
+
 	ptrs_flow_t functionFlow;
 	dupFlow(&functionFlow, outerFlow);
 	functionFlow.depth++;
+	functionFlow.function = ast;
+	functionFlow.returns = returns;
+	functionFlow.endsInDead = false;
+	functionFlow.inTryBlock = false;
 
 	clearAddressablePredictions(&functionFlow);
 	clearPrediction(&prediction);
@@ -617,6 +922,10 @@ static void analyzeFunction(ptrs_flow_t *outerFlow, ptrs_function_t *ast, ptrs_s
 		setVariablePrediction(&functionFlow, &curr->arg, &prediction);
 	}
 
+	// variadic arguments are always passed as a var[]
+	clearPrediction(&prediction);
+	prediction.knownType = true;
+	prediction.meta.type = PTRS_TYPE_POINTER;
 	setVariablePrediction(&functionFlow, ast->vararg, &prediction);
 
 	if(thisType != NULL)
@@ -632,6 +941,14 @@ static void analyzeFunction(ptrs_flow_t *outerFlow, ptrs_function_t *ast, ptrs_s
 
 	// instead of merging predictions we just drop the inner prediction
 	freePredictions(functionFlow.predictions);
+	return functionFlow.endsInDead;
+}
+
+// analyzes an expression whose value is only accessed but not stored anywhere
+static void analyzeBorrowed(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_prediction_t *ret)
+{
+	flow->borrowing = node != NULL && node->vtable == &ptrs_ast_vtable_identifier;
+	analyzeExpression(flow, node, ret);
 }
 
 static void analyzeLValue(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_prediction_t *value)
@@ -640,6 +957,8 @@ static void analyzeLValue(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_prediction_t
 
 	if(node->vtable == &ptrs_ast_vtable_identifier)
 	{
+		escapeVariable(flow, node);
+		getEscapeInfo(flow, node->arg.identifier.location)->isAssigned = true;
 		setVariablePrediction(flow, node->arg.varval, value);
 	}
 	else if(node->vtable == &ptrs_ast_vtable_prefix_dereference)
@@ -650,14 +969,17 @@ static void analyzeLValue(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_prediction_t
 	else if(node->vtable == &ptrs_ast_vtable_index)
 	{
 		struct ptrs_ast_binary *expr = &node->arg.binary;
-		analyzeExpression(flow, expr->left, &dummy);
-		analyzeExpression(flow, expr->right, &dummy);
+		ptrs_prediction_t key;
+		analyzeBorrowed(flow, expr->left, &dummy);
+		analyzeExpression(flow, expr->right, &key);
+		analyzeIndexWrite(flow, node, &dummy, &key, value);
 	}
 	else if(node->vtable == &ptrs_ast_vtable_member)
 	{
 		struct ptrs_ast_member *expr = &node->arg.member;
-		analyzeExpression(flow, expr->base, &dummy);
-		clearAddressablePredictionsIfOverloadExistsOrUnavailable(flow, &dummy, ptrs_assign_member);
+		analyzeBorrowed(flow, expr->base, &dummy);
+		analyzeMemberWrite(flow, node, &dummy, expr->name, expr->namelen, value);
+		clearAddressablePredictionsIfOverloadExistsOrUnavailable(flow, &dummy, PTRS_STRUCTOP_ASSIGN_MEMBER);
 	}
 	else if(node->vtable == &ptrs_ast_vtable_importedsymbol)
 	{
@@ -892,6 +1214,11 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 	{
 		struct ptrs_ast_identifier *expr = &node->arg.identifier;
 
+		ptrs_escapes_t *escapeInfo = getEscapeInfo(flow, expr->location);
+		if(!flow->borrowing)
+			escapeInfo->escapes = true;
+		flow->borrowing = false;
+
 		getVariablePrediction(flow, expr->location, ret);
 
 		if(!flow->dryRun)
@@ -925,12 +1252,23 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 			{
 				expr->typePredicted = false;
 			}
+
+			if(!ret->knownMeta && isStructArrayPrediction(ret))
+			{
+				expr->arrayPredicted = true;
+				memcpy(&expr->metaPrediction, &ret->meta, sizeof(ptrs_meta_t));
+			}
+			else
+			{
+				expr->arrayPredicted = false;
+			}
 		}
 		else
 		{
 			expr->valuePredicted = false;
 			expr->metaPredicted = false;
 			expr->typePredicted = false;
+			expr->arrayPredicted = false;
 		}
 	}
 	else if(node->vtable == &ptrs_ast_vtable_functionidentifier)
@@ -963,6 +1301,8 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 			ret->meta = stmt->meta;
 		}
 
+		analyzeList(flow, stmt->initVal, &dummy);
+
 		ret->knownType = true;
 		ret->meta.type = PTRS_TYPE_POINTER;
 	}
@@ -979,8 +1319,17 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 	{
 		struct ptrs_ast_call *expr = &node->arg.call;
 		analyzeExpression(flow, expr->value, ret);
+		ptrs_prediction_t calleePrediction = *ret;
+		bool isNative = !calleePrediction.knownType || calleePrediction.meta.type != PTRS_TYPE_FUNCTION;
 
-		analyzeList(flow, expr->arguments, &dummy);
+		for(struct ptrs_astlist *curr = expr->arguments; curr != NULL; curr = curr->next)
+		{
+			analyzeExpression(flow, curr->entry, &dummy);
+
+			// native functions get a pointer to the data of struct arguments
+			if(isNative && dummy.knownType && dummy.meta.type == PTRS_TYPE_STRUCT)
+				flow->state->hasDynamicWrites = true;
+		}
 
 		if(ret->knownType && ret->meta.type == PTRS_TYPE_POINTER)
 		{
@@ -990,7 +1339,13 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 
 			memset(&ret->meta, 0, sizeof(ptrs_meta_t));
 
-			if(expr->typing.nativetype != NULL)
+			struct ptrs_ffideclaration *ffi = NULL;
+			if(expr->value->vtable == &ptrs_ast_vtable_importedsymbol)
+				ffi = expr->value->arg.importedsymbol.ffi;
+
+			if(ffi != NULL)
+				ret->meta.type = ffi->retType == NULL ? PTRS_TYPE_UNDEFINED : ffi->retType->varType;
+			else if(expr->typing.nativetype != NULL)
 				ret->meta.type = expr->typing.nativetype->varType;
 			else if(expr->typing.meta.type != (uint8_t)-1)
 				memcpy(&ret->meta, &expr->typing.meta, sizeof(ptrs_meta_t));
@@ -1015,9 +1370,27 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 			clearPrediction(ret);
 		}
 
+		// the base of a member call is passed as 'this', which is only safe for
+		// functions of the struct itself
+		ptrs_ast_t *callee = expr->value;
+		if(!flow->dryRun && (callee->vtable == &ptrs_ast_vtable_member || callee->vtable == &ptrs_ast_vtable_index)
+			&& (!calleePrediction.knownType || !calleePrediction.knownValue
+				|| calleePrediction.meta.type != PTRS_TYPE_FUNCTION))
+		{
+			if(callee->vtable == &ptrs_ast_vtable_member)
+				escapeVariable(flow, callee->arg.member.base);
+			else
+				escapeVariable(flow, callee->arg.binary.left);
+		}
+
 		// TODO only reset predictions of varibles used in the function
 		clearAddressablePredictions(flow);
 	}
+	else if(node->vtable == &ptrs_ast_vtable_expand)
+	{
+		analyzeExpression(flow, node->arg.astval, ret);
+		clearPrediction(ret);
+	}
 	else if(node->vtable == &ptrs_ast_vtable_stringformat)
 	{
 		struct ptrs_ast_strformat *expr = &node->arg.strformat;
@@ -1050,7 +1423,7 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 			if(ret->knownMeta)
 			{
 				ptrs_struct_t *struc = ptrs_meta_getPointer(ret->meta);
-				clearAddressablePredictionsIfOverloadExists(flow, struc, ptrs_handle_new);
+				clearAddressablePredictionsIfOverloadExists(flow, struc, PTRS_STRUCTOP_NEW);
 			}
 			else
 			{
@@ -1063,10 +1436,57 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 			clearAddressablePredictions(flow);
 		}
 	}
+	else if(node->vtable == &ptrs_ast_vtable_map)
+	{
+		struct ptrs_ast_map *expr = &node->arg.map;
+		analyzeList(flow, expr->keys, &dummy);
+		analyzeList(flow, expr->values, &dummy);
+
+		ret->knownType = true;
+		ret->knownMeta = true;
+		ret->knownValue = false;
+		memset(&ret->meta, 0, sizeof(ptrs_meta_t));
+		ret->meta.type = PTRS_TYPE_MAP;
+	}
+	else if(node->vtable == &ptrs_ast_vtable_structarray)
+	{
+		struct ptrs_ast_structarray *expr = &node->arg.structarray;
+
+		ptrs_prediction_t length;
+		analyzeExpression(flow, expr->length, &length);
+		analyzeExpression(flow, expr->constructor, ret);
+
+		ptrs_struct_t *struc = NULL;
+		if(ret->knownType && ret->knownMeta && ret->meta.type == PTRS_TYPE_STRUCT)
+			struc = ptrs_meta_getPointer(ret->meta);
+
+		// every element is constructed
+		clearAddressablePredictionsIfOverloadExists(flow, struc, PTRS_STRUCTOP_NEW);
+
+		ret->knownType = true;
+		ret->knownValue = false;
+		if(struc != NULL && length.knownType && length.knownValue && length.meta.type == PTRS_TYPE_INT)
+		{
+			ret->knownMeta = true;
+			ret->meta = ptrs_structarray_getMeta(node, struc, expr->soa, length.value.intval);
+		}
+		else if(struc != NULL)
+		{
+			// the length is only known at runtime, but indexing still knows the struct
+			ret->knownMeta = false;
+			ret->knownArray = true;
+			ret->meta = ptrs_structarray_getMeta(node, struc, expr->soa, 0);
+		}
+		else
+		{
+			ret->knownMeta = false;
+			ret->meta.type = PTRS_TYPE_POINTER;
+		}
+	}
 	else if(node->vtable == &ptrs_ast_vtable_member)
 	{
 		struct ptrs_ast_member *expr = &node->arg.member;
-		analyzeExpression(flow, expr->base, ret);
+		analyzeBorrowed(flow, expr->base, ret);
 
 		if(ret->knownType && ret->knownMeta
 			&& ret->meta.type == PTRS_TYPE_STRUCT)
@@ -1082,7 +1502,7 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 	}
 	else if(node->vtable == &ptrs_ast_vtable_prefix_sizeof)
 	{
-		analyzeExpression(flow, node->arg.astval, ret);
+		analyzeBorrowed(flow, node->arg.astval, ret);
 
 		ret->knownValue = false;
 		if(ret->knownType && ret->knownMeta)
@@ -1122,6 +1542,7 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 		{
 			struct ptrs_ast_identifier *expr = &target->arg.identifier;
 			setAddressable(flow, expr->location);
+			getEscapeInfo(flow, expr->location)->isAssigned = true; // might be written through the pointer
 
 			ret->knownType = true;
 			ret->knownValue = false;
@@ -1136,6 +1557,10 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 			struct ptrs_ast_member *expr = &target->arg.member;
 			analyzeExpression(flow, expr->base, ret);
 
+			// the member can be written through the pointer
+			clearPrediction(&dummy);
+			analyzeMemberWrite(flow, target, ret, expr->name, expr->namelen, &dummy);
+
 			if(ret->knownType && ret->knownMeta && ret->meta.type == PTRS_TYPE_STRUCT)
 			{
 				ptrs_struct_t *struc = ptrs_meta_getPointer(ret->meta);
@@ -1165,7 +1590,7 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 				}
 				else
 				{
-					clearAddressablePredictionsIfOverloadExists(flow, struc, ptrs_handle_member);
+					clearAddressablePredictionsIfOverloadExists(flow, struc, PTRS_STRUCTOP_MEMBER);
 					clearPrediction(ret);
 				}
 			}
@@ -1178,11 +1603,15 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 		}
 		else if(target->vtable == &ptrs_ast_vtable_index)
 		{
-			struct ptrs_ast_binary *expr = &node->arg.binary;
+			struct ptrs_ast_binary *expr = &target->arg.binary;
 
 			analyzeExpression(flow, expr->left, ret);
 			analyzeExpression(flow, expr->right, &dummy);
 
+			ptrs_prediction_t unknown;
+			clearPrediction(&unknown);
+			analyzeIndexWrite(flow, target, ret, &dummy, &unknown);
+
 			if(ret->knownType && ret->meta.type == PTRS_TYPE_POINTER)
 			{
 				if(dummy.knownType && dummy.knownValue && dummy.meta.type == PTRS_TYPE_INT)
@@ -1202,7 +1631,7 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 			}
 			else
 			{
-				clearAddressablePredictionsIfOverloadExistsOrUnavailable(flow, ret, ptrs_handle_prefix_address);
+				clearAddressablePredictionsIfOverloadExistsOrUnavailable(flow, ret, PTRS_STRUCTOP_ADDRESSOF_MEMBER);
 				clearPrediction(ret);
 			}
 		}
@@ -1241,10 +1670,16 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 	{
 		struct ptrs_ast_binary *expr = &node->arg.binary;
 
-		analyzeExpression(flow, expr->left, ret);
+		analyzeBorrowed(flow, expr->left, ret);
 		analyzeExpression(flow, expr->right, &dummy);
 
-		if(ret->knownType && ret->knownMeta && ret->meta.type == PTRS_TYPE_POINTER && ret->meta.array.typeIndex != PTRS_NATIVETYPE_INDEX_VAR)
+		if(ret->knownType && ret->knownMeta && ptrs_structarray_isArray(ret->meta)
+			&& !ptrs_structarray_isSoa(ret->meta))
+		{
+			ret->knownValue = false;
+			ret->meta = ptrs_structarray_getElementMeta(ret->meta);
+		}
+		else if(ret->knownType && ret->knownMeta && ret->meta.type == PTRS_TYPE_POINTER && ret->meta.array.typeIndex != PTRS_NATIVETYPE_INDEX_VAR)
 		{
 			ret->knownType = true;
 			ret->knownValue = false;
@@ -1299,6 +1734,11 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 
 		analyzeExpression(flow, expr->value, ret);
 
+		// the pointer might point to the data of a struct
+		if(expr->meta.type == PTRS_TYPE_POINTER
+			&& (!ret->knownType || ret->meta.type != PTRS_TYPE_POINTER))
+			flow->state->hasDynamicWrites = true;
+
 		if(ret->knownType && ret->knownValue && ret->meta.type == PTRS_TYPE_FUNCTION)
 		{
 			ret->knownValue = false;
@@ -1315,6 +1755,9 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 		analyzeExpression(flow, expr->value, &dummy);
 		analyzeExpression(flow, expr->type, ret);
 
+		// members of the struct can now be written through the original pointer
+		flow->state->hasDynamicWrites = true;
+
 		if(!ret->knownType || ret->meta.type != PTRS_TYPE_STRUCT)
 		{
 			clearPrediction(ret);
@@ -1418,7 +1861,7 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 	}
 	else if(node->vtable == &ptrs_ast_vtable_prefix_typeof)
 	{
-		analyzeExpression(flow, node->arg.astval, ret);
+		analyzeBorrowed(flow, node->arg.astval, ret);
 
 		if(ret->knownType)
 		{
@@ -1492,7 +1935,7 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 		char buff[32];
 		char *key = prediction2str(&dummy, buff, 32);
 
-		clearAddressablePredictionsIfOverloadExistsOrUnavailable(flow, ret, ptrs_handle_op_in);
+		clearAddressablePredictionsIfOverloadExistsOrUnavailable(flow, ret, PTRS_STRUCTOP_IN);
 
 		ret->knownValue = false;
 		if(ret->knownType && ret->knownMeta && key != NULL
@@ -1755,8 +2198,14 @@ static void analyzeExpression(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predicti
 			ptrs_error(node, "Cannot analyze expression");
 	}
 
+	// only these pass a struct array on as it is, other expressions may change or drop it
+	if(node->vtable != &ptrs_ast_vtable_identifier && node->vtable != &ptrs_ast_vtable_structarray)
+		ret->knownArray = false;
+
 	if(ptrs_dumpFlow && !flow->dryRun)
 		dumpPrediction(node, ret);
+	if(ptrs_predictionReport && !flow->dryRun)
+		ptrs_report_prediction(flow->function, node, ret->knownType, ret->knownMeta, ret->knownValue);
 }
 
 static void analyzeStatement(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_prediction_t *ret)
@@ -1780,6 +2229,7 @@ static void analyzeStatement(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predictio
 		struct ptrs_ast_define *stmt = &node->arg.define;
 		analyzeExpression(flow, stmt->value, ret);
 
+		setAllocation(flow, &stmt->location, stmt->value, ret);
 		setVariablePrediction(flow, &stmt->location, ret);
 	}
 	else if(node->vtable == &ptrs_ast_vtable_array)
@@ -1807,19 +2257,42 @@ static void analyzeStatement(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predictio
 	}
 	else if(node->vtable == &ptrs_ast_vtable_import)
 	{
-		//ignore
+		// imported scripts are not analyzed and might write to members of our structs
+		if(node->arg.import.isScriptImport)
+			flow->state->hasDynamicWrites = true;
 	}
 	else if(node->vtable == &ptrs_ast_vtable_return
 		|| node->vtable == &ptrs_ast_vtable_throw)
 	{
 		analyzeExpression(flow, node->arg.astval, ret);
 
+		if(node->vtable == &ptrs_ast_vtable_return && flow->returns != NULL && !flow->dryRun)
+			addReturnPrediction(flow->returns, node->arg.astval == NULL ? NULL : ret);
+
 		if(!flow->inTryBlock)
 			flow->endsInDead = true;
 	}
 	else if(node->vtable == &ptrs_ast_vtable_delete)
 	{
-		analyzeExpression(flow, node->arg.astval, ret);
+		struct ptrs_ast_delete *stmt = &node->arg.deletestmt;
+		analyzeBorrowed(flow, stmt->value, ret);
+
+		if(stmt->value->vtable == &ptrs_ast_vtable_identifier)
+		{
+			ptrs_escapes_t *info = getEscapeInfo(flow, stmt->value->arg.identifier.location);
+
+			struct ptrs_astlist *curr = info->deletes;
+			while(curr != NULL && curr->entry != node)
+				curr = curr->next;
+
+			if(curr == NULL)
+			{
+				curr = malloc(sizeof(struct ptrs_astlist));
+				curr->entry = node;
+				curr->next = info->deletes;
+				info->deletes = curr;
+			}
+		}
 	}
 	else if(node->vtable == &ptrs_ast_vtable_continue
 		|| node->vtable == &ptrs_ast_vtable_continue_label
@@ -1878,6 +2351,7 @@ static void analyzeStatement(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predictio
 	else if(node->vtable == &ptrs_ast_vtable_struct)
 	{
 		ptrs_struct_t *struc = &node->arg.structval;
+		flow->definesStructs = true;
 
 		for(int i = 0; i < struc->memberCount; i++)
 		{
@@ -1891,6 +2365,49 @@ static void analyzeStatement(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predictio
 			{
 				analyzeFunction(flow, curr->value.function.ast, struc);
 			}
+			else if(flow->dryRun && curr->type == PTRS_STRUCTMEMBER_VAR && curr->value.startval != NULL)
+			{
+				// initializers run inside the constructor
+				flow->depth++;
+				analyzeExpression(flow, curr->value.startval, &dummy);
+				flow->depth--;
+			}
+			else if(!flow->dryRun && curr->type == PTRS_STRUCTMEMBER_VAR)
+			{
+				// members without an initializer start out undefined
+				clearPrediction(&dummy);
+				dummy.knownType = true;
+				dummy.knownMeta = true;
+				dummy.meta.type = PTRS_TYPE_UNDEFINED;
+
+				if(curr->value.startval != NULL)
+				{
+					ptrs_flow_t initFlow;
+					dupFlow(&initFlow, flow);
+					initFlow.depth++;
+					clearAddressablePredictions(&initFlow);
+
+					analyzeExpression(&initFlow, curr->value.startval, &dummy);
+					freePredictions(initFlow.predictions);
+				}
+
+				addFieldPrediction(flow, curr, NULL, 0, &dummy);
+			}
+		}
+
+		if(!flow->dryRun)
+		{
+			struct ptrs_astlist *entry = flow->state->structs;
+			while(entry != NULL && entry->entry != node)
+				entry = entry->next;
+
+			if(entry == NULL)
+			{
+				entry = malloc(sizeof(struct ptrs_astlist));
+				entry->entry = node;
+				entry->next = flow->state->structs;
+				flow->state->structs = entry;
+			}
 		}
 
 		struct ptrs_opoverload *curr = struc->overloads;
@@ -2091,13 +2608,157 @@ static void analyzeStatement(ptrs_flow_t *flow, ptrs_ast_t *node, ptrs_predictio
 	}
 }
 
+#define PTRS_FLOW_MAXFRAMEALLOCATION 4096
+static bool structCanLiveInFrame(ptrs_escapes_t *escapes, ptrs_struct_t *struc)
+{
+	if(struc == NULL || struc->size > PTRS_FLOW_MAXFRAMEALLOCATION)
+		return false;
+
+	// array members hand out pointers into the instance
+	for(int i = 0; i < struc->memberCount; i++)
+	{
+		struct ptrs_structmember *curr = &struc->member[i];
+		if(curr->name != NULL && !curr->isStatic && curr->type == PTRS_STRUCTMEMBER_ARRAY)
+			return false;
+	}
+
+	// functions of the struct might store 'this' somewhere
+	while(escapes != NULL)
+	{
+		if(escapes->isThis && escapes->struc == struc && escapes->escapes)
+			return false;
+
+		escapes = escapes->next;
+	}
+
+	return true;
+}
+static void applyEscapes(ptrs_escapes_t *escapes)
+{
+	for(ptrs_escapes_t *curr = escapes; curr != NULL; curr = curr->next)
+	{
+		ptrs_ast_t *allocation = curr->allocation;
+		if(allocation == NULL || curr->escapes)
+			continue;
+
+		if(allocation->vtable == &ptrs_ast_vtable_new)
+		{
+			if(!structCanLiveInFrame(escapes, curr->struc))
+				continue;
+
+			allocation->arg.newexpr.noEscape = true;
+		}
+		else
+		{
+			// arrays with a dynamic size would need an alloca on every execution
+			struct ptrs_ast_definearray *expr = &allocation->arg.definearray;
+			if(expr->length != NULL)
+				continue;
+
+			ptrs_nativetype_info_t *type = ptrs_getNativeTypeForArray(allocation, expr->meta);
+			if(expr->meta.array.size * type->size > PTRS_FLOW_MAXFRAMEALLOCATION)
+				continue;
+
+			expr->noEscape = true;
+		}
+
+		for(struct ptrs_astlist *curr2 = curr->deletes; curr2 != NULL; curr2 = curr2->next)
+			curr2->entry->arg.deletestmt.noFree = true;
+	}
+
+	while(escapes != NULL)
+	{
+		ptrs_escapes_t *next = escapes->next;
+
+		struct ptrs_astlist *curr = escapes->deletes;
+		while(curr != NULL)
+		{
+			struct ptrs_astlist *next = curr->next;
+			free(curr);
+			curr = next;
+		}
+
+		free(escapes);
+		escapes = next;
+	}
+}
+
+static void applyFieldPredictions(ptrs_flowstate_t *state)
+{
+	for(struct ptrs_astlist *curr = state->structs; curr != NULL; curr = curr->next)
+	{
+		ptrs_struct_t *struc = &curr->entry->arg.structval;
+
+		for(int i = 0; i < struc->memberCount; i++)
+		{
+			struct ptrs_structmember *member = &struc->member[i];
+			if(member->name == NULL || member->type != PTRS_STRUCTMEMBER_VAR)
+				continue;
+
+			member->typePredicted = false;
+			member->metaPredicted = false;
+			if(state->hasDynamicWrites)
+				continue;
+
+			ptrs_prediction_t *prediction = NULL;
+			bool unknownWrite = false;
+			for(ptrs_fieldpredictions_t *field = state->fields; field != NULL; field = field->next)
+			{
+				if(field->member == member)
+					prediction = &field->prediction;
+				else if(field->member == NULL && field->namelen == member->namelen
+					&& strncmp(field->name, member->name, field->namelen) == 0)
+					unknownWrite = true;
+			}
+
+			if(prediction == NULL || unknownWrite || !prediction->knownType)
+				continue;
+
+			member->typePredicted = true;
+			if(prediction->knownMeta)
+			{
+				member->metaPredicted = true;
+				memcpy(&member->metaPrediction, &prediction->meta, sizeof(ptrs_meta_t));
+			}
+			else
+			{
+				memset(&member->metaPrediction, 0, sizeof(ptrs_meta_t));
+				member->metaPrediction.type = prediction->meta.type;
+			}
+		}
+	}
+
+	while(state->structs != NULL)
+	{
+		struct ptrs_astlist *next = state->structs->next;
+		free(state->structs);
+		state->structs = next;
+	}
+
+	while(state->fields != NULL)
+	{
+		ptrs_fieldpredictions_t *next = state->fields->next;
+		free(state->fields);
+		state->fields = next;
+	}
+}
+
 void ptrs_flow_analyze(ptrs_ast_t *ast)
 {
 	ptrs_prediction_t ret;
+	ptrs_flowstate_t state;
+	state.escapes = NULL;
+	state.fields = NULL;
+	state.structs = NULL;
+	state.hasDynamicWrites = false;
 
 	ptrs_flow_t flow;
 	flow.predictions = NULL;
+	flow.state = &state;
+	flow.borrowing = false;
+	flow.definesStructs = false;
 	flow.depth = 0;
+	flow.function = NULL;
 	flow.inTryBlock = false;
 
 	// make a dry run first to set addressable for variables used accross functions
@@ -2110,4 +2771,6 @@ void ptrs_flow_analyze(ptrs_ast_t *ast)
 	analyzeStatement(&flow, ast, &ret);
 
 	freePredictions(flow.predictions);
+	applyEscapes(state.escapes);
+	applyFieldPredictions(&state);
 }
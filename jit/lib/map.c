@@ -0,0 +1,462 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <jit/jit.h>
+
+#include "../../parser/common.h"
+#include "../../parser/ast.h"
+#include "../jit.h"
+
+#include "../include/error.h"
+#include "../include/util.h"
+#include "../include/map.h"
+
+// free slots have the highest bit of their control byte set, used slots store 7 bits of the hash
+#define PTRS_MAP_EMPTY 0x80
+#define PTRS_MAP_DELETED 0xFE
+
+// the control bytes of 8 slots are loaded into one integer and compared at once
+#define PTRS_MAP_GROUPSIZE 8
+#define PTRS_MAP_LSB 0x0101010101010101ULL
+#define PTRS_MAP_MSB 0x8080808080808080ULL
+
+static uint64_t loadGroup(ptrs_map_t *map, uint32_t group)
+{
+	uint64_t ctrl;
+	memcpy(&ctrl, map->control + group * PTRS_MAP_GROUPSIZE, sizeof(uint64_t));
+#if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	ctrl = __builtin_bswap64(ctrl);
+#endif
+	return ctrl;
+}
+
+// these return a mask having the highest bit of every matching byte set
+static uint64_t matchHash(uint64_t ctrl, uint8_t h2)
+{
+	// can report false positives after a real match, every candidate is compared anyways
+	uint64_t x = ctrl ^ (PTRS_MAP_LSB * h2);
+	return (x - PTRS_MAP_LSB) & ~x & PTRS_MAP_MSB;
+}
+static uint64_t matchEmpty(uint64_t ctrl)
+{
+	return ctrl & (~ctrl << 6) & PTRS_MAP_MSB;
+}
+static uint64_t matchFree(uint64_t ctrl)
+{
+	return ctrl & PTRS_MAP_MSB;
+}
+static uint32_t firstMatch(uint64_t mask)
+{
+	return __builtin_ctzll(mask) / 8;
+}
+
+static uint64_t hashInt(uint64_t hash)
+{
+	// finalizer of splitmix64
+	hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+	return hash ^ (hash >> 31);
+}
+static uint64_t hashString(const char *key, uint32_t size)
+{
+	// FNV-1a, mixed afterwards as the lowest bits are used for the control bytes
+	uint64_t hash = 14695981039346656037ULL;
+	for(uint32_t i = 0; i < size && key[i] != 0; i++)
+	{
+		hash ^= (uint8_t)key[i];
+		hash *= 1099511628211ULL;
+	}
+	return hashInt(hash);
+}
+uint64_t ptrs_map_hashKey(ptrs_ast_t *node, ptrs_val_t key, ptrs_meta_t keyMeta)
+{
+	if(keyMeta.type == PTRS_TYPE_INT)
+		return hashInt(key.intval);
+	else if(keyMeta.type == PTRS_TYPE_POINTER && keyMeta.array.typeIndex == PTRS_NATIVETYPE_INDEX_CHAR)
+		return hashString(key.ptrval, keyMeta.array.size);
+
+	ptrs_error(node, "Map keys need to be of type int or a string, not %m", keyMeta);
+	return 0;
+}
+
+static bool keyEquals(ptrs_mapentry_t *entry, ptrs_val_t key, ptrs_meta_t keyMeta, uint64_t hash)
+{
+	if(entry->hash != hash || entry->key.meta.type != keyMeta.type)
+		return false;
+	else if(keyMeta.type == PTRS_TYPE_INT)
+		return entry->key.value.intval == key.intval;
+
+	// stored keys are zero terminated copies
+	uint32_t len = strnlen(key.ptrval, keyMeta.array.size);
+	return entry->key.meta.array.size == len + 1
+		&& memcmp(entry->key.value.ptrval, key.ptrval, len) == 0;
+}
+
+// returns the slot referencing the entry of a key or -1
+static int64_t findSlot(ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta, uint64_t hash)
+{
+	uint32_t mask = map->slotCount / PTRS_MAP_GROUPSIZE - 1;
+	uint32_t group = (hash >> 7) & mask;
+	uint8_t h2 = hash & 0x7F;
+
+	for(uint32_t step = 1; ; step++)
+	{
+		uint64_t ctrl = loadGroup(map, group);
+		for(uint64_t match = matchHash(ctrl, h2); match != 0; match &= match - 1)
+		{
+			uint32_t slot = group * PTRS_MAP_GROUPSIZE + firstMatch(match);
+			if(keyEquals(&map->entries[map->slots[slot]], key, keyMeta, hash))
+				return slot;
+		}
+
+		// keys are never stored behind a group that had an empty slot when they were inserted
+		if(matchEmpty(ctrl) != 0)
+			return -1;
+
+		// triangular probing visits every group as the group count is a power of two
+		group = (group + step) & mask;
+	}
+}
+static void insertSlot(ptrs_map_t *map, uint32_t index)
+{
+	uint64_t hash = map->entries[index].hash;
+	uint32_t mask = map->slotCount / PTRS_MAP_GROUPSIZE - 1;
+	uint32_t group = (hash >> 7) & mask;
+
+	uint64_t match;
+	for(uint32_t step = 1; (match = matchFree(loadGroup(map, group))) == 0; step++)
+		group = (group + step) & mask;
+
+	uint32_t slot = group * PTRS_MAP_GROUPSIZE + firstMatch(match);
+	map->control[slot] = hash & 0x7F;
+	map->slots[slot] = index;
+}
+
+static void resize(ptrs_map_t *map, uint32_t slotCount)
+{
+	map->slotCount = slotCount;
+	map->entryCapacity = slotCount / 8 * 7;
+	map->control = realloc(map->control, slotCount);
+	map->slots = realloc(map->slots, slotCount * sizeof(uint32_t));
+	map->entries = realloc(map->entries, map->entryCapacity * sizeof(ptrs_mapentry_t));
+
+	if(map->control == NULL || map->slots == NULL || map->entries == NULL)
+		ptrs_error(NULL, "Out of memory growing a map to %d slots", slotCount);
+}
+// deleted entries keep the array part of their key meta, a string key is only freed together with its entry
+static bool ownsString(ptrs_mapentry_t *entry)
+{
+	return entry->key.meta.array.typeIndex == PTRS_NATIVETYPE_INDEX_CHAR;
+}
+
+// drops deleted entries and only grows the map when that did not free enough space
+static void rehash(ptrs_map_t *map)
+{
+	uint32_t count = 0;
+	for(uint32_t i = 0; i < map->entryCount; i++)
+	{
+		if(map->entries[i].key.meta.type != PTRS_TYPE_UNDEFINED)
+			map->entries[count++] = map->entries[i];
+		else if(ownsString(&map->entries[i]))
+			free(map->entries[i].key.value.ptrval);
+	}
+	map->entryCount = count;
+
+	if(count >= map->entryCapacity / 2)
+		resize(map, map->slotCount * 2);
+
+	memset(map->control, PTRS_MAP_EMPTY, map->slotCount);
+	for(uint32_t i = 0; i < count; i++)
+		insertSlot(map, i);
+}
+
+ptrs_map_t *ptrs_map_create(uint32_t capacity)
+{
+	uint32_t slotCount = PTRS_MAP_GROUPSIZE;
+	while(slotCount / 8 * 7 < capacity)
+		slotCount *= 2;
+
+	ptrs_map_t *map = calloc(1, sizeof(ptrs_map_t));
+	resize(map, slotCount);
+	memset(map->control, PTRS_MAP_EMPTY, slotCount);
+	return map;
+}
+void ptrs_map_free(ptrs_map_t *map)
+{
+	for(uint32_t i = 0; i < map->entryCount; i++)
+	{
+		if(ownsString(&map->entries[i]))
+			free(map->entries[i].key.value.ptrval);
+	}
+
+	free(map->control);
+	free(map->slots);
+	free(map->entries);
+	free(map);
+}
+
+ptrs_var_t ptrs_map_getHashed(ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta, uint64_t hash)
+{
+	int64_t slot = findSlot(map, key, keyMeta, hash);
+	if(slot >= 0)
+		return map->entries[map->slots[slot]].value;
+
+	ptrs_var_t result;
+	memset(&result, 0, sizeof(ptrs_var_t));
+	result.meta.type = PTRS_TYPE_UNDEFINED;
+	return result;
+}
+void ptrs_map_setHashed(ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta, uint64_t hash,
+	ptrs_val_t val, ptrs_meta_t valMeta)
+{
+	ptrs_mapentry_t *entry;
+	int64_t slot = findSlot(map, key, keyMeta, hash);
+	if(slot >= 0)
+	{
+		entry = &map->entries[map->slots[slot]];
+		entry->value.value = val;
+		entry->value.meta = valMeta;
+		return;
+	}
+
+	if(map->entryCount == map->entryCapacity)
+		rehash(map);
+
+	entry = &map->entries[map->entryCount];
+	entry->hash = hash;
+	memset(&entry->key.meta, 0, sizeof(ptrs_meta_t));
+	entry->key.meta.type = keyMeta.type;
+
+	if(keyMeta.type == PTRS_TYPE_INT)
+	{
+		entry->key.value = key;
+	}
+	else
+	{
+		uint32_t len = strnlen(key.ptrval, keyMeta.array.size);
+		char *copy = malloc(len + 1);
+		memcpy(copy, key.ptrval, len);
+		copy[len] = 0;
+
+		entry->key.value.ptrval = copy;
+		entry->key.meta.array.typeIndex = PTRS_NATIVETYPE_INDEX_CHAR;
+		entry->key.meta.array.size = len + 1;
+	}
+
+	entry->value.value = val;
+	entry->value.meta = valMeta;
+
+	insertSlot(map, map->entryCount);
+	map->entryCount++;
+	map->size++;
+}
+bool ptrs_map_hasHashed(ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta, uint64_t hash)
+{
+	return findSlot(map, key, keyMeta, hash) >= 0;
+}
+bool ptrs_map_deleteHashed(ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta, uint64_t hash)
+{
+	int64_t slot = findSlot(map, key, keyMeta, hash);
+	if(slot < 0)
+		return false;
+
+	// a foreach over the map can still hold the key string, it is freed when the entries are compacted
+	map->entries[map->slots[slot]].key.meta.type = PTRS_TYPE_UNDEFINED;
+
+	// a group that still has an empty slot never had a key probe past it
+	if(matchEmpty(loadGroup(map, slot / PTRS_MAP_GROUPSIZE)) != 0)
+		map->control[slot] = PTRS_MAP_EMPTY;
+	else
+		map->control[slot] = PTRS_MAP_DELETED;
+
+	map->size--;
+	return true;
+}
+
+ptrs_var_t ptrs_map_get(ptrs_ast_t *node, ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta)
+{
+	return ptrs_map_getHashed(map, key, keyMeta, ptrs_map_hashKey(node, key, keyMeta));
+}
+void ptrs_map_set(ptrs_ast_t *node, ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta,
+	ptrs_val_t val, ptrs_meta_t valMeta)
+{
+	ptrs_map_setHashed(map, key, keyMeta, ptrs_map_hashKey(node, key, keyMeta), val, valMeta);
+}
+bool ptrs_map_has(ptrs_ast_t *node, ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta)
+{
+	return ptrs_map_hasHashed(map, key, keyMeta, ptrs_map_hashKey(node, key, keyMeta));
+}
+bool ptrs_map_delete(ptrs_ast_t *node, ptrs_map_t *map, ptrs_val_t key, ptrs_meta_t keyMeta)
+{
+	return ptrs_map_deleteHashed(map, key, keyMeta, ptrs_map_hashKey(node, key, keyMeta));
+}
+
+ptrs_var_t ptrs_map_getMember(ptrs_ast_t *node, ptrs_map_t *map, const char *key, uint32_t keyLen)
+{
+	ptrs_val_t keyVal = {.ptrval = (char *)key};
+	ptrs_meta_t keyMeta = {0};
+	keyMeta.type = PTRS_TYPE_POINTER;
+	keyMeta.array.typeIndex = PTRS_NATIVETYPE_INDEX_CHAR;
+	keyMeta.array.size = keyLen;
+
+	return ptrs_map_get(node, map, keyVal, keyMeta);
+}
+void ptrs_map_setMember(ptrs_ast_t *node, ptrs_map_t *map, const char *key, uint32_t keyLen,
+	ptrs_val_t val, ptrs_meta_t valMeta)
+{
+	ptrs_val_t keyVal = {.ptrval = (char *)key};
+	ptrs_meta_t keyMeta = {0};
+	keyMeta.type = PTRS_TYPE_POINTER;
+	keyMeta.array.typeIndex = PTRS_NATIVETYPE_INDEX_CHAR;
+	keyMeta.array.size = keyLen;
+
+	ptrs_map_set(node, map, keyVal, keyMeta, val, valMeta);
+}
+
+bool ptrs_map_next(ptrs_map_t *map, size_t *pos, ptrs_var_t *key, ptrs_var_t *value)
+{
+	while(*pos < map->entryCount)
+	{
+		ptrs_mapentry_t *entry = &map->entries[*pos];
+		(*pos)++;
+
+		if(entry->key.meta.type != PTRS_TYPE_UNDEFINED)
+		{
+			*key = entry->key;
+			*value = entry->value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// constant keys are hashed while compiling, returns NULL for all other keys
+static jit_value_t getConstantHash(ptrs_ast_t *node, jit_function_t func, ptrs_jit_var_t key)
+{
+	if(!jit_value_is_constant(key.val) || !jit_value_is_constant(key.meta))
+		return NULL;
+
+	ptrs_val_t val = ptrs_jit_value_getValConstant(key.val);
+	ptrs_meta_t meta = ptrs_jit_value_getMetaConstant(key.meta);
+	return jit_const_long(func, ulong, ptrs_map_hashKey(node, val, meta));
+}
+
+ptrs_jit_var_t ptrs_jit_map_get(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t map, ptrs_jit_var_t key)
+{
+	jit_value_t ret;
+	jit_value_t keyVal = ptrs_jit_reinterpretCast(func, key.val, jit_type_long);
+	jit_value_t hash = getConstantHash(node, func, key);
+
+	if(hash != NULL)
+	{
+		ptrs_jit_reusableCall(func, ptrs_map_getHashed, ret, ptrs_jit_getVarType(),
+			(jit_type_void_ptr, jit_type_long, jit_type_ulong, jit_type_ulong),
+			(map.val, keyVal, key.meta, hash)
+		);
+	}
+	else
+	{
+		ptrs_jit_reusableCall(func, ptrs_map_get, ret, ptrs_jit_getVarType(),
+			(jit_type_void_ptr, jit_type_void_ptr, jit_type_long, jit_type_ulong),
+			(jit_const_int(func, void_ptr, (uintptr_t)node), map.val, keyVal, key.meta)
+		);
+	}
+
+	return ptrs_jit_valToVar(func, ret);
+}
+void ptrs_jit_map_set(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t map, ptrs_jit_var_t key, ptrs_jit_var_t value)
+{
+	jit_value_t keyVal = ptrs_jit_reinterpretCast(func, key.val, jit_type_long);
+	jit_value_t val = ptrs_jit_reinterpretCast(func, value.val, jit_type_long);
+	jit_value_t hash = getConstantHash(node, func, key);
+
+	if(hash != NULL)
+	{
+		ptrs_jit_reusableCallVoid(func, ptrs_map_setHashed,
+			(jit_type_void_ptr, jit_type_long, jit_type_ulong, jit_type_ulong, jit_type_long, jit_type_ulong),
+			(map.val, keyVal, key.meta, hash, val, value.meta)
+		);
+	}
+	else
+	{
+		ptrs_jit_reusableCallVoid(func, ptrs_map_set,
+			(jit_type_void_ptr, jit_type_void_ptr, jit_type_long, jit_type_ulong, jit_type_long, jit_type_ulong),
+			(jit_const_int(func, void_ptr, (uintptr_t)node), map.val, keyVal, key.meta, val, value.meta)
+		);
+	}
+}
+ptrs_jit_var_t ptrs_jit_map_has(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t map, ptrs_jit_var_t key)
+{
+	jit_value_t keyVal = ptrs_jit_reinterpretCast(func, key.val, jit_type_long);
+	jit_value_t hash = getConstantHash(node, func, key);
+
+	ptrs_jit_var_t ret = {
+		.val = NULL,
+		.meta = ptrs_jit_const_meta(func, PTRS_TYPE_INT),
+		.constType = PTRS_TYPE_INT
+	};
+
+	if(hash != NULL)
+	{
+		ptrs_jit_reusableCall(func, ptrs_map_hasHashed, ret.val, jit_type_sbyte,
+			(jit_type_void_ptr, jit_type_long, jit_type_ulong, jit_type_ulong),
+			(map.val, keyVal, key.meta, hash)
+		);
+	}
+	else
+	{
+		ptrs_jit_reusableCall(func, ptrs_map_has, ret.val, jit_type_sbyte,
+			(jit_type_void_ptr, jit_type_void_ptr, jit_type_long, jit_type_ulong),
+			(jit_const_int(func, void_ptr, (uintptr_t)node), map.val, keyVal, key.meta)
+		);
+	}
+
+	ret.val = jit_insn_convert(func, ret.val, jit_type_long, 0);
+	return ret;
+}
+void ptrs_jit_map_delete(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t map, ptrs_jit_var_t key)
+{
+	jit_value_t keyVal = ptrs_jit_reinterpretCast(func, key.val, jit_type_long);
+	jit_value_t hash = getConstantHash(node, func, key);
+
+	if(hash != NULL)
+	{
+		ptrs_jit_reusableCallVoid(func, ptrs_map_deleteHashed,
+			(jit_type_void_ptr, jit_type_long, jit_type_ulong, jit_type_ulong),
+			(map.val, keyVal, key.meta, hash)
+		);
+	}
+	else
+	{
+		ptrs_jit_reusableCallVoid(func, ptrs_map_delete,
+			(jit_type_void_ptr, jit_type_void_ptr, jit_type_long, jit_type_ulong),
+			(jit_const_int(func, void_ptr, (uintptr_t)node), map.val, keyVal, key.meta)
+		);
+	}
+}
+
+static ptrs_jit_var_t getMemberKey(jit_function_t func, const char *key, uint32_t keyLen)
+{
+	ptrs_jit_var_t ret = {
+		.val = jit_const_long(func, long, (uintptr_t)key),
+		.meta = ptrs_jit_const_arrayMeta(func, keyLen, PTRS_NATIVETYPE_INDEX_CHAR),
+		.constType = PTRS_TYPE_POINTER
+	};
+	return ret;
+}
+ptrs_jit_var_t ptrs_jit_map_getMember(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t map, const char *key, uint32_t keyLen)
+{
+	return ptrs_jit_map_get(node, func, map, getMemberKey(func, key, keyLen));
+}
+void ptrs_jit_map_setMember(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t map, const char *key, uint32_t keyLen, ptrs_jit_var_t value)
+{
+	ptrs_jit_map_set(node, func, map, getMemberKey(func, key, keyLen), value);
+}
@@ -0,0 +1,216 @@
+#include <string.h>
+#include <stdint.h>
+
+#include <jit/jit.h>
+
+#include "../../parser/common.h"
+#include "../../parser/ast.h"
+#include "../include/conversion.h"
+#include "../include/util.h"
+#include "../include/astlist.h"
+#include "../include/nativeinline.h"
+#include "../jit.h"
+
+typedef enum
+{
+	PTRS_INLINE_SQRT,
+	PTRS_INLINE_FABS,
+	PTRS_INLINE_FLOOR,
+	PTRS_INLINE_CEIL,
+	PTRS_INLINE_MEMCPY,
+	PTRS_INLINE_MEMSET,
+	PTRS_INLINE_STRLEN,
+} ptrs_inlinekind_t;
+
+// sin and cos are not listed, libjit might use instructions that do not round like libm
+static struct
+{
+	const char *name;
+	ptrs_inlinekind_t kind;
+	int argc;
+} inlineFunctions[] = {
+	{"sqrt", PTRS_INLINE_SQRT, 1},
+	{"fabs", PTRS_INLINE_FABS, 1},
+	{"floor", PTRS_INLINE_FLOOR, 1},
+	{"ceil", PTRS_INLINE_CEIL, 1},
+	{"memcpy", PTRS_INLINE_MEMCPY, 3},
+	{"memset", PTRS_INLINE_MEMSET, 3},
+	{"strlen", PTRS_INLINE_STRLEN, 1},
+};
+static const int inlineFunctionCount = sizeof(inlineFunctions) / sizeof(inlineFunctions[0]);
+
+static bool isStandardLibrary(const char *from)
+{
+	if(from == NULL)
+		return true;
+
+	const char *name = strrchr(from, '/');
+	name = name == NULL ? from : name + 1;
+	return strncmp(name, "libc.so", 7) == 0 || strncmp(name, "libm.so", 7) == 0;
+}
+
+static bool isNativeType(ptrs_nativetype_info_t *type, ptrs_vartype_t varType, size_t size)
+{
+	return type != NULL && type->varType == varType && type->size == size;
+}
+
+static bool hasSignature(ptrs_inlinekind_t kind, ptrs_typing_t *typing, struct ptrs_ffideclaration *ffi)
+{
+	if(ffi != NULL)
+	{
+		switch(kind)
+		{
+			case PTRS_INLINE_MEMCPY:
+				return isNativeType(ffi->argTypes[0], PTRS_TYPE_POINTER, sizeof(void *))
+					&& isNativeType(ffi->argTypes[1], PTRS_TYPE_POINTER, sizeof(void *))
+					&& isNativeType(ffi->argTypes[2], PTRS_TYPE_INT, sizeof(size_t));
+			case PTRS_INLINE_MEMSET:
+				return isNativeType(ffi->argTypes[0], PTRS_TYPE_POINTER, sizeof(void *))
+					&& ffi->argTypes[1]->varType == PTRS_TYPE_INT
+					&& isNativeType(ffi->argTypes[2], PTRS_TYPE_INT, sizeof(size_t));
+			case PTRS_INLINE_STRLEN:
+				return isNativeType(ffi->retType, PTRS_TYPE_INT, sizeof(size_t))
+					&& isNativeType(ffi->argTypes[0], PTRS_TYPE_POINTER, sizeof(void *));
+			default:
+				return isNativeType(ffi->retType, PTRS_TYPE_FLOAT, sizeof(double))
+					&& isNativeType(ffi->argTypes[0], PTRS_TYPE_FLOAT, sizeof(double));
+		}
+	}
+
+	// without a declaration the return type is taken from the !type of the call
+	uint8_t retType = typing == NULL ? (uint8_t)-1 : typing->meta.type;
+	switch(kind)
+	{
+		case PTRS_INLINE_MEMCPY:
+		case PTRS_INLINE_MEMSET:
+			return retType == (uint8_t)-1
+				|| (retType == PTRS_TYPE_POINTER && typing->nativetype == NULL);
+		case PTRS_INLINE_STRLEN:
+			return retType == (uint8_t)-1 || (retType == PTRS_TYPE_INT && typing->nativetype == NULL);
+		default:
+			return retType == PTRS_TYPE_FLOAT
+				&& (typing->nativetype == NULL || typing->nativetype->size == sizeof(double));
+	}
+}
+
+static jit_value_t inlineStrlen(jit_function_t func, jit_value_t str)
+{
+	jit_value_t len = jit_value_create(func, jit_type_nuint);
+	jit_insn_store(func, len, jit_const_int(func, nuint, 0));
+
+	jit_label_t loop = jit_label_undefined;
+	jit_label_t done = jit_label_undefined;
+	jit_insn_label(func, &loop);
+
+	jit_value_t curr = jit_insn_load_elem(func, str, len, jit_type_ubyte);
+	jit_insn_branch_if_not(func, curr, &done);
+	jit_insn_store(func, len, jit_insn_add(func, len, jit_const_int(func, nuint, 1)));
+	jit_insn_branch(func, &loop);
+
+	jit_insn_label(func, &done);
+	return jit_insn_convert(func, len, jit_type_long, 0);
+}
+
+bool ptrs_jit_inlineNativeCall(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_ast_t *symbol, ptrs_typing_t *typing, struct ptrs_astlist *args, ptrs_jit_var_t *ret)
+{
+	struct ptrs_ast_importedsymbol *expr = &symbol->arg.importedsymbol;
+	struct ptrs_ast_import *stmt = &expr->import->arg.import;
+	if(stmt->isScriptImport || expr->type != NULL || !isStandardLibrary(stmt->from))
+		return false;
+
+	struct ptrs_importlist *import = stmt->imports;
+	for(int i = 0; i < expr->index && import != NULL; i++)
+		import = import->next;
+	if(import == NULL)
+		return false;
+
+	int index = 0;
+	while(index < inlineFunctionCount && strcmp(inlineFunctions[index].name, import->name) != 0)
+		index++;
+
+	int narg = ptrs_astlist_length(args);
+	if(index == inlineFunctionCount || narg != inlineFunctions[index].argc)
+		return false;
+
+	ptrs_inlinekind_t kind = inlineFunctions[index].kind;
+	if((expr->ffi != NULL && expr->ffi->argc != narg) || !hasSignature(kind, typing, expr->ffi))
+		return false;
+
+	for(struct ptrs_astlist *curr = args; curr != NULL; curr = curr->next)
+	{
+		if(curr->entry == NULL || curr->entry->vtable == &ptrs_ast_vtable_expand)
+			return false;
+	}
+
+	ptrs_jit_var_t vals[narg];
+	for(int i = 0; i < narg; i++)
+	{
+		vals[i] = args->entry->vtable->get(args->entry, func, scope);
+		args = args->next;
+	}
+
+	ret->addressable = false;
+	if(kind == PTRS_INLINE_MEMCPY || kind == PTRS_INLINE_MEMSET)
+	{
+		jit_value_t dest = ptrs_jit_reinterpretCast(func, vals[0].val, jit_type_void_ptr);
+		jit_value_t size = jit_insn_convert(func, ptrs_jit_vartoi(func, vals[2]), jit_type_nuint, 0);
+
+		if(kind == PTRS_INLINE_MEMCPY)
+		{
+			jit_value_t src = ptrs_jit_reinterpretCast(func, vals[1].val, jit_type_void_ptr);
+			jit_insn_memcpy(func, dest, src, size);
+		}
+		else
+		{
+			jit_value_t value = jit_insn_convert(func, ptrs_jit_vartoi(func, vals[1]), jit_type_ubyte, 0);
+			jit_insn_memset(func, dest, value, size);
+		}
+
+		ptrs_meta_t meta = {0};
+		if(expr->ffi != NULL)
+			meta.type = expr->ffi->retType == NULL ? PTRS_TYPE_UNDEFINED : expr->ffi->retType->varType;
+		else if(typing != NULL && typing->meta.type != (uint8_t)-1)
+			meta = typing->meta;
+		else
+			meta.type = PTRS_TYPE_INT;
+
+		ret->val = ptrs_jit_reinterpretCast(func, dest, jit_type_long);
+		ret->meta = jit_const_long(func, ulong, *(uint64_t *)&meta);
+		ret->constType = meta.type;
+	}
+	else if(kind == PTRS_INLINE_STRLEN)
+	{
+		jit_value_t str = ptrs_jit_reinterpretCast(func, vals[0].val, jit_type_void_ptr);
+		ret->val = inlineStrlen(func, str);
+		ret->meta = ptrs_jit_const_meta(func, PTRS_TYPE_INT);
+		ret->constType = PTRS_TYPE_INT;
+	}
+	else
+	{
+		jit_value_t val = ptrs_jit_vartof(func, vals[0]);
+		switch(kind)
+		{
+			case PTRS_INLINE_SQRT:
+				ret->val = jit_insn_sqrt(func, val);
+				break;
+			case PTRS_INLINE_FABS:
+				// clearing the sign bit matches fabs for -0.0 and NaN as well
+				val = ptrs_jit_reinterpretCast(func, val, jit_type_long);
+				val = jit_insn_and(func, val, jit_const_long(func, long, INT64_MAX));
+				ret->val = ptrs_jit_reinterpretCast(func, val, jit_type_float64);
+				break;
+			case PTRS_INLINE_FLOOR:
+				ret->val = jit_insn_floor(func, val);
+				break;
+			default:
+				ret->val = jit_insn_ceil(func, val);
+				break;
+		}
+
+		ret->meta = ptrs_jit_const_meta(func, PTRS_TYPE_FLOAT);
+		ret->constType = PTRS_TYPE_FLOAT;
+	}
+
+	return true;
+}
@@ -137,3 +137,14 @@ void ptrs_handle_native_setVar(void *target, size_t size, ptrs_var_t *value)
 {
 	memcpy(target, value, sizeof(ptrs_var_t));
 }
+
+// elements of struct arrays are never accessed through the handlers, the struct is not known here
+void ptrs_handle_native_getStruct(void *target, size_t size, ptrs_var_t *value)
+{
+	value->value.intval = 0;
+	value->meta.type = PTRS_TYPE_UNDEFINED;
+}
+
+void ptrs_handle_native_setStruct(void *target, size_t size, ptrs_var_t *value)
+{
+}
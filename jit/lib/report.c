@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../../parser/common.h"
+#include "../../parser/ast.h"
+#include "../include/error.h"
+#include "../include/report.h"
+#include "../jit.h"
+
+bool ptrs_predictionReport = false;
+
+typedef struct
+{
+	ptrs_ast_t *node;
+	ptrs_function_t *function;
+	uint8_t knownType : 1;
+	uint8_t knownMeta : 1;
+	uint8_t knownValue : 1;
+} ptrs_reportentry_t;
+
+typedef struct ptrs_reportfallback
+{
+	ptrs_ast_t *node;
+	ptrs_function_t *function;
+	const char *kind;
+	struct ptrs_reportfallback *next;
+} ptrs_reportfallback_t;
+
+typedef struct
+{
+	size_t count;
+	size_t knownType;
+	size_t knownMeta;
+	size_t knownValue;
+} ptrs_reportstats_t;
+
+// hashmap from ast nodes to their last prediction, the flow analysis visits loops multiple times
+static ptrs_reportentry_t *entries = NULL;
+static size_t entryCount = 0;
+static size_t entryCapacity = 0;
+
+static ptrs_reportfallback_t *fallbacks = NULL;
+static ptrs_reportfallback_t **lastFallback = &fallbacks;
+
+static ptrs_reportentry_t *findEntry(ptrs_ast_t *node)
+{
+	uintptr_t hash = (uintptr_t)node;
+	size_t i = ((hash >> 4) ^ (hash >> 16)) & (entryCapacity - 1);
+
+	while(entries[i].node != NULL && entries[i].node != node)
+		i = (i + 1) & (entryCapacity - 1);
+
+	return &entries[i];
+}
+
+static void growEntries()
+{
+	ptrs_reportentry_t *old = entries;
+	size_t oldCapacity = entryCapacity;
+
+	entryCapacity = oldCapacity == 0 ? 256 : oldCapacity * 2;
+	entries = calloc(entryCapacity, sizeof(ptrs_reportentry_t));
+
+	for(size_t i = 0; i < oldCapacity; i++)
+	{
+		if(old[i].node != NULL)
+			*findEntry(old[i].node) = old[i];
+	}
+
+	free(old);
+}
+
+void ptrs_report_prediction(ptrs_function_t *function, ptrs_ast_t *node,
+	bool knownType, bool knownMeta, bool knownValue)
+{
+	if(node == NULL)
+		return;
+
+	if((entryCount + 1) * 2 > entryCapacity)
+		growEntries();
+
+	ptrs_reportentry_t *entry = findEntry(node);
+	if(entry->node == NULL)
+	{
+		entry->node = node;
+		entryCount++;
+	}
+
+	entry->function = function;
+	entry->knownType = knownType;
+	entry->knownMeta = knownMeta;
+	entry->knownValue = knownValue;
+}
+
+void ptrs_report_fallback(jit_function_t func, ptrs_ast_t *node, const char *kind)
+{
+	if(!ptrs_predictionReport)
+		return;
+
+	if(node == NULL)
+		node = ptrs_lastAst;
+	if(node == NULL)
+		return;
+
+	ptrs_function_t *function = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_FUNCAST);
+	if(function == NULL)
+	{
+		// .checked entry points share the ast of the function they check
+		jit_function_t unchecked = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_UNCHECKED);
+		if(unchecked != NULL)
+			function = jit_function_get_meta(unchecked, PTRS_JIT_FUNCTIONMETA_FUNCAST);
+	}
+
+	// specialized clones compile the same code again
+	for(ptrs_reportfallback_t *curr = fallbacks; curr != NULL; curr = curr->next)
+	{
+		if(curr->node == node && strcmp(curr->kind, kind) == 0)
+			return;
+	}
+
+	ptrs_reportfallback_t *entry = malloc(sizeof(ptrs_reportfallback_t));
+	entry->node = node;
+	entry->function = function;
+	entry->kind = kind;
+	entry->next = NULL;
+
+	*lastFallback = entry;
+	lastFallback = &entry->next;
+}
+
+static void printString(FILE *out, const char *str)
+{
+	fputc('"', out);
+	for(; *str != 0; str++)
+	{
+		if(*str == '"' || *str == '\\')
+			fprintf(out, "\\%c", *str);
+		else if((unsigned char)*str < 0x20)
+			fprintf(out, "\\u%04x", *str);
+		else
+			fputc(*str, out);
+	}
+	fputc('"', out);
+}
+
+static void printPosition(FILE *out, ptrs_ast_t *node)
+{
+	if(node == NULL || node->code == NULL)
+		return;
+
+	ptrs_codepos_t pos;
+	ptrs_getpos(&pos, node->code, node->codepos);
+
+	fprintf(out, ", \"file\": ");
+	printString(out, node->file != NULL ? node->file : "");
+	fprintf(out, ", \"line\": %d, \"column\": %d", pos.line, pos.column);
+}
+
+static void printStats(FILE *out, const char *name, ptrs_reportstats_t *stats)
+{
+	double count = stats->count == 0 ? 1 : stats->count;
+	fprintf(out, "\"%s\": {\"count\": %zu, \"knownType\": %.4f, \"knownMeta\": %.4f, \"knownValue\": %.4f}",
+		name, stats->count, stats->knownType / count, stats->knownMeta / count, stats->knownValue / count);
+}
+
+static void addStats(ptrs_reportstats_t *stats, ptrs_reportentry_t *entry)
+{
+	stats->count++;
+	stats->knownType += entry->knownType;
+	stats->knownMeta += entry->knownMeta;
+	stats->knownValue += entry->knownValue;
+}
+
+static size_t addFunction(ptrs_function_t **functions, size_t count, ptrs_function_t *function)
+{
+	for(size_t i = 0; i < count; i++)
+	{
+		if(functions[i] == function)
+			return count;
+	}
+
+	functions[count] = function;
+	return count + 1;
+}
+
+void ptrs_report_print(FILE *out, const char *file)
+{
+	size_t fallbackCount = 0;
+	for(ptrs_reportfallback_t *curr = fallbacks; curr != NULL; curr = curr->next)
+		fallbackCount++;
+
+	// the root function is represented by NULL and always listed first
+	ptrs_function_t **functions = malloc((entryCount + fallbackCount + 1) * sizeof(ptrs_function_t *));
+	size_t functionCount = addFunction(functions, 0, NULL);
+
+	for(size_t i = 0; i < entryCapacity; i++)
+	{
+		if(entries[i].node != NULL)
+			functionCount = addFunction(functions, functionCount, entries[i].function);
+	}
+	for(ptrs_reportfallback_t *curr = fallbacks; curr != NULL; curr = curr->next)
+		functionCount = addFunction(functions, functionCount, curr->function);
+
+	fprintf(out, "{\"file\": ");
+	printString(out, file);
+	fprintf(out, ", \"functions\": [");
+
+	for(size_t i = 0; i < functionCount; i++)
+	{
+		ptrs_function_t *function = functions[i];
+		ptrs_reportstats_t expressions = {0};
+		ptrs_reportstats_t identifiers = {0};
+
+		for(size_t j = 0; j < entryCapacity; j++)
+		{
+			if(entries[j].node == NULL || entries[j].function != function)
+				continue;
+
+			addStats(&expressions, &entries[j]);
+			if(entries[j].node->vtable == &ptrs_ast_vtable_identifier)
+				addStats(&identifiers, &entries[j]);
+		}
+
+		fprintf(out, "%s\n\t{\"name\": ", i == 0 ? "" : ",");
+		printString(out, function == NULL ? "(root)" : function->name);
+		if(function != NULL)
+			printPosition(out, function->body);
+
+		fprintf(out, ",\n\t\t");
+		printStats(out, "expressions", &expressions);
+		fprintf(out, ",\n\t\t");
+		printStats(out, "identifiers", &identifiers);
+		fprintf(out, ",\n\t\t\"fallbacks\": [");
+
+		bool first = true;
+		for(ptrs_reportfallback_t *curr = fallbacks; curr != NULL; curr = curr->next)
+		{
+			if(curr->function != function)
+				continue;
+
+			fprintf(out, "%s\n\t\t\t{\"kind\": ", first ? "" : ",");
+			printString(out, curr->kind);
+			fprintf(out, ", \"ast\": ");
+			printString(out, curr->node->vtable->name);
+			printPosition(out, curr->node);
+			fprintf(out, "}");
+			first = false;
+		}
+
+		fprintf(out, "%s]}", first ? "" : "\n\t\t");
+	}
+
+	fprintf(out, "\n]}\n");
+	free(functions);
+}
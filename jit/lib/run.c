@@ -37,7 +37,7 @@ void ptrs_compile(ptrs_result_t *result, char *src, const char *filename)
 	if(rootSignature == NULL)
 	{
 		jit_type_t params[] = {jit_type_long, jit_type_ulong};
-		rootSignature = jit_type_create_signature(jit_abi_cdecl, jit_type_long, params, 2, 1);
+		rootSignature = ptrs_jit_getSignature(jit_abi_cdecl, jit_type_long, params, 2);
 	}
 
 	result->func = ptrs_jit_createFunction(result->ast, NULL, rootSignature, "(root)");
@@ -0,0 +1,749 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include <jit/jit.h>
+
+#include "../../parser/common.h"
+#include "../include/util.h"
+#include "../include/slab.h"
+
+bool ptrs_slabStats = false;
+
+// chunks are aligned to their size, the chunk of an instance is found by masking its address
+#define PTRS_SLAB_CHUNK_SHIFT 14
+#define PTRS_SLAB_CHUNK_SIZE ((uintptr_t)1 << PTRS_SLAB_CHUNK_SHIFT)
+
+// chunkMap has one byte per possible chunk address telling whether it is a chunk of a slab
+// it is split into leaves allocated on demand, covering 48 bit addresses
+#define PTRS_SLAB_LEAF_BITS 17
+#define PTRS_SLAB_LEAF_SIZE ((uintptr_t)1 << PTRS_SLAB_LEAF_BITS)
+#define PTRS_SLAB_ROOT_SHIFT (PTRS_SLAB_CHUNK_SHIFT + PTRS_SLAB_LEAF_BITS)
+#define PTRS_SLAB_ROOT_SIZE ((uintptr_t)1 << (48 - PTRS_SLAB_ROOT_SHIFT))
+static uint8_t *chunkMap[PTRS_SLAB_ROOT_SIZE] = {0};
+
+typedef struct ptrs_slab ptrs_slab_t;
+typedef struct ptrs_slabchunk ptrs_slabchunk_t;
+
+// the header at the start of every chunk, followed by its instances
+struct ptrs_slabchunk
+{
+	void *free; // the first word of a free instance points to the next one
+	uint8_t *bump;
+	uint8_t *end;
+	uint32_t live; // instances not on the free list, including those in remoteFree
+	uint32_t id; // ptrs_struct_t.slabId of the struct
+	bool full; // in the list of full chunks of its slab, frees have to move it back
+	bool hasRemote; // in the remote list of its slab
+	ptrs_slab_t *slab; // the slab owning this chunk, NULL while it is orphaned
+	void *remoteFree; // instances deleted by other threads, guarded by chunksLock
+	ptrs_slabchunk_t *remoteNext;
+	ptrs_slabchunk_t *next;
+	ptrs_slabchunk_t *prev;
+};
+#define PTRS_SLAB_HEADER_SIZE ((sizeof(ptrs_slabchunk_t) + 15) & ~(size_t)15)
+
+struct ptrs_slab
+{
+	ptrs_slabchunk_t *current; // the chunk used by the fast paths, never released
+	ptrs_slabchunk_t *partial; // other chunks having free instances
+	ptrs_slabchunk_t *full;
+	ptrs_slabchunk_t *remote; // chunks having instances deleted by other threads, guarded by chunksLock
+	bool hasRemote;
+	uint32_t id;
+	size_t size;
+	size_t allocated;
+	size_t freed;
+};
+
+// every thread has its own slabs, so neither the fast paths nor most slow paths need a lock
+// instances deleted by a different thread are handed back to the owning thread of their chunk
+struct ptrs_slabthread
+{
+	ptrs_slab_t **slabs; // indexed by ptrs_struct_t.slabId
+	uint32_t count;
+	struct ptrs_slabthread *next;
+};
+
+static __thread ptrs_slabthread_t *currentThread = NULL;
+static pthread_key_t threadKey;
+static pthread_once_t threadKeyOnce = PTHREAD_ONCE_INIT;
+
+// threadsLock guards the lists of threads and structs and growing the slabs of a thread
+static pthread_mutex_t threadsLock = PTHREAD_MUTEX_INITIALIZER;
+static ptrs_slabthread_t retired = {0}; // always last in threads, the statistics of threads that exited
+static ptrs_slabthread_t *threads = &retired;
+// structs is replaced by a larger copy when growing, the old arrays are never freed so
+// ptrs_slab_getStruct can read it without taking the lock
+static ptrs_struct_t **structs = NULL;
+static uint32_t structCapacity = 0;
+static uint32_t structCount = 0;
+
+// chunksLock guards chunkMap leaves, the owner of chunks, remote frees and orphaned chunks
+static pthread_mutex_t chunksLock = PTHREAD_MUTEX_INITIALIZER;
+static ptrs_slabchunk_t *orphans = NULL; // chunks with live instances of threads that exited
+static uint32_t orphanCount = 0;
+
+bool ptrs_slab_isUsed(ptrs_struct_t *struc)
+{
+	return struc->size <= PTRS_SLAB_MAX_SIZE;
+}
+
+uint32_t ptrs_slab_getId(ptrs_struct_t *struc)
+{
+	uint32_t id = __atomic_load_n(&struc->slabId, __ATOMIC_ACQUIRE);
+	if(id != 0)
+		return id;
+
+	pthread_mutex_lock(&threadsLock);
+	id = struc->slabId;
+	if(id == 0)
+	{
+		// 0 marks structs without an id, so slabs[0] is never used
+		id = structCount + 1;
+		if(id >= structCapacity)
+		{
+			uint32_t capacity = structCapacity == 0 ? 64 : structCapacity * 2;
+			ptrs_struct_t **grown = calloc(capacity, sizeof(ptrs_struct_t *));
+			if(structs != NULL)
+				memcpy(grown, structs, structCapacity * sizeof(ptrs_struct_t *));
+
+			__atomic_store_n(&structs, grown, __ATOMIC_RELEASE);
+			structCapacity = capacity;
+		}
+
+		structs[id] = struc;
+		__atomic_store_n(&structCount, id, __ATOMIC_RELEASE);
+		__atomic_store_n(&struc->slabId, id, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&threadsLock);
+
+	return id;
+}
+
+ptrs_struct_t *ptrs_slab_getStruct(uint32_t id)
+{
+	// every array published after the count was increased already contains the struct
+	if(id == 0 || id > __atomic_load_n(&structCount, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	return __atomic_load_n(&structs, __ATOMIC_ACQUIRE)[id];
+}
+
+static void linkChunk(ptrs_slabchunk_t **list, ptrs_slabchunk_t *chunk)
+{
+	chunk->prev = NULL;
+	chunk->next = *list;
+	if(*list != NULL)
+		(*list)->prev = chunk;
+	*list = chunk;
+}
+static void unlinkChunk(ptrs_slabchunk_t **list, ptrs_slabchunk_t *chunk)
+{
+	if(chunk->prev != NULL)
+		chunk->prev->next = chunk->next;
+	else
+		*list = chunk->next;
+
+	if(chunk->next != NULL)
+		chunk->next->prev = chunk->prev;
+}
+
+static uint8_t *getChunkMapEntry(uintptr_t address)
+{
+	uintptr_t rootIndex = address >> PTRS_SLAB_ROOT_SHIFT;
+	if(rootIndex >= PTRS_SLAB_ROOT_SIZE)
+		return NULL;
+
+	uint8_t *leaf = __atomic_load_n(&chunkMap[rootIndex], __ATOMIC_ACQUIRE);
+	if(leaf == NULL)
+		return NULL;
+
+	return &leaf[(address >> PTRS_SLAB_CHUNK_SHIFT) & (PTRS_SLAB_LEAF_SIZE - 1)];
+}
+
+static ptrs_slabchunk_t *createChunk(ptrs_slab_t *slab)
+{
+	void *memory;
+	if(posix_memalign(&memory, PTRS_SLAB_CHUNK_SIZE, PTRS_SLAB_CHUNK_SIZE) != 0)
+		return NULL;
+
+	uintptr_t address = (uintptr_t)memory;
+	uintptr_t rootIndex = address >> PTRS_SLAB_ROOT_SHIFT;
+	if(rootIndex >= PTRS_SLAB_ROOT_SIZE)
+	{
+		free(memory);
+		return NULL;
+	}
+
+	if(__atomic_load_n(&chunkMap[rootIndex], __ATOMIC_ACQUIRE) == NULL)
+	{
+		pthread_mutex_lock(&chunksLock);
+		if(chunkMap[rootIndex] == NULL)
+			__atomic_store_n(&chunkMap[rootIndex], calloc(PTRS_SLAB_LEAF_SIZE, 1), __ATOMIC_RELEASE);
+		pthread_mutex_unlock(&chunksLock);
+	}
+	__atomic_store_n(getChunkMapEntry(address), 1, __ATOMIC_RELEASE);
+
+	ptrs_slabchunk_t *chunk = memory;
+	memset(chunk, 0, sizeof(ptrs_slabchunk_t));
+	chunk->bump = (uint8_t *)memory + PTRS_SLAB_HEADER_SIZE;
+	chunk->end = chunk->bump + (PTRS_SLAB_CHUNK_SIZE - PTRS_SLAB_HEADER_SIZE) / slab->size * slab->size;
+	chunk->id = slab->id;
+	chunk->slab = slab;
+	return chunk;
+}
+
+// gives the memory of a chunk without live instances back to malloc
+static void releaseChunk(ptrs_slabchunk_t *chunk)
+{
+	__atomic_store_n(getChunkMapEntry((uintptr_t)chunk), 0, __ATOMIC_RELEASE);
+	free(chunk);
+}
+
+// instances are 16 byte aligned, structs without data members still need room for the free list
+static size_t getInstanceSize(ptrs_struct_t *struc)
+{
+	size_t size = (struc->size + 15) & ~(size_t)15;
+	return size == 0 ? 16 : size;
+}
+
+// the chunk containing instance if it is an instance allocated for struc, NULL for all other memory
+static ptrs_slabchunk_t *getChunk(ptrs_struct_t *struc, void *instance)
+{
+	uint8_t *entry = getChunkMapEntry((uintptr_t)instance);
+	if(entry == NULL || __atomic_load_n(entry, __ATOMIC_ACQUIRE) == 0)
+		return NULL;
+
+	ptrs_slabchunk_t *chunk = (void *)((uintptr_t)instance & ~(PTRS_SLAB_CHUNK_SIZE - 1));
+	size_t size = getInstanceSize(struc);
+	uintptr_t offset = (uintptr_t)instance - (uintptr_t)chunk;
+	if(chunk->id != struc->slabId || offset < PTRS_SLAB_HEADER_SIZE
+		|| (offset - PTRS_SLAB_HEADER_SIZE) % size != 0)
+		return NULL;
+
+	return chunk;
+}
+
+// hands the chunks of a thread that exited to other threads and frees its slabs
+static void releaseThread(void *arg)
+{
+	ptrs_slabthread_t *thread = arg;
+
+	pthread_mutex_lock(&chunksLock);
+	for(uint32_t i = 0; i < thread->count; i++)
+	{
+		ptrs_slab_t *slab = thread->slabs[i];
+		if(slab == NULL)
+			continue;
+
+		ptrs_slabchunk_t *lists[] = {slab->current, slab->partial, slab->full};
+		for(int j = 0; j < 3; j++)
+		{
+			ptrs_slabchunk_t *chunk = lists[j];
+			while(chunk != NULL)
+			{
+				ptrs_slabchunk_t *next = j == 0 ? NULL : chunk->next;
+
+				// instances deleted by other threads go to the free list before handing the chunk out
+				void *curr = chunk->remoteFree;
+				while(curr != NULL)
+				{
+					void *nextFree = *(void **)curr;
+					*(void **)curr = chunk->free;
+					chunk->free = curr;
+					chunk->live--;
+					curr = nextFree;
+				}
+				chunk->remoteFree = NULL;
+				chunk->hasRemote = false;
+
+				if(chunk->live == 0)
+				{
+					releaseChunk(chunk);
+				}
+				else
+				{
+					chunk->slab = NULL;
+					chunk->full = false;
+					linkChunk(&orphans, chunk);
+					orphanCount++;
+				}
+
+				chunk = next;
+			}
+		}
+	}
+	pthread_mutex_unlock(&chunksLock);
+
+	pthread_mutex_lock(&threadsLock);
+	for(ptrs_slabthread_t **curr = &threads; *curr != NULL; curr = &(*curr)->next)
+	{
+		if(*curr == thread)
+		{
+			*curr = thread->next;
+			break;
+		}
+	}
+
+	if(retired.count < thread->count)
+	{
+		retired.slabs = realloc(retired.slabs, thread->count * sizeof(ptrs_slab_t *));
+		memset(retired.slabs + retired.count, 0, (thread->count - retired.count) * sizeof(ptrs_slab_t *));
+		retired.count = thread->count;
+	}
+	for(uint32_t i = 0; i < thread->count; i++)
+	{
+		ptrs_slab_t *slab = thread->slabs[i];
+		if(slab == NULL)
+			continue;
+
+		if(retired.slabs[i] == NULL)
+			retired.slabs[i] = calloc(1, sizeof(ptrs_slab_t));
+		retired.slabs[i]->allocated += slab->allocated;
+		retired.slabs[i]->freed += slab->freed;
+		free(slab);
+	}
+	pthread_mutex_unlock(&threadsLock);
+
+	if(currentThread == thread)
+		currentThread = NULL;
+	free(thread->slabs);
+	free(thread);
+}
+static void createThreadKey()
+{
+	pthread_key_create(&threadKey, releaseThread);
+}
+
+ptrs_slabthread_t *ptrs_slab_getThread()
+{
+	if(currentThread == NULL)
+	{
+		currentThread = calloc(1, sizeof(ptrs_slabthread_t));
+
+		pthread_once(&threadKeyOnce, createThreadKey);
+		pthread_setspecific(threadKey, currentThread);
+
+		pthread_mutex_lock(&threadsLock);
+		currentThread->next = threads;
+		threads = currentThread;
+		pthread_mutex_unlock(&threadsLock);
+	}
+
+	return currentThread;
+}
+
+static ptrs_slab_t *getSlab(ptrs_struct_t *struc)
+{
+	ptrs_slabthread_t *thread = ptrs_slab_getThread();
+	uint32_t id = ptrs_slab_getId(struc);
+
+	if(id >= thread->count)
+	{
+		uint32_t count = thread->count == 0 ? 16 : thread->count;
+		while(count <= id)
+			count *= 2;
+
+		pthread_mutex_lock(&threadsLock);
+		thread->slabs = realloc(thread->slabs, count * sizeof(ptrs_slab_t *));
+		memset(thread->slabs + thread->count, 0, (count - thread->count) * sizeof(ptrs_slab_t *));
+		thread->count = count;
+		pthread_mutex_unlock(&threadsLock);
+	}
+
+	ptrs_slab_t *slab = thread->slabs[id];
+	if(slab == NULL)
+	{
+		slab = calloc(1, sizeof(ptrs_slab_t));
+		slab->id = id;
+		slab->size = getInstanceSize(struc);
+
+		thread->slabs[id] = slab;
+	}
+
+	return slab;
+}
+
+// moves the instances deleted by other threads to the free lists of their chunks
+static void collectRemote(ptrs_slab_t *slab)
+{
+	if(!__atomic_load_n(&slab->hasRemote, __ATOMIC_ACQUIRE))
+		return;
+
+	pthread_mutex_lock(&chunksLock);
+	for(ptrs_slabchunk_t *chunk = slab->remote; chunk != NULL; )
+	{
+		ptrs_slabchunk_t *next = chunk->remoteNext;
+
+		void *curr = chunk->remoteFree;
+		while(curr != NULL)
+		{
+			void *nextFree = *(void **)curr;
+			*(void **)curr = chunk->free;
+			chunk->free = curr;
+			chunk->live--;
+			curr = nextFree;
+		}
+		chunk->remoteFree = NULL;
+		chunk->hasRemote = false;
+
+		if(chunk->full)
+		{
+			unlinkChunk(&slab->full, chunk);
+			chunk->full = false;
+			linkChunk(&slab->partial, chunk);
+		}
+
+		if(chunk->live == 0 && chunk != slab->current)
+		{
+			unlinkChunk(&slab->partial, chunk);
+			releaseChunk(chunk);
+		}
+
+		chunk = next;
+	}
+	slab->remote = NULL;
+	__atomic_store_n(&slab->hasRemote, false, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&chunksLock);
+}
+
+// takes over a chunk with free instances left behind by a thread that exited
+static ptrs_slabchunk_t *adoptOrphan(ptrs_slab_t *slab)
+{
+	if(__atomic_load_n(&orphanCount, __ATOMIC_RELAXED) == 0)
+		return NULL;
+
+	pthread_mutex_lock(&chunksLock);
+	ptrs_slabchunk_t *chunk = orphans;
+	while(chunk != NULL && (chunk->id != slab->id
+		|| (chunk->free == NULL && (size_t)(chunk->end - chunk->bump) < slab->size)))
+		chunk = chunk->next;
+
+	if(chunk != NULL)
+	{
+		unlinkChunk(&orphans, chunk);
+		orphanCount--;
+		chunk->slab = slab;
+	}
+	pthread_mutex_unlock(&chunksLock);
+
+	return chunk;
+}
+
+// replaces the current chunk of slab once it has neither free instances nor space left
+static ptrs_slabchunk_t *refillSlab(ptrs_slab_t *slab)
+{
+	collectRemote(slab);
+
+	ptrs_slabchunk_t *chunk = slab->current;
+	if(chunk != NULL && (chunk->free != NULL || (size_t)(chunk->end - chunk->bump) >= slab->size))
+		return chunk;
+
+	ptrs_slabchunk_t *next = slab->partial;
+	if(next != NULL)
+		unlinkChunk(&slab->partial, next);
+	else
+		next = adoptOrphan(slab);
+
+	if(next == NULL)
+		next = createChunk(slab);
+	if(next == NULL)
+		return NULL;
+
+	if(chunk != NULL)
+	{
+		chunk->full = true;
+		linkChunk(&slab->full, chunk);
+	}
+
+	slab->current = next;
+	return next;
+}
+
+void *ptrs_slab_allocate(ptrs_struct_t *struc)
+{
+	if(!ptrs_slab_isUsed(struc))
+		return malloc(struc->size);
+
+	ptrs_slab_t *slab = getSlab(struc);
+	slab->allocated++;
+
+	ptrs_slabchunk_t *chunk = refillSlab(slab);
+	if(chunk == NULL)
+		return malloc(struc->size); // ptrs_slab_free does not know this memory and passes it to free
+
+	chunk->live++;
+	if(chunk->free != NULL)
+	{
+		void *instance = chunk->free;
+		chunk->free = *(void **)instance;
+		return instance;
+	}
+
+	void *instance = chunk->bump;
+	chunk->bump += slab->size;
+	return instance;
+}
+
+void ptrs_slab_free(ptrs_struct_t *struc, void *instance)
+{
+	if(instance == NULL)
+		return;
+
+	ptrs_slabchunk_t *chunk = ptrs_slab_isUsed(struc) ? getChunk(struc, instance) : NULL;
+	if(chunk == NULL)
+	{
+		free(instance);
+		return;
+	}
+
+	ptrs_slab_t *slab = getSlab(struc);
+	slab->freed++;
+
+	if(chunk->slab == slab)
+	{
+		*(void **)instance = chunk->free;
+		chunk->free = instance;
+		chunk->live--;
+
+		if(chunk == slab->current)
+			return;
+
+		if(chunk->full)
+		{
+			unlinkChunk(&slab->full, chunk);
+			chunk->full = false;
+			linkChunk(&slab->partial, chunk);
+		}
+
+		if(chunk->live == 0)
+		{
+			unlinkChunk(&slab->partial, chunk);
+			releaseChunk(chunk);
+		}
+		return;
+	}
+
+	pthread_mutex_lock(&chunksLock);
+	ptrs_slab_t *owner = chunk->slab;
+	if(owner == NULL)
+	{
+		// nobody uses the free list of an orphaned chunk until it is adopted
+		*(void **)instance = chunk->free;
+		chunk->free = instance;
+		chunk->live--;
+
+		if(chunk->live == 0)
+		{
+			unlinkChunk(&orphans, chunk);
+			orphanCount--;
+			releaseChunk(chunk);
+		}
+	}
+	else
+	{
+		*(void **)instance = chunk->remoteFree;
+		chunk->remoteFree = instance;
+
+		if(!chunk->hasRemote)
+		{
+			chunk->hasRemote = true;
+			chunk->remoteNext = owner->remote;
+			owner->remote = chunk;
+			__atomic_store_n(&owner->hasRemote, true, __ATOMIC_RELEASE);
+		}
+	}
+	pthread_mutex_unlock(&chunksLock);
+}
+
+static jit_value_t loadSlab(jit_function_t func, jit_value_t id, jit_label_t *slowPath)
+{
+	jit_value_t thread = ptrs_jit_hoistedCall(func, "ptrs_slab_getThread",
+		ptrs_slab_getThread, jit_type_void_ptr);
+
+	jit_value_t count = jit_insn_load_relative(func, thread,
+		offsetof(ptrs_slabthread_t, count), jit_type_uint);
+	jit_insn_branch_if_not(func, jit_insn_lt(func, id, count), slowPath);
+
+	jit_value_t slabs = jit_insn_load_relative(func, thread,
+		offsetof(ptrs_slabthread_t, slabs), jit_type_void_ptr);
+	jit_value_t slab = jit_insn_load_elem(func, slabs, id, jit_type_void_ptr);
+	jit_insn_branch_if_not(func, slab, slowPath);
+
+	return slab;
+}
+
+static void incrementCounter(jit_function_t func, jit_value_t slab, size_t offset)
+{
+	if(!ptrs_slabStats)
+		return;
+
+	jit_value_t counter = jit_insn_load_relative(func, slab, offset, jit_type_nuint);
+	counter = jit_insn_add(func, counter, jit_const_int(func, nuint, 1));
+	jit_insn_store_relative(func, slab, offset, counter);
+}
+
+static jit_value_t emitAllocate(jit_function_t func, jit_value_t struc, jit_value_t id)
+{
+	jit_value_t instance = jit_value_create(func, jit_type_void_ptr);
+	jit_label_t bump = jit_label_undefined;
+	jit_label_t allocated = jit_label_undefined;
+	jit_label_t slowPath = jit_label_undefined;
+	jit_label_t done = jit_label_undefined;
+
+	jit_value_t slab = loadSlab(func, id, &slowPath);
+	jit_value_t chunk = jit_insn_load_relative(func, slab,
+		offsetof(ptrs_slab_t, current), jit_type_void_ptr);
+	jit_insn_branch_if_not(func, chunk, &slowPath);
+
+	jit_value_t head = jit_insn_load_relative(func, chunk,
+		offsetof(ptrs_slabchunk_t, free), jit_type_void_ptr);
+	jit_insn_branch_if_not(func, head, &bump);
+
+	jit_value_t next = jit_insn_load_relative(func, head, 0, jit_type_void_ptr);
+	jit_insn_store_relative(func, chunk, offsetof(ptrs_slabchunk_t, free), next);
+	jit_insn_store(func, instance, head);
+	jit_insn_branch(func, &allocated);
+
+	jit_insn_label(func, &bump);
+	jit_value_t start = jit_insn_load_relative(func, chunk,
+		offsetof(ptrs_slabchunk_t, bump), jit_type_void_ptr);
+	jit_value_t end = jit_insn_load_relative(func, chunk,
+		offsetof(ptrs_slabchunk_t, end), jit_type_void_ptr);
+	jit_value_t size = jit_insn_load_relative(func, slab,
+		offsetof(ptrs_slab_t, size), jit_type_nuint);
+
+	jit_value_t newStart = jit_insn_add(func, start, size);
+	jit_insn_branch_if(func, jit_insn_gt(func, newStart, end), &slowPath);
+	jit_insn_store_relative(func, chunk, offsetof(ptrs_slabchunk_t, bump), newStart);
+	jit_insn_store(func, instance, start);
+
+	jit_insn_label(func, &allocated);
+	jit_value_t live = jit_insn_load_relative(func, chunk,
+		offsetof(ptrs_slabchunk_t, live), jit_type_uint);
+	live = jit_insn_add(func, live, jit_const_int(func, uint, 1));
+	jit_insn_store_relative(func, chunk, offsetof(ptrs_slabchunk_t, live), live);
+	incrementCounter(func, slab, offsetof(ptrs_slab_t, allocated));
+	jit_insn_branch(func, &done);
+
+	jit_insn_label(func, &slowPath);
+	jit_value_t slowInstance;
+	ptrs_jit_reusableCall(func, ptrs_slab_allocate, slowInstance,
+		jit_type_void_ptr, (jit_type_void_ptr), (struc));
+	jit_insn_store(func, instance, slowInstance);
+
+	jit_insn_label(func, &done);
+	return instance;
+}
+
+jit_value_t ptrs_jit_slabAllocate(jit_function_t func, ptrs_struct_t *struc)
+{
+	if(!ptrs_slab_isUsed(struc))
+	{
+		jit_value_t instance;
+		ptrs_jit_reusableCall(func, malloc, instance,
+			jit_type_void_ptr, (jit_type_nuint), (jit_const_int(func, nuint, struc->size)));
+		return instance;
+	}
+
+	return emitAllocate(func,
+		jit_const_int(func, void_ptr, (uintptr_t)struc),
+		jit_const_int(func, uint, ptrs_slab_getId(struc))
+	);
+}
+
+jit_value_t ptrs_jit_slabAllocateDynamic(jit_function_t func, jit_value_t struc)
+{
+	// structs without an id or too large for a slab never have a slab and use the slow path
+	jit_value_t id = jit_insn_load_relative(func, struc, offsetof(ptrs_struct_t, slabId), jit_type_uint);
+	return emitAllocate(func, struc, id);
+}
+
+void ptrs_jit_slabFree(jit_function_t func, ptrs_struct_t *struc, jit_value_t instance)
+{
+	instance = ptrs_jit_reinterpretCast(func, instance, jit_type_void_ptr);
+	if(!ptrs_slab_isUsed(struc))
+	{
+		ptrs_jit_reusableCallVoid(func, free, (jit_type_void_ptr), (instance));
+		return;
+	}
+
+	jit_label_t slowPath = jit_label_undefined;
+	jit_label_t done = jit_label_undefined;
+	jit_insn_branch_if_not(func, instance, &done);
+
+	// only instances allocated by this thread for this struct take the fast path, anything else
+	// including memory not allocated by a slab at all is left to ptrs_slab_free
+	jit_value_t address = ptrs_jit_reinterpretCast(func, instance, jit_type_nuint);
+	jit_value_t rootIndex = jit_insn_shr(func, address, jit_const_int(func, nuint, PTRS_SLAB_ROOT_SHIFT));
+	jit_insn_branch_if_not(func,
+		jit_insn_lt(func, rootIndex, jit_const_int(func, nuint, PTRS_SLAB_ROOT_SIZE)), &slowPath);
+
+	jit_value_t leaf = jit_insn_load_elem(func,
+		jit_const_int(func, void_ptr, (uintptr_t)chunkMap), rootIndex, jit_type_void_ptr);
+	jit_insn_branch_if_not(func, leaf, &slowPath);
+
+	jit_value_t leafIndex = jit_insn_and(func,
+		jit_insn_shr(func, address, jit_const_int(func, nuint, PTRS_SLAB_CHUNK_SHIFT)),
+		jit_const_int(func, nuint, PTRS_SLAB_LEAF_SIZE - 1));
+	jit_value_t isChunk = jit_insn_load_elem(func, leaf, leafIndex, jit_type_ubyte);
+	jit_insn_branch_if_not(func, isChunk, &slowPath);
+
+	jit_value_t chunk = jit_insn_and(func, address, jit_const_int(func, nuint, ~(PTRS_SLAB_CHUNK_SIZE - 1)));
+	jit_value_t slab = loadSlab(func, jit_const_int(func, uint, ptrs_slab_getId(struc)), &slowPath);
+	jit_value_t owner = jit_insn_load_relative(func, chunk,
+		offsetof(ptrs_slabchunk_t, slab), jit_type_void_ptr);
+	jit_insn_branch_if(func, jit_insn_ne(func, owner, slab), &slowPath);
+
+	// moving full chunks between lists and releasing empty ones is left to the slow path
+	jit_value_t full = jit_insn_load_relative(func, chunk,
+		offsetof(ptrs_slabchunk_t, full), jit_type_sys_bool);
+	jit_insn_branch_if(func, full, &slowPath);
+	jit_value_t live = jit_insn_load_relative(func, chunk,
+		offsetof(ptrs_slabchunk_t, live), jit_type_uint);
+	jit_insn_branch_if(func, jit_insn_le(func, live, jit_const_int(func, uint, 1)), &slowPath);
+
+	live = jit_insn_sub(func, live, jit_const_int(func, uint, 1));
+	jit_insn_store_relative(func, chunk, offsetof(ptrs_slabchunk_t, live), live);
+	jit_value_t next = jit_insn_load_relative(func, chunk, offsetof(ptrs_slabchunk_t, free), jit_type_void_ptr);
+	jit_insn_store_relative(func, instance, 0, next);
+	jit_insn_store_relative(func, chunk, offsetof(ptrs_slabchunk_t, free), instance);
+	incrementCounter(func, slab, offsetof(ptrs_slab_t, freed));
+	jit_insn_branch(func, &done);
+
+	jit_insn_label(func, &slowPath);
+	ptrs_jit_reusableCallVoid(func, ptrs_slab_free,
+		(jit_type_void_ptr, jit_type_void_ptr),
+		(jit_const_int(func, void_ptr, (uintptr_t)struc), instance)
+	);
+
+	jit_insn_label(func, &done);
+}
+
+void ptrs_slab_printStats(FILE *out)
+{
+	pthread_mutex_lock(&threadsLock);
+
+	fprintf(out, "%-32s %12s %12s\n", "struct", "live", "allocated");
+	for(uint32_t i = 1; i <= structCount; i++)
+	{
+		size_t allocated = 0;
+		size_t freed = 0;
+		for(ptrs_slabthread_t *curr = threads; curr != NULL; curr = curr->next)
+		{
+			if(i < curr->count && curr->slabs[i] != NULL)
+			{
+				allocated += curr->slabs[i]->allocated;
+				freed += curr->slabs[i]->freed;
+			}
+		}
+
+		fprintf(out, "%-32s %12zd %12zu\n", structs[i]->name, (ssize_t)(allocated - freed), allocated);
+	}
+
+	pthread_mutex_unlock(&threadsLock);
+}
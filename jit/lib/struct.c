@@ -3,6 +3,7 @@
 #include <ctype.h>
 #include <string.h>
 #include <assert.h>
+#include <inttypes.h>
 
 #include "../../parser/common.h"
 #include "../../parser/ast.h"
@@ -13,33 +14,80 @@
 #include "../include/astlist.h"
 #include "../include/util.h"
 #include "../include/call.h"
+#include "../include/report.h"
+#include "../include/slab.h"
+#include "../include/structarray.h"
+#include "../include/map.h"
 
-struct ptrs_opoverload *ptrs_struct_getOverloadInfo(ptrs_struct_t *struc, void *handler, bool isInstance)
+struct ptrs_opoverload *ptrs_struct_getOverloadInfo(ptrs_struct_t *struc, enum ptrs_structop op, bool isInstance)
 {
 	struct ptrs_opoverload *curr = struc->overloads;
 	while(curr != NULL)
 	{
-		if(curr->op == handler && (isInstance || curr->isStatic))
+		if(curr->op == op && (isInstance || curr->isStatic))
 			return curr;
 		curr = curr->next;
 	}
 	return NULL;
 }
 
-jit_function_t ptrs_struct_getOverload(ptrs_struct_t *struc, void *handler, bool isInstance)
+void ptrs_struct_fillOverloadTable(ptrs_struct_t *struc)
 {
-	struct ptrs_opoverload *overload = ptrs_struct_getOverloadInfo(struc, handler, isInstance);
+	memset(struc->overloadTable, 0, sizeof(struc->overloadTable));
+	for(struct ptrs_opoverload *curr = struc->overloads; curr != NULL; curr = curr->next)
+	{
+		// the first overload in the list takes precedence, see ptrs_struct_getOverloadInfo
+		if(struc->overloadTable[curr->op][1] == NULL)
+			struc->overloadTable[curr->op][1] = curr;
+		if(curr->isStatic && struc->overloadTable[curr->op][0] == NULL)
+			struc->overloadTable[curr->op][0] = curr;
+	}
+}
+
+void ptrs_struct_fillForeachPlan(ptrs_struct_t *struc)
+{
+	for(int isInstance = 0; isInstance < 2; isInstance++)
+	{
+		free(struc->foreachPlan[isInstance]);
+		struc->foreachPlan[isInstance] = malloc(sizeof(struct ptrs_structmember *) * struc->memberCount);
+
+		// members are visited in the order of the hash map, setters are not visited
+		uint16_t count = 0;
+		for(int i = 0; i < struc->memberCount; i++)
+		{
+			struct ptrs_structmember *curr = &struc->member[i];
+			if(curr->name != NULL && curr->type != PTRS_STRUCTMEMBER_SETTER
+				&& (curr->isStatic || isInstance))
+				struc->foreachPlan[isInstance][count++] = curr;
+		}
+		struc->foreachPlanSize[isInstance] = count;
+	}
+}
+
+struct ptrs_structmember **ptrs_struct_getForeachPlan(ptrs_struct_t *struc, bool isInstance, uint16_t *count)
+{
+	// foreach loops can be compiled before the struct itself
+	if(struc->foreachPlan[isInstance] == NULL)
+		ptrs_struct_fillForeachPlan(struc);
+
+	*count = struc->foreachPlanSize[isInstance];
+	return struc->foreachPlan[isInstance];
+}
+
+jit_function_t ptrs_struct_getOverload(ptrs_struct_t *struc, enum ptrs_structop op, bool isInstance)
+{
+	struct ptrs_opoverload *overload = struc->overloadTable[op][isInstance];
 	if(overload != NULL)
 		return overload->handlerFunc;
 	else
 		return NULL;
 }
 
-void *ptrs_struct_getOverloadClosure(ptrs_struct_t *struc, void *handler, bool isInstance)
+void *ptrs_struct_getOverloadClosure(ptrs_struct_t *struc, enum ptrs_structop op, bool isInstance)
 {
-	struct ptrs_opoverload *overload = ptrs_struct_getOverloadInfo(struc, handler, isInstance);
+	struct ptrs_opoverload *overload = struc->overloadTable[op][isInstance];
 	if(overload != NULL)
-		return ptrs_jit_function_to_closure(NULL, overload->handlerFunc);
+		return overload->handlerClosure;
 	else
 		return NULL;
 }
@@ -51,23 +99,17 @@ const char const *accessorNames[] = {
 };
 bool ptrs_struct_canAccess(ptrs_ast_t *node, ptrs_struct_t *struc, struct ptrs_structmember *member)
 {
-	switch(member->protection)
+	if(member->protection == 0)
+		return true;
+
+	// the module ids and the code range are set by the parser, accesses known at compile time
+	// are resolved once during codegen, dynamic ones only compare integers
+	if(node != NULL && node->module == struc->module)
 	{
-		case 0:
+		if(member->protection == 1)
+			return true;
+		else if(node->codepos >= struc->firstCodepos && node->codepos < struc->lastCodepos)
 			return true;
-		case 1:
-			if(strcmp(node->file, struc->ast->file) == 0)
-				return true;
-			else
-				break;
-		default:
-			if(strcmp(node->file, struc->ast->file) == 0
-				&& node->codepos >= struc->ast->codepos
-				&& node->codepos < struc->lastCodepos)
-				return true;
-			else
-				break;
-			break;
 	}
 
 	if(node == NULL)
@@ -133,13 +175,101 @@ struct ptrs_structmember *ptrs_struct_find(ptrs_struct_t *struc,
 	return ignored;
 }
 
+bool ptrs_structProfile = false;
+
+struct ptrs_structlist
+{
+	ptrs_struct_t *struc;
+	struct ptrs_structlist *next;
+};
+static struct ptrs_structlist *profiledStructs = NULL;
+
+struct ptrs_profileentry
+{
+	char *structName;
+	char *memberName;
+	uint64_t count;
+	struct ptrs_profileentry *next;
+};
+static struct ptrs_profileentry *profile = NULL;
+static bool hasProfile = false;
+
+void ptrs_struct_addToProfile(ptrs_struct_t *struc)
+{
+	struct ptrs_structlist *entry = malloc(sizeof(struct ptrs_structlist));
+	entry->struc = struc;
+	entry->next = profiledStructs;
+	profiledStructs = entry;
+}
+
+void ptrs_struct_writeProfile(FILE *out)
+{
+	for(struct ptrs_structlist *curr = profiledStructs; curr != NULL; curr = curr->next)
+	{
+		ptrs_struct_t *struc = curr->struc;
+		for(int i = 0; i < struc->memberCount; i++)
+		{
+			struct ptrs_structmember *member = &struc->member[i];
+			if(member->name != NULL)
+				fprintf(out, "%s %s %"PRIu64"\n", struc->name, member->name, member->accessCount);
+		}
+	}
+}
+
+bool ptrs_struct_readProfile(FILE *in)
+{
+	char structName[256];
+	char memberName[256];
+	uint64_t count;
+
+	int ret;
+	while((ret = fscanf(in, "%255s %255s %"SCNu64, structName, memberName, &count)) == 3)
+	{
+		struct ptrs_profileentry *entry = malloc(sizeof(struct ptrs_profileentry));
+		entry->structName = strdup(structName);
+		entry->memberName = strdup(memberName);
+		entry->count = count;
+		entry->next = profile;
+		profile = entry;
+	}
+
+	hasProfile = true;
+	return ret == EOF;
+}
+
+int64_t ptrs_struct_getProfiledCount(const char *structName, const char *memberName)
+{
+	if(!hasProfile)
+		return -1;
+
+	// structs sharing a name, e.g. from different files, share their counts
+	int64_t count = -1;
+	for(struct ptrs_profileentry *curr = profile; curr != NULL; curr = curr->next)
+	{
+		if(strcmp(curr->structName, structName) == 0 && strcmp(curr->memberName, memberName) == 0)
+			count = (count == -1 ? 0 : count) + curr->count;
+	}
+	return count;
+}
+
+void ptrs_jit_struct_countAccess(jit_function_t func, struct ptrs_structmember *member)
+{
+	if(!ptrs_structProfile)
+		return;
+
+	jit_value_t counterPtr = jit_const_int(func, void_ptr, (uintptr_t)&member->accessCount);
+	jit_value_t counter = jit_insn_load_relative(func, counterPtr, 0, jit_type_ulong);
+	counter = jit_insn_add(func, counter, jit_const_long(func, ulong, 1));
+	jit_insn_store_relative(func, counterPtr, 0, counter);
+}
+
 bool ptrs_struct_hasKey(void *data, ptrs_struct_t *struc,
 	const char *key, ptrs_meta_t keyMeta, ptrs_ast_t *ast)
 {
 	if(ptrs_struct_find(struc, key, keyMeta.array.size, -1, ast) != NULL)
 		return true;
 
-	jit_function_t overload = ptrs_struct_getOverload(struc, ptrs_handle_op_in, data != NULL);
+	jit_function_t overload = ptrs_struct_getOverload(struc, PTRS_STRUCTOP_IN, data != NULL);
 	if(overload == NULL)
 		return false;
 
@@ -153,6 +283,9 @@ bool ptrs_struct_hasKey(void *data, ptrs_struct_t *struc,
 ptrs_var_t ptrs_struct_getMember(ptrs_ast_t *ast, void *data, ptrs_struct_t *struc,
 	struct ptrs_structmember *member)
 {
+	if(ptrs_structProfile)
+		member->accessCount++;
+
 	if(member->isStatic)
 		data = struc->staticData;
 	else if(data == NULL)
@@ -189,6 +322,9 @@ ptrs_var_t ptrs_struct_getMember(ptrs_ast_t *ast, void *data, ptrs_struct_t *str
 void ptrs_struct_setMember(ptrs_ast_t *ast, void *data, ptrs_struct_t *struc,
 	struct ptrs_structmember *member, ptrs_val_t val, ptrs_meta_t meta)
 {
+	if(ptrs_structProfile)
+		member->accessCount++;
+
 	if(member->isStatic)
 		data = struc->staticData;
 	else if(data == NULL)
@@ -222,6 +358,9 @@ void ptrs_struct_setMember(ptrs_ast_t *ast, void *data, ptrs_struct_t *struc,
 ptrs_var_t ptrs_struct_addressOfMember(ptrs_ast_t *ast, void *data, ptrs_struct_t *struc,
 	struct ptrs_structmember *member)
 {
+	if(ptrs_structProfile)
+		member->accessCount++;
+
 	if(member->isStatic)
 		data = struc->staticData;
 	else if(data == NULL)
@@ -248,10 +387,156 @@ ptrs_var_t ptrs_struct_addressOfMember(ptrs_ast_t *ast, void *data, ptrs_struct_
 	return result;
 }
 
+#define PTRS_MEMBERCACHE_SIZE 4
+
+// per site cache for member accesses on values whose struct is not known at compile time
+// a hit loads or stores the ptrs_var_t at (instance & mask) + data, or calls the accessor
+// static members use a mask of 0 so data is an absolute address
+// the parent frame of a struct changes with every run of the function declaring it, hits
+// load it through the struct pointer in the meta instead of storing it in the entry
+struct ptrs_membercache
+{
+	// entries are never changed once published, a site only reads entries through these
+	// pointers so it always sees an entry together with the values it was published with
+	// sites with more than PTRS_MEMBERCACHE_SIZE structs take the slow path for the others
+	struct ptrs_membercacheentry
+	{
+		uint64_t meta; // meta of the struct
+		uintptr_t mask;
+		uintptr_t data;
+		void *accessor; // closure of a getter or setter, NULL for plain variables
+		void *function; // closure of function members, NULL for other members
+		bool needsInstance;
+	} *entries[PTRS_MEMBERCACHE_SIZE];
+	int next;
+};
+
+static struct ptrs_membercache *createMemberCache()
+{
+	struct ptrs_membercache *cache = malloc(sizeof(struct ptrs_membercache));
+	for(int i = 0; i < PTRS_MEMBERCACHE_SIZE; i++)
+		cache->entries[i] = NULL;
+	cache->next = 0;
+	return cache;
+}
+
+static void cacheMember(ptrs_ast_t *ast, struct ptrs_membercache *cache, ptrs_meta_t meta,
+	struct ptrs_structmember *member, bool isAssign)
+{
+	ptrs_struct_t *struc = ptrs_meta_getPointer(meta);
+	for(int i = 0; i < PTRS_MEMBERCACHE_SIZE; i++)
+	{
+		struct ptrs_membercacheentry *curr = __atomic_load_n(&cache->entries[i], __ATOMIC_ACQUIRE);
+		if(curr != NULL && curr->meta == *(uint64_t *)&meta)
+			return;
+	}
+
+	if(__atomic_load_n(&cache->next, __ATOMIC_RELAXED) >= PTRS_MEMBERCACHE_SIZE)
+		return;
+
+	struct ptrs_membercacheentry entry;
+	entry.meta = *(uint64_t *)&meta;
+	entry.mask = 0;
+	entry.data = 0;
+	entry.accessor = NULL;
+	entry.function = NULL;
+	entry.needsInstance = !member->isStatic;
+
+	if(member->type == PTRS_STRUCTMEMBER_VAR)
+	{
+		entry.mask = member->isStatic ? 0 : UINTPTR_MAX;
+		entry.data = (member->isStatic ? (uintptr_t)struc->staticData : 0) + member->offset;
+	}
+	else if(member->type == PTRS_STRUCTMEMBER_FUNCTION && !isAssign)
+	{
+		entry.function = ptrs_jit_function_to_closure(ast, member->value.function.func);
+	}
+	else if(member->type == (isAssign ? PTRS_STRUCTMEMBER_SETTER : PTRS_STRUCTMEMBER_GETTER))
+	{
+		entry.accessor = ptrs_jit_function_to_closure(ast, member->value.function.func);
+	}
+	else
+	{
+		// typed and array members as well as overloads always take the slow path
+		return;
+	}
+
+	// two threads missing on the same struct at once only results in a duplicate entry
+	int slot = __atomic_fetch_add(&cache->next, 1, __ATOMIC_RELAXED);
+	if(slot >= PTRS_MEMBERCACHE_SIZE)
+		return;
+
+	struct ptrs_membercacheentry *published = malloc(sizeof(struct ptrs_membercacheentry));
+	*published = entry;
+	__atomic_store_n(&cache->entries[slot], published, __ATOMIC_RELEASE);
+}
+
+// emits a lookup of meta in the cache, branches to miss when there is no entry for it
+// or when an instance member is accessed on the struct itself, leaving the error to the slow path
+static jit_value_t findCacheEntry(jit_function_t func, struct ptrs_membercache *cache,
+	jit_value_t instance, jit_value_t meta, jit_label_t *miss)
+{
+	jit_value_t entry = jit_value_create(func, jit_type_void_ptr);
+	jit_label_t found = jit_label_undefined;
+
+	for(int i = 0; i < PTRS_MEMBERCACHE_SIZE; i++)
+	{
+		// slots are filled in order, an empty one means all following ones are empty too
+		jit_value_t entryVal = jit_insn_load_relative(func,
+			jit_const_int(func, void_ptr, (uintptr_t)&cache->entries[i]), 0, jit_type_void_ptr);
+		jit_insn_store(func, entry, entryVal);
+		jit_insn_branch_if_not(func, entryVal, miss);
+
+		jit_value_t entryMeta = jit_insn_load_relative(func, entryVal,
+			offsetof(struct ptrs_membercacheentry, meta), jit_type_ulong);
+		jit_insn_branch_if(func, jit_insn_eq(func, entryMeta, meta), &found);
+	}
+
+	jit_insn_branch(func, miss);
+	jit_insn_label(func, &found);
+
+	if(ptrs_enableSafety)
+	{
+		jit_label_t hasInstance = jit_label_undefined;
+		jit_insn_branch_if(func, instance, &hasInstance);
+
+		jit_value_t needsInstance = jit_insn_load_relative(func, entry,
+			offsetof(struct ptrs_membercacheentry, needsInstance), jit_type_sys_bool);
+		jit_insn_branch_if(func, needsInstance, miss);
+
+		jit_insn_label(func, &hasInstance);
+	}
+
+	return entry;
+}
+
+// the current parent frame of the struct in meta
+static jit_value_t getCachedParentFrame(jit_function_t func, jit_value_t meta)
+{
+	jit_value_t struc = ptrs_jit_getMetaPointer(func, meta);
+	return jit_insn_load_relative(func, struc, offsetof(ptrs_struct_t, parentFrame), jit_type_void_ptr);
+}
+
+// address of the ptrs_var_t a plain variable entry refers to
+static jit_value_t getCachedAddress(jit_function_t func, jit_value_t entry, jit_value_t instance)
+{
+	jit_value_t mask = jit_insn_load_relative(func, entry,
+		offsetof(struct ptrs_membercacheentry, mask), jit_type_nuint);
+	jit_value_t data = jit_insn_load_relative(func, entry,
+		offsetof(struct ptrs_membercacheentry, data), jit_type_nuint);
+
+	instance = ptrs_jit_reinterpretCast(func, instance, jit_type_nuint);
+	return jit_insn_add(func, jit_insn_and(func, instance, mask), data);
+}
+
 ptrs_var_t ptrs_struct_get(ptrs_ast_t *ast, void *instance, ptrs_meta_t meta,
 	const char *key, uint32_t keyLen)
 {
-	if(meta.type != PTRS_TYPE_STRUCT)
+	if(ptrs_structarray_isArray(meta))
+		return ptrs_structarray_getColumn(ast, instance, meta, key, keyLen);
+	else if(meta.type == PTRS_TYPE_MAP)
+		return ptrs_map_getMember(ast, instance, key, keyLen);
+	else if(meta.type != PTRS_TYPE_STRUCT)
 		ptrs_error(ast, "Cannot get property %s of a value of type %t", key, meta.type);
 	ptrs_struct_t *struc = ptrs_meta_getPointer(meta);
 
@@ -259,7 +544,7 @@ ptrs_var_t ptrs_struct_get(ptrs_ast_t *ast, void *instance, ptrs_meta_t meta,
 		PTRS_STRUCTMEMBER_SETTER, ast);
 	if(member == NULL)
 	{
-		jit_function_t overload = ptrs_struct_getOverload(struc, ptrs_handle_member, instance != NULL);
+		jit_function_t overload = ptrs_struct_getOverload(struc, PTRS_STRUCTOP_MEMBER, instance != NULL);
 		if(overload == NULL)
 			ptrs_error(ast, "Struct %s has no property named %s", struc->name, key);
 
@@ -275,6 +560,318 @@ ptrs_var_t ptrs_struct_get(ptrs_ast_t *ast, void *instance, ptrs_meta_t meta,
 
 	return ptrs_struct_getMember(ast, instance, struc, member);
 }
+ptrs_var_t ptrs_struct_getCached(ptrs_ast_t *ast, void *instance, ptrs_meta_t meta,
+	const char *key, uint32_t keyLen, struct ptrs_membercache *cache)
+{
+	ptrs_var_t result = ptrs_struct_get(ast, instance, meta, key, keyLen);
+	if(meta.type != PTRS_TYPE_STRUCT)
+		return result;
+
+	// ptrs_struct_get only returns for structs having an accessible member or a member overload
+	struct ptrs_structmember *member = ptrs_struct_find(ptrs_meta_getPointer(meta), key, keyLen,
+		PTRS_STRUCTMEMBER_SETTER, ast);
+	if(member != NULL && (member->isStatic || instance != NULL))
+		cacheMember(ast, cache, meta, member, false);
+
+	return result;
+}
+static ptrs_jit_var_t getThroughInlineCache(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t base, jit_value_t keyVal, jit_value_t keyLen)
+{
+	struct ptrs_membercache *cache = createMemberCache();
+	ptrs_jit_var_t result = {
+		.val = jit_value_create(func, jit_type_long),
+		.meta = jit_value_create(func, jit_type_ulong),
+		.constType = -1,
+	};
+
+	jit_label_t miss = jit_label_undefined;
+	jit_label_t noGetter = jit_label_undefined;
+	jit_label_t done = jit_label_undefined;
+	jit_value_t entry = findCacheEntry(func, cache, base.val, base.meta, &miss);
+
+	jit_value_t getter = jit_insn_load_relative(func, entry,
+		offsetof(struct ptrs_membercacheentry, accessor), jit_type_void_ptr);
+	jit_insn_branch_if_not(func, getter, &noGetter);
+
+	jit_value_t parentFrame = getCachedParentFrame(func, base.meta);
+	jit_value_t thisPtr = ptrs_jit_reinterpretCast(func, base.val, jit_type_void_ptr);
+	jit_type_t getterSig = ptrs_jit_getSignature(jit_abi_cdecl,
+		ptrs_jit_getVarType(), (jit_type_t []){jit_type_void_ptr}, 1);
+	jit_value_t retVal = jit_insn_call_nested_indirect(func, getter,
+		parentFrame, getterSig, &thisPtr, 1, 0);
+
+	ptrs_jit_var_t ret = ptrs_jit_valToVar(func, retVal);
+	jit_insn_store(func, result.val, ret.val);
+	jit_insn_store(func, result.meta, ret.meta);
+	jit_insn_branch(func, &done);
+
+	jit_insn_label(func, &noGetter);
+	jit_label_t noFunction = jit_label_undefined;
+	jit_value_t closure = jit_insn_load_relative(func, entry,
+		offsetof(struct ptrs_membercacheentry, function), jit_type_void_ptr);
+	jit_insn_branch_if_not(func, closure, &noFunction);
+
+	jit_insn_store(func, result.val, ptrs_jit_reinterpretCast(func, closure, jit_type_long));
+	jit_insn_store(func, result.meta, ptrs_jit_pointerMeta(func,
+		jit_const_long(func, ulong, PTRS_TYPE_FUNCTION), getCachedParentFrame(func, base.meta)));
+	jit_insn_branch(func, &done);
+
+	jit_insn_label(func, &noFunction);
+	jit_value_t address = getCachedAddress(func, entry, base.val);
+	jit_insn_store(func, result.val, jit_insn_load_relative(func, address, 0, jit_type_long));
+	jit_insn_store(func, result.meta,
+		jit_insn_load_relative(func, address, sizeof(ptrs_val_t), jit_type_ulong));
+	jit_insn_branch(func, &done);
+
+	jit_insn_label(func, &miss);
+	jit_value_t missVal;
+	ptrs_jit_reusableCall(func, ptrs_struct_getCached, missVal, ptrs_jit_getVarType(),
+		(jit_type_void_ptr, jit_type_long, jit_type_ulong, jit_type_void_ptr, jit_type_int, jit_type_void_ptr),
+		(jit_const_int(func, void_ptr, (uintptr_t)node), base.val, base.meta, keyVal, keyLen,
+			jit_const_int(func, void_ptr, (uintptr_t)cache))
+	);
+
+	ret = ptrs_jit_valToVar(func, missVal);
+	jit_insn_store(func, result.val, ret.val);
+	jit_insn_store(func, result.meta, ret.meta);
+
+	jit_insn_label(func, &done);
+	return result;
+}
+// getters and setters with a body this small are compiled into the accessing function
+#define PTRS_INLINE_MAXNODES 16
+
+static ptrs_ast_vtable_t *inlineableOps[] = {
+	&ptrs_ast_vtable_op_equal, &ptrs_ast_vtable_op_inequal,
+	&ptrs_ast_vtable_op_lessequal, &ptrs_ast_vtable_op_greaterequal,
+	&ptrs_ast_vtable_op_less, &ptrs_ast_vtable_op_greater,
+	&ptrs_ast_vtable_op_logicor, &ptrs_ast_vtable_op_logicxor, &ptrs_ast_vtable_op_logicand,
+	&ptrs_ast_vtable_op_or, &ptrs_ast_vtable_op_xor, &ptrs_ast_vtable_op_and,
+	&ptrs_ast_vtable_op_ushr, &ptrs_ast_vtable_op_sshr, &ptrs_ast_vtable_op_shl,
+	&ptrs_ast_vtable_op_add, &ptrs_ast_vtable_op_sub, &ptrs_ast_vtable_op_mul,
+	&ptrs_ast_vtable_op_div, &ptrs_ast_vtable_op_mod,
+};
+static ptrs_ast_vtable_t *inlineablePrefixOps[] = {
+	&ptrs_ast_vtable_prefix_logicnot, &ptrs_ast_vtable_prefix_not,
+	&ptrs_ast_vtable_prefix_plus, &ptrs_ast_vtable_prefix_minus,
+};
+
+// returns the node count of an expression that only uses this, the setter value and constants
+// or -1 if the expression cannot be compiled outside of its function
+static int getInlineSize(ptrs_ast_t *node, ptrs_function_t *ast)
+{
+	ptrs_ast_vtable_t *vtable = node->vtable;
+	int left, right;
+
+	if(vtable == &ptrs_ast_vtable_constant)
+		return 1;
+
+	if(vtable == &ptrs_ast_vtable_identifier)
+	{
+		struct ptrs_ast_identifier *expr = &node->arg.identifier;
+		if(expr->valuePredicted)
+			return -1;
+		else if(expr->location == &ast->thisVal)
+			return 1;
+		else if(ast->args != NULL && expr->location == &ast->args->arg
+			&& !expr->metaPredicted && !expr->typePredicted)
+			return 1;
+		else
+			return -1;
+	}
+
+	if(vtable == &ptrs_ast_vtable_member)
+	{
+		left = getInlineSize(node->arg.member.base, ast);
+		return left < 0 ? -1 : left + 1;
+	}
+
+	if(vtable == &ptrs_ast_vtable_index)
+	{
+		left = getInlineSize(node->arg.binary.left, ast);
+		right = getInlineSize(node->arg.binary.right, ast);
+		return left < 0 || right < 0 ? -1 : left + right + 1;
+	}
+
+	for(int i = 0; i < sizeof(inlineableOps) / sizeof(inlineableOps[0]); i++)
+	{
+		if(vtable == inlineableOps[i])
+		{
+			left = getInlineSize(node->arg.binary.left, ast);
+			right = getInlineSize(node->arg.binary.right, ast);
+			return left < 0 || right < 0 ? -1 : left + right + 1;
+		}
+	}
+
+	for(int i = 0; i < sizeof(inlineablePrefixOps) / sizeof(inlineablePrefixOps[0]); i++)
+	{
+		if(vtable == inlineablePrefixOps[i])
+		{
+			left = getInlineSize(node->arg.astval, ast);
+			return left < 0 ? -1 : left + 1;
+		}
+	}
+
+	return -1;
+}
+
+// returns the expression a getter returns or a setter evaluates if the accessor can be inlined
+static ptrs_ast_t *getInlineBody(struct ptrs_structmember *member)
+{
+	ptrs_function_t *ast = member->value.function.ast;
+	if(ast == NULL || ast->inlining || ast->usesTryCatch || ast->thisVal.addressable
+		|| ast->body->vtable != &ptrs_ast_vtable_body)
+		return NULL;
+
+	struct ptrs_astlist *list = ast->body->arg.astlist;
+	if(list == NULL || list->next != NULL || list->entry == NULL)
+		return NULL;
+
+	ptrs_ast_t *stmt = list->entry;
+	ptrs_ast_t *expr;
+	if(member->type == PTRS_STRUCTMEMBER_GETTER)
+	{
+		// return values of getters with a declared type are checked inside the getter
+		if(stmt->vtable != &ptrs_ast_vtable_return || stmt->arg.astval == NULL
+			|| (ast->retType.meta.type != (uint8_t)-1 && !ast->retTypeInferred))
+			return NULL;
+
+		expr = stmt->arg.astval;
+		int size = getInlineSize(expr, ast);
+		if(size < 0 || size > PTRS_INLINE_MAXNODES)
+			return NULL;
+	}
+	else
+	{
+		if(stmt->vtable != &ptrs_ast_vtable_exprstatement || ast->args->arg.addressable)
+			return NULL;
+
+		// only this.x = ...; or x = ...; is inlined
+		expr = stmt->arg.astval;
+		if(expr == NULL || expr->vtable != &ptrs_ast_vtable_op_assign)
+			return NULL;
+
+		ptrs_ast_t *target = expr->arg.binary.left;
+		if(target->vtable != &ptrs_ast_vtable_member && target->vtable != &ptrs_ast_vtable_index)
+			return NULL;
+
+		int size = getInlineSize(target, ast);
+		int valueSize = getInlineSize(expr->arg.binary.right, ast);
+		if(size < 0 || valueSize < 0 || size + valueSize + 1 > PTRS_INLINE_MAXNODES)
+			return NULL;
+	}
+
+	return expr;
+}
+
+// compiles the body of a getter or setter into func, with this and the setter value
+// temporarily bound to values of func
+static bool inlineAccessor(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	struct ptrs_structmember *member, ptrs_jit_var_t base, ptrs_jit_var_t *value, ptrs_jit_var_t *result)
+{
+	ptrs_ast_t *expr = getInlineBody(member);
+	if(expr == NULL)
+		return false;
+
+	ptrs_function_t *ast = member->value.function.ast;
+	ptrs_jit_var_t oldThis = ast->thisVal;
+	ptrs_jit_var_t oldValue;
+
+	ast->thisVal.val = base.val;
+	ast->thisVal.meta = base.meta;
+	ast->thisVal.constType = PTRS_TYPE_STRUCT;
+	if(value != NULL)
+	{
+		oldValue = ast->args->arg;
+		ast->args->arg.val = ptrs_jit_reinterpretCast(func, value->val, jit_type_long);
+		ast->args->arg.meta = value->meta;
+		ast->args->arg.constType = value->constType;
+	}
+
+	ast->inlining = true;
+	ptrs_jit_var_t ret = expr->vtable->get(expr, func, scope);
+	ast->inlining = false;
+
+	ast->thisVal = oldThis;
+	if(value != NULL)
+		ast->args->arg = oldValue;
+
+	if(result != NULL)
+		*result = ret;
+	return true;
+}
+
+ptrs_jit_var_t ptrs_jit_struct_getMember(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_jit_var_t base, ptrs_struct_t *struc, struct ptrs_structmember *member)
+{
+	ptrs_jit_struct_countAccess(func, member);
+
+	jit_value_t data;
+	if(member->isStatic)
+	{
+		data = jit_const_int(func, void_ptr, (uintptr_t)struc->staticData);
+	}
+	else if(jit_value_is_constant(base.val) && !jit_value_is_true(base.val))
+	{
+		ptrs_error(node, "Property %s of struct %s is only available on instances",
+			member->name, struc->name);
+	}
+	else
+	{
+		data = base.val;
+	}
+
+	ptrs_jit_var_t result;
+	switch(member->type)
+	{
+		case PTRS_STRUCTMEMBER_VAR:
+			result.val = jit_insn_load_relative(func, data, member->offset, jit_type_long);
+
+			if(member->metaPredicted)
+				result.meta = jit_const_long(func, ulong, *(uint64_t *)&member->metaPrediction);
+			else
+				result.meta = jit_insn_load_relative(func, data,
+					member->offset + sizeof(ptrs_val_t), jit_type_long);
+
+			if(member->typePredicted)
+				result.constType = member->metaPrediction.type;
+			else
+				result.constType = -1;
+			return result;
+
+		case PTRS_STRUCTMEMBER_GETTER:
+			if(inlineAccessor(node, func, scope, member, base, NULL, &result))
+				return result;
+			return ptrs_jit_callnested(node, func, scope, base.val, member->value.function.func, NULL);
+
+		case PTRS_STRUCTMEMBER_FUNCTION:
+			;
+			jit_function_t target = member->value.function.func;
+			if(jit_function_get_nested_parent(target) == func)
+				ptrs_jit_markFrameReferenced(func);
+			result.val = jit_const_long(func, long, (uintptr_t)ptrs_jit_function_to_closure(node, target));
+			result.meta = ptrs_jit_pointerMeta(func,
+				jit_const_long(func, ulong, PTRS_TYPE_FUNCTION),
+				ptrs_jit_getParentFrame(func, target)
+			);
+			result.constType = PTRS_TYPE_FUNCTION;
+			return result;
+
+		case PTRS_STRUCTMEMBER_ARRAY:
+			result.val = jit_insn_add_relative(func, data, member->offset);
+			result.meta = jit_const_long(func, ulong, *(uint64_t *)&member->value.array);
+			result.constType = PTRS_TYPE_POINTER;
+			return result;
+
+		case PTRS_STRUCTMEMBER_TYPED:
+			result.val = jit_insn_load_relative(func, data, member->offset, member->value.type->jitType);
+			result.val = ptrs_jit_normalizeForVar(func, result.val);
+			result.meta = ptrs_jit_const_meta(func, member->value.type->varType);
+			result.constType = member->value.type->varType;
+			return result;
+	}
+}
 ptrs_jit_var_t ptrs_jit_struct_get(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
 	ptrs_jit_var_t base, jit_value_t keyVal, jit_value_t keyLen)
 {
@@ -287,7 +884,11 @@ ptrs_jit_var_t ptrs_jit_struct_get(ptrs_ast_t *node, jit_function_t func, ptrs_s
 		const char *key = (const char *)jit_value_get_nint_constant(keyVal);
 		uint32_t constKeyLen = jit_value_get_nint_constant(keyLen);
 
-		if(meta.type != PTRS_TYPE_STRUCT)
+		if(ptrs_structarray_isArray(meta))
+			return ptrs_jit_structarray_getColumn(node, func, base, key, constKeyLen);
+		else if(meta.type == PTRS_TYPE_MAP)
+			return ptrs_jit_map_getMember(node, func, base, key, constKeyLen);
+		else if(meta.type != PTRS_TYPE_STRUCT)
 			ptrs_error(node, "Cannot get property %s of value of type %t", key, meta.type);
 
 		struct ptrs_structmember *member = ptrs_struct_find(struc, key, constKeyLen,
@@ -295,7 +896,7 @@ ptrs_jit_var_t ptrs_jit_struct_get(ptrs_ast_t *node, jit_function_t func, ptrs_s
 		if(member == NULL)
 		{
 			bool isInstance = !jit_value_is_constant(base.val) || jit_value_is_true(base.val);
-			jit_function_t overload = ptrs_struct_getOverload(struc, ptrs_handle_member, isInstance);
+			jit_function_t overload = ptrs_struct_getOverload(struc, PTRS_STRUCTOP_MEMBER, isInstance);
 			if(overload == NULL)
 				ptrs_error(node, "Struct %s has no property named %s", struc->name, key);
 
@@ -311,63 +912,20 @@ ptrs_jit_var_t ptrs_jit_struct_get(ptrs_ast_t *node, jit_function_t func, ptrs_s
 			ptrs_error(node, "Cannot get setter only property %s of struct %s", key, struc->name);
 		}
 
-		jit_value_t data;
-		if(member->isStatic)
-		{
-			data = jit_const_int(func, void_ptr, (uintptr_t)struc->staticData);
-		}
-		else if(jit_value_is_constant(base.val) && !jit_value_is_true(base.val))
-		{
-			ptrs_error(node, "Property %s of struct %s is only available on instances",
-				member->name, struc->name);
-		}
-		else
-		{
-			data = base.val;
-		}
-
-		ptrs_jit_var_t result;
-		switch(member->type)
-		{
-			case PTRS_STRUCTMEMBER_VAR:
-				result.val = jit_insn_load_relative(func, data, member->offset, jit_type_long);
-				result.meta = jit_insn_load_relative(func, data,
-				member->offset + sizeof(ptrs_val_t), jit_type_long);
-				result.constType = -1;
-				return result;
-
-			case PTRS_STRUCTMEMBER_GETTER:
-				return ptrs_jit_callnested(node, func, scope, base.val, member->value.function.func, NULL);
-
-			case PTRS_STRUCTMEMBER_FUNCTION:
-				;
-				jit_function_t target = member->value.function.func;
-				result.val = jit_const_long(func, long, (uintptr_t)ptrs_jit_function_to_closure(node, target));
-				result.meta = ptrs_jit_pointerMeta(func,
-					jit_const_long(func, ulong, PTRS_TYPE_FUNCTION),
-					jit_insn_get_parent_frame_pointer_of(func, target)
-				);
-				result.constType = PTRS_TYPE_FUNCTION;
-				return result;
-
-			case PTRS_STRUCTMEMBER_ARRAY:
-				result.val = jit_insn_add_relative(func, data, member->offset);
-				result.meta = jit_const_long(func, ulong, *(uint64_t *)&member->value.array);
-				result.constType = PTRS_TYPE_POINTER;
-				return result;
-
-			case PTRS_STRUCTMEMBER_TYPED:
-				result.val = jit_insn_load_relative(func, data, member->offset, member->value.type->jitType);
-				result.val = ptrs_jit_normalizeForVar(func, result.val);
-				result.meta = ptrs_jit_const_meta(func, member->value.type->varType);
-				result.constType = member->value.type->varType;
-				return result;
-		}
+		return ptrs_jit_struct_getMember(node, func, scope, base, struc, member);
+	}
+	// hits of the inline cache would not be counted when profiling
+	else if(jit_value_is_constant(keyVal) && jit_value_is_constant(keyLen)
+		&& !ptrs_structProfile)
+	{
+		ptrs_report_fallback(func, node, "member");
+		return getThroughInlineCache(node, func, base, keyVal, keyLen);
 	}
 	else
 	{
 		jit_value_t ret;
 		jit_value_t astVal = jit_const_int(func, void_ptr, (uintptr_t)node);
+		ptrs_report_fallback(func, node, "member");
 		ptrs_jit_reusableCall(func, ptrs_struct_get, ret, ptrs_jit_getVarType(),
 			(jit_type_void_ptr, jit_type_long, jit_type_ulong, jit_type_void_ptr, jit_type_int),
 			(astVal, base.val, base.meta, keyVal, keyLen)
@@ -380,15 +938,22 @@ ptrs_jit_var_t ptrs_jit_struct_get(ptrs_ast_t *node, jit_function_t func, ptrs_s
 void ptrs_struct_set(ptrs_ast_t *ast, void *instance, ptrs_meta_t meta,
 	const char *key, uint32_t keyLen, ptrs_val_t val, ptrs_meta_t valMeta)
 {
-	if(meta.type != PTRS_TYPE_STRUCT)
+	if(meta.type == PTRS_TYPE_MAP)
+	{
+		ptrs_map_setMember(ast, instance, key, keyLen, val, valMeta);
+		return;
+	}
+	else if(meta.type != PTRS_TYPE_STRUCT)
+	{
 		ptrs_error(ast, "Cannot set property %s of a value of type %t", key, meta.type);
+	}
 	ptrs_struct_t *struc = ptrs_meta_getPointer(meta);
 
 	struct ptrs_structmember *member = ptrs_struct_find(struc, key, keyLen,
 		PTRS_STRUCTMEMBER_GETTER, ast);
 	if(member == NULL)
 	{
-		jit_function_t overload = ptrs_struct_getOverload(struc, ptrs_assign_member, instance != NULL);
+		jit_function_t overload = ptrs_struct_getOverload(struc, PTRS_STRUCTOP_ASSIGN_MEMBER, instance != NULL);
 		if(overload == NULL)
 			ptrs_error(ast, "Struct %s has no property named %s", struc->name, key);
 
@@ -405,6 +970,71 @@ void ptrs_struct_set(ptrs_ast_t *ast, void *instance, ptrs_meta_t meta,
 
 	ptrs_struct_setMember(ast, instance, struc, member, val, valMeta);
 }
+void ptrs_struct_setCached(ptrs_ast_t *ast, void *instance, ptrs_meta_t meta,
+	const char *key, uint32_t keyLen, ptrs_val_t val, ptrs_meta_t valMeta, struct ptrs_membercache *cache)
+{
+	ptrs_struct_set(ast, instance, meta, key, keyLen, val, valMeta);
+	if(meta.type != PTRS_TYPE_STRUCT)
+		return;
+
+	struct ptrs_structmember *member = ptrs_struct_find(ptrs_meta_getPointer(meta), key, keyLen,
+		PTRS_STRUCTMEMBER_GETTER, ast);
+	if(member != NULL && (member->isStatic || instance != NULL))
+		cacheMember(ast, cache, meta, member, true);
+}
+static void setThroughInlineCache(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t base, jit_value_t keyVal, jit_value_t keyLen, ptrs_jit_var_t value)
+{
+	struct ptrs_membercache *cache = createMemberCache();
+	jit_value_t val = ptrs_jit_reinterpretCast(func, value.val, jit_type_long);
+
+	jit_label_t miss = jit_label_undefined;
+	jit_label_t noSetter = jit_label_undefined;
+	jit_label_t done = jit_label_undefined;
+	jit_value_t entry = findCacheEntry(func, cache, base.val, base.meta, &miss);
+
+	jit_value_t setter = jit_insn_load_relative(func, entry,
+		offsetof(struct ptrs_membercacheentry, accessor), jit_type_void_ptr);
+	jit_insn_branch_if_not(func, setter, &noSetter);
+
+	jit_value_t parentFrame = getCachedParentFrame(func, base.meta);
+	jit_value_t args[3] = {ptrs_jit_reinterpretCast(func, base.val, jit_type_void_ptr), val, value.meta};
+	jit_type_t setterSig = ptrs_jit_getSignature(jit_abi_cdecl, ptrs_jit_getVarType(),
+		(jit_type_t []){jit_type_void_ptr, jit_type_long, jit_type_ulong}, 3);
+	jit_insn_call_nested_indirect(func, setter, parentFrame, setterSig, args, 3, 0);
+	jit_insn_branch(func, &done);
+
+	jit_insn_label(func, &noSetter);
+	jit_value_t address = getCachedAddress(func, entry, base.val);
+	jit_insn_store_relative(func, address, 0, val);
+	jit_insn_store_relative(func, address, sizeof(ptrs_val_t), value.meta);
+	jit_insn_branch(func, &done);
+
+	jit_insn_label(func, &miss);
+	ptrs_jit_reusableCallVoid(func, ptrs_struct_setCached,
+		(
+			jit_type_void_ptr,
+			jit_type_long,
+			jit_type_ulong,
+			jit_type_void_ptr,
+			jit_type_int,
+			jit_type_long,
+			jit_type_ulong,
+			jit_type_void_ptr
+		), (
+			jit_const_int(func, void_ptr, (uintptr_t)node),
+			base.val,
+			base.meta,
+			keyVal,
+			keyLen,
+			val,
+			value.meta,
+			jit_const_int(func, void_ptr, (uintptr_t)cache)
+		)
+	);
+
+	jit_insn_label(func, &done);
+}
 void ptrs_jit_struct_set(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
 	ptrs_jit_var_t base, jit_value_t keyVal, jit_value_t keyLen, ptrs_jit_var_t value)
 {
@@ -417,15 +1047,22 @@ void ptrs_jit_struct_set(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *sc
 		const char *key = (const char *)jit_value_get_nint_constant(keyVal);
 		uint32_t constKeyLen = jit_value_get_nint_constant(keyLen);
 
-		if(meta.type != PTRS_TYPE_STRUCT)
+		if(meta.type == PTRS_TYPE_MAP)
+		{
+			ptrs_jit_map_setMember(node, func, base, key, constKeyLen, value);
+			return;
+		}
+		else if(meta.type != PTRS_TYPE_STRUCT)
+		{
 			ptrs_error(node, "Cannot set property %s of value of type %t", key, meta.type);
+		}
 
 		struct ptrs_structmember *member = ptrs_struct_find(struc, key, constKeyLen,
 			PTRS_STRUCTMEMBER_GETTER, node);
 		if(member == NULL)
 		{
 			bool isInstance = !jit_value_is_constant(base.val) || jit_value_is_true(base.val);
-			jit_function_t overload = ptrs_struct_getOverload(struc, ptrs_assign_member, isInstance);
+			jit_function_t overload = ptrs_struct_getOverload(struc, PTRS_STRUCTOP_ASSIGN_MEMBER, isInstance);
 			if(overload == NULL)
 				ptrs_error(node, "Struct %s has no property named %s", struc->name, key);
 
@@ -445,6 +1082,8 @@ void ptrs_jit_struct_set(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *sc
 			ptrs_error(node, "Cannot set getter only property %s of struct %s", key, struc->name);
 		}
 
+		ptrs_jit_struct_countAccess(func, member);
+
 		jit_value_t data;
 		if(member->isStatic)
 		{
@@ -467,6 +1106,9 @@ void ptrs_jit_struct_set(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *sc
 		}
 		else if(member->type == PTRS_STRUCTMEMBER_SETTER)
 		{
+			if(inlineAccessor(node, func, scope, member, base, &value, NULL))
+				return;
+
 			jit_value_t args[3] = {base.val, value.val, value.meta};
 
 			const char *name = jit_function_get_meta(member->value.function.func, PTRS_JIT_FUNCTIONMETA_NAME);
@@ -489,8 +1131,15 @@ void ptrs_jit_struct_set(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *sc
 			ptrs_error(node, "Property %s of struct %s is not a valid lvalue", member->name, struc->name);
 		}
 	}
+	else if(jit_value_is_constant(keyVal) && jit_value_is_constant(keyLen)
+		&& !ptrs_structProfile)
+	{
+		ptrs_report_fallback(func, node, "assign member");
+		setThroughInlineCache(node, func, base, keyVal, keyLen, value);
+	}
 	else
 	{
+		ptrs_report_fallback(func, node, "assign member");
 		ptrs_jit_reusableCallVoid(func, ptrs_struct_set,
 			(
 				jit_type_void_ptr,
@@ -523,7 +1172,7 @@ ptrs_var_t ptrs_struct_addressOf(ptrs_ast_t *ast, void *instance, ptrs_meta_t me
 	struct ptrs_structmember *member = ptrs_struct_find(struc, key, keyLen, -1, ast);
 	if(member == NULL)
 	{
-		jit_function_t overload = ptrs_struct_getOverload(struc, ptrs_addressof_member, instance != NULL);
+		jit_function_t overload = ptrs_struct_getOverload(struc, PTRS_STRUCTOP_ADDRESSOF_MEMBER, instance != NULL);
 		if(overload == NULL)
 			ptrs_error(ast, "Struct %s has no property named %s", struc->name, key);
 
@@ -555,7 +1204,7 @@ ptrs_jit_var_t ptrs_jit_struct_addressof(ptrs_ast_t *node, jit_function_t func,
 		if(member == NULL)
 		{
 			bool isInstance = !jit_value_is_constant(base.val) || jit_value_is_true(base.val);
-			jit_function_t overload = ptrs_struct_getOverload(struc, ptrs_addressof_member, isInstance);
+			jit_function_t overload = ptrs_struct_getOverload(struc, PTRS_STRUCTOP_ADDRESSOF_MEMBER, isInstance);
 			if(overload == NULL)
 				ptrs_error(node, "Struct %s has no property named %s", struc->name, key);
 
@@ -567,6 +1216,8 @@ ptrs_jit_var_t ptrs_jit_struct_addressof(ptrs_ast_t *node, jit_function_t func,
 			return ptrs_jit_ncallnested(node, func, scope, base.val, overload, 1, &arg);
 		}
 
+		ptrs_jit_struct_countAccess(func, member);
+
 		jit_value_t data;
 		if(member->isStatic)
 		{
@@ -605,6 +1256,7 @@ ptrs_jit_var_t ptrs_jit_struct_addressof(ptrs_ast_t *node, jit_function_t func,
 	{
 		jit_value_t ret;
 		jit_value_t astVal = jit_const_int(func, void_ptr, (uintptr_t)node);
+		ptrs_report_fallback(func, node, "address of member");
 		ptrs_jit_reusableCall(func, ptrs_struct_addressOf, ret, ptrs_jit_getVarType(),
 			(jit_type_void_ptr, jit_type_long, jit_type_ulong, jit_type_void_ptr, jit_type_int),
 			(astVal, base.val, base.meta, keyVal, keyLen)
@@ -627,11 +1279,13 @@ ptrs_jit_var_t ptrs_jit_struct_call(ptrs_ast_t *node, jit_function_t func, ptrs_
 		const char *key = (const char *)jit_value_get_nint_constant(keyVal);
 		uint32_t constKeyLen = jit_value_get_nint_constant(keyLen);
 
-		if(meta.type != PTRS_TYPE_STRUCT)
+		if(meta.type != PTRS_TYPE_STRUCT && meta.type != PTRS_TYPE_MAP)
 			ptrs_error(node, "Cannot call property %s of value of type %t", key, meta.type);
 
-		struct ptrs_structmember *member = ptrs_struct_find(struc, key, constKeyLen,
-			PTRS_STRUCTMEMBER_SETTER, node);
+		struct ptrs_structmember *member = NULL;
+		if(meta.type == PTRS_TYPE_STRUCT)
+			member = ptrs_struct_find(struc, key, constKeyLen, PTRS_STRUCTMEMBER_SETTER, node);
+
 		if(member == NULL || member->type != PTRS_STRUCTMEMBER_FUNCTION)
 		{
 			ptrs_jit_var_t callee = ptrs_jit_struct_get(node, func, scope, base, keyVal, keyLen);
@@ -643,6 +1297,7 @@ ptrs_jit_var_t ptrs_jit_struct_call(ptrs_ast_t *node, jit_function_t func, ptrs_
 		}
 		else //member->type == PTRS_STRUCTMEMBER_FUNCTION
 		{
+			ptrs_jit_struct_countAccess(func, member);
 			return ptrs_jit_callnested(node, func, scope, base.val, member->value.function.func, args);
 		}
 	}
@@ -654,7 +1309,7 @@ ptrs_jit_var_t ptrs_jit_struct_call(ptrs_ast_t *node, jit_function_t func, ptrs_
 }
 
 ptrs_jit_var_t ptrs_struct_construct(ptrs_ast_t *ast, jit_function_t func, ptrs_scope_t *scope,
-	ptrs_jit_var_t constructor, struct ptrs_astlist *arguments, bool allocateOnStack)
+	ptrs_jit_var_t constructor, struct ptrs_astlist *arguments, bool allocateOnStack, bool allowReuse)
 {
 	ptrs_jit_typeCheck(ast, func, scope, constructor, PTRS_TYPE_STRUCT,
 		"Value of type %t is not a constructor");
@@ -665,30 +1320,39 @@ ptrs_jit_var_t ptrs_struct_construct(ptrs_ast_t *ast, jit_function_t func, ptrs_
 		ptrs_meta_t meta = ptrs_jit_value_getMetaConstant(constructor.meta);
 		ptrs_struct_t *struc = ptrs_meta_getPointer(meta);
 
-		jit_value_t size = jit_const_int(func, nuint, struc->size);
-		instance = ptrs_jit_allocate(func, size, allocateOnStack, false);
+		if(allocateOnStack)
+			instance = ptrs_jit_allocate(func, jit_const_int(func, nuint, struc->size), true, allowReuse);
+		else
+			instance = ptrs_jit_slabAllocate(func, struc);
 
-		jit_function_t ctor = ptrs_struct_getOverload(struc, ptrs_handle_new, true);
+		jit_function_t ctor = ptrs_struct_getOverload(struc, PTRS_STRUCTOP_NEW, true);
 		if(ctor != NULL)
 			ptrs_jit_callnested(ast, func, scope, instance, ctor, arguments);
 	}
 	else
 	{
 		jit_value_t struc = ptrs_jit_getMetaPointer(func, constructor.meta);
-		jit_value_t size = jit_insn_load_relative(func, struc,
-			offsetof(ptrs_struct_t, size), jit_type_uint);
+		if(allocateOnStack)
+		{
+			jit_value_t size = jit_insn_load_relative(func, struc,
+				offsetof(ptrs_struct_t, size), jit_type_uint);
+			instance = ptrs_jit_allocate(func, size, true, allowReuse);
+		}
+		else
+		{
+			instance = ptrs_jit_slabAllocateDynamic(func, struc);
+		}
 
-		instance = ptrs_jit_allocate(func, size, allocateOnStack, false);
+		jit_label_t noCtor = jit_label_undefined;
+		jit_value_t overload = jit_insn_load_relative(func, struc,
+			offsetof(ptrs_struct_t, overloadTable[PTRS_STRUCTOP_NEW][1]), jit_type_void_ptr);
+		jit_insn_branch_if_not(func, overload, &noCtor);
 
 		ptrs_jit_var_t ctor;
-		ptrs_jit_reusableCall(func, ptrs_struct_getOverloadClosure, ctor.val,
-			jit_type_void_ptr, (jit_type_void_ptr, jit_type_void_ptr, jit_type_int),
-			(struc, jit_const_int(func, void_ptr, (uintptr_t)ptrs_handle_new), jit_const_int(func, int, 1))
-		);
-
-		jit_label_t noCtor = jit_label_undefined;
-		jit_insn_branch_if_not(func, ctor.val, &noCtor);
+		ctor.val = jit_insn_load_relative(func, overload,
+			offsetof(struct ptrs_opoverload, handlerClosure), jit_type_void_ptr);
 
+		ptrs_jit_markFrameReferenced(func);
 		ctor.constType = PTRS_TYPE_FUNCTION;
 		ctor.meta = ptrs_jit_pointerMeta(func,
 			jit_const_long(func, ulong, PTRS_TYPE_FUNCTION),
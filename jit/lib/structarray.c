@@ -0,0 +1,288 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <jit/jit.h>
+
+#include "../../parser/common.h"
+#include "../../parser/ast.h"
+#include "../jit.h"
+
+#include "../include/error.h"
+#include "../include/util.h"
+#include "../include/call.h"
+#include "../include/struct.h"
+#include "../include/slab.h"
+#include "../include/structarray.h"
+
+extern size_t ptrs_arraymax;
+
+static const char *soaIndexError =
+	"Cannot index an array of struct %s with soa layout, index one of its columns instead";
+
+bool ptrs_structarray_isArray(ptrs_meta_t meta)
+{
+	return meta.type == PTRS_TYPE_POINTER && meta.array.typeIndex == PTRS_NATIVETYPE_INDEX_STRUCT;
+}
+
+bool ptrs_structarray_isSoa(ptrs_meta_t meta)
+{
+	return (meta.array.structId & PTRS_STRUCTARRAY_SOA) != 0;
+}
+
+ptrs_struct_t *ptrs_structarray_getStruct(ptrs_meta_t meta)
+{
+	return ptrs_slab_getStruct(meta.array.structId & PTRS_STRUCTARRAY_MAXID);
+}
+
+size_t ptrs_structarray_getStride(ptrs_struct_t *struc)
+{
+	return (struc->size + 7) & ~(size_t)7;
+}
+
+ptrs_meta_t ptrs_structarray_getMeta(ptrs_ast_t *node, ptrs_struct_t *struc, bool soa, uint32_t size)
+{
+	uint32_t id = ptrs_slab_getId(struc);
+	if(id > PTRS_STRUCTARRAY_MAXID)
+		ptrs_error(node, "Too many structs exist to create an array of struct %s", struc->name);
+
+	ptrs_meta_t meta = {0};
+	meta.type = PTRS_TYPE_POINTER;
+	meta.array.typeIndex = PTRS_NATIVETYPE_INDEX_STRUCT;
+	meta.array.structId = soa ? id | PTRS_STRUCTARRAY_SOA : id;
+	meta.array.size = size;
+	return meta;
+}
+
+ptrs_meta_t ptrs_structarray_getElementMeta(ptrs_meta_t meta)
+{
+	ptrs_meta_t elementMeta = {0};
+	elementMeta.type = PTRS_TYPE_STRUCT;
+	ptrs_meta_setPointer(elementMeta, ptrs_structarray_getStruct(meta));
+	return elementMeta;
+}
+
+// only members stored in every instance get a column, var members use a column of type var
+static bool isColumn(struct ptrs_structmember *member)
+{
+	return member->name != NULL && !member->isStatic
+		&& (member->type == PTRS_STRUCTMEMBER_VAR || member->type == PTRS_STRUCTMEMBER_TYPED);
+}
+static ptrs_nativetype_info_t *getColumnType(struct ptrs_structmember *member)
+{
+	if(member->type == PTRS_STRUCTMEMBER_VAR)
+		return &ptrs_nativeTypes[PTRS_NATIVETYPE_INDEX_VAR];
+	else
+		return member->value.type;
+}
+
+static void checkColumns(ptrs_ast_t *node, ptrs_struct_t *struc)
+{
+	for(int i = 0; i < struc->memberCount; i++)
+	{
+		struct ptrs_structmember *member = &struc->member[i];
+		if(member->name != NULL && !member->isStatic && member->type == PTRS_STRUCTMEMBER_ARRAY)
+			ptrs_error(node, "Array member %s of struct %s cannot be stored in a column", member->name, struc->name);
+	}
+}
+
+static void constructElements(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_struct_t *struc, jit_function_t ctor, jit_value_t data, jit_value_t size, bool soa)
+{
+	// with the soa layout every element is constructed in a temporary instance and then moved to the columns
+	jit_value_t instance = NULL;
+	jit_value_t instanceSize = jit_const_int(func, nuint, struc->size);
+	if(soa)
+		instance = ptrs_jit_allocate(func, instanceSize, true, true);
+
+	jit_value_t index = jit_value_create(func, jit_type_long);
+	jit_insn_store(func, index, jit_const_long(func, long, 0));
+
+	jit_label_t loop = jit_label_undefined;
+	jit_label_t done = jit_label_undefined;
+	jit_insn_label(func, &loop);
+	jit_insn_branch_if_not(func, jit_insn_lt(func, index, size), &done);
+
+	if(soa)
+	{
+		jit_insn_memset(func, instance, jit_const_int(func, ubyte, 0), instanceSize);
+		ptrs_jit_callnested(node, func, scope, instance, ctor, NULL);
+
+		for(int i = 0; i < struc->memberCount; i++)
+		{
+			struct ptrs_structmember *member = &struc->member[i];
+			if(!isColumn(member))
+				continue;
+
+			size_t memberSize = getColumnType(member)->size;
+			jit_value_t column = jit_insn_add(func, data,
+				jit_insn_mul(func, size, jit_const_long(func, long, member->offset)));
+			jit_value_t target = jit_insn_add(func, column,
+				jit_insn_mul(func, index, jit_const_long(func, long, memberSize)));
+
+			jit_insn_memcpy(func, target, jit_insn_add_relative(func, instance, member->offset),
+				jit_const_int(func, nuint, memberSize));
+		}
+	}
+	else
+	{
+		jit_value_t stride = jit_const_long(func, long, ptrs_structarray_getStride(struc));
+		jit_value_t element = jit_insn_add(func, data, jit_insn_mul(func, index, stride));
+		ptrs_jit_callnested(node, func, scope, element, ctor, NULL);
+	}
+
+	jit_insn_store(func, index, jit_insn_add(func, index, jit_const_long(func, long, 1)));
+	jit_insn_branch(func, &loop);
+	jit_insn_label(func, &done);
+}
+
+ptrs_jit_var_t ptrs_jit_structarray_create(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_jit_var_t constructor, ptrs_jit_var_t length, bool soa, bool onStack)
+{
+	ptrs_jit_typeCheck(node, func, scope, constructor, PTRS_TYPE_STRUCT,
+		"Value of type %t is not a constructor");
+	if(!jit_value_is_constant(constructor.meta))
+		ptrs_error(node, "The struct of an array of structs needs to be known at compile time");
+
+	ptrs_meta_t constructorMeta = ptrs_jit_value_getMetaConstant(constructor.meta);
+	ptrs_struct_t *struc = ptrs_meta_getPointer(constructorMeta);
+	ptrs_meta_t meta = ptrs_structarray_getMeta(node, struc, soa, 0);
+	if(soa)
+		checkColumns(node, struc);
+
+	ptrs_jit_typeCheck(node, func, scope, length, PTRS_TYPE_INT, "Array size needs to be of type int not %t");
+	jit_value_t size = length.val;
+
+	ptrs_jit_assert(node, func, scope, jit_insn_le(func, size, jit_const_int(func, nuint, ptrs_arraymax)),
+		1, "Cannot create array of size %d", size);
+
+	// all instances are zero initialized, the constructor is called for each of them
+	jit_value_t byteSize = jit_insn_mul(func, size,
+		jit_const_long(func, ulong, ptrs_structarray_getStride(struc)));
+	jit_value_t data = ptrs_jit_allocate(func, byteSize, onStack, true);
+	jit_insn_memset(func, data, jit_const_int(func, ubyte, 0), byteSize);
+
+	jit_function_t ctor = ptrs_struct_getOverload(struc, PTRS_STRUCTOP_NEW, true);
+	if(ctor != NULL)
+		constructElements(node, func, scope, struc, ctor, data, size, soa);
+
+	ptrs_jit_var_t ret;
+	ret.val = data;
+	ret.meta = jit_insn_or(func,
+		jit_insn_shl(func,
+			jit_insn_convert(func, size, jit_type_ulong, 0),
+			jit_const_long(func, ulong, 32)
+		),
+		jit_const_long(func, ulong, *(uint64_t *)&meta)
+	);
+	ret.constType = PTRS_TYPE_POINTER;
+	ret.addressable = false;
+	return ret;
+}
+
+ptrs_var_t ptrs_structarray_index(ptrs_ast_t *node, void *base, ptrs_meta_t meta, int64_t index)
+{
+	ptrs_struct_t *struc = ptrs_structarray_getStruct(meta);
+	if(ptrs_structarray_isSoa(meta))
+		ptrs_error(node, soaIndexError, struc->name);
+
+	ptrs_var_t result;
+	result.value.ptrval = (uint8_t *)base + index * ptrs_structarray_getStride(struc);
+	result.meta = ptrs_structarray_getElementMeta(meta);
+	return result;
+}
+
+ptrs_jit_var_t ptrs_jit_structarray_index(ptrs_ast_t *node, jit_function_t func,
+	ptrs_meta_t meta, jit_value_t base, jit_value_t index)
+{
+	ptrs_struct_t *struc = ptrs_structarray_getStruct(meta);
+	if(ptrs_structarray_isSoa(meta))
+		ptrs_error(node, soaIndexError, struc->name);
+
+	ptrs_meta_t elementMeta = ptrs_structarray_getElementMeta(meta);
+	jit_value_t stride = jit_const_long(func, long, ptrs_structarray_getStride(struc));
+
+	ptrs_jit_var_t result;
+	result.val = jit_insn_add(func, base, jit_insn_mul(func, index, stride));
+	result.meta = jit_const_long(func, ulong, *(uint64_t *)&elementMeta);
+	result.constType = PTRS_TYPE_STRUCT;
+	result.addressable = false;
+	return result;
+}
+
+void ptrs_structarray_assignIndex(ptrs_ast_t *node, void *base, ptrs_meta_t meta, int64_t index,
+	ptrs_val_t val, ptrs_meta_t valMeta)
+{
+	ptrs_struct_t *struc = ptrs_structarray_getStruct(meta);
+	if(ptrs_structarray_isSoa(meta))
+		ptrs_error(node, soaIndexError, struc->name);
+
+	if(valMeta.type != PTRS_TYPE_STRUCT || ptrs_meta_getPointer(valMeta) != struc || val.ptrval == NULL)
+		ptrs_error(node, "Only instances of struct %s can be stored in this array", struc->name);
+
+	memcpy((uint8_t *)base + index * ptrs_structarray_getStride(struc), val.ptrval, struc->size);
+}
+
+void ptrs_jit_structarray_assignIndex(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_meta_t meta, jit_value_t base, jit_value_t index, ptrs_jit_var_t val)
+{
+	ptrs_struct_t *struc = ptrs_structarray_getStruct(meta);
+	if(ptrs_structarray_isSoa(meta))
+		ptrs_error(node, soaIndexError, struc->name);
+
+	// assigning an element copies the instance into the array
+	ptrs_meta_t elementMeta = ptrs_structarray_getElementMeta(meta);
+	struct ptrs_assertion *check = ptrs_jit_assert(node, func, scope,
+		jit_insn_eq(func, val.meta, jit_const_long(func, ulong, *(uint64_t *)&elementMeta)),
+		1, "Only instances of struct %s can be stored in this array",
+		jit_const_int(func, void_ptr, (uintptr_t)struc->name));
+	ptrs_jit_appendAssert(func, check, jit_insn_ne(func, val.val, jit_const_long(func, long, 0)));
+
+	jit_value_t stride = jit_const_long(func, long, ptrs_structarray_getStride(struc));
+	jit_value_t element = jit_insn_add(func, base, jit_insn_mul(func, index, stride));
+	jit_insn_memcpy(func, element, val.val, jit_const_int(func, nuint, struc->size));
+}
+
+static struct ptrs_structmember *getColumn(ptrs_ast_t *node, ptrs_meta_t meta,
+	const char *key, uint32_t keyLen, uint8_t *typeIndex)
+{
+	ptrs_struct_t *struc = ptrs_structarray_getStruct(meta);
+	if(!ptrs_structarray_isSoa(meta))
+		ptrs_error(node, "Cannot get property %s of an array of struct %s, index the array first", key, struc->name);
+
+	struct ptrs_structmember *member = ptrs_struct_find(struc, key, keyLen, PTRS_STRUCTMEMBER_SETTER, node);
+	if(member == NULL || !isColumn(member))
+		ptrs_error(node, "Struct %s has no column named %s", struc->name, key);
+
+	*typeIndex = getColumnType(member) - ptrs_nativeTypes;
+	return member;
+}
+
+// column j of an array of n elements starts at n * offset_j, the columns never overlap
+// as the members do not overlap inside an instance
+ptrs_var_t ptrs_structarray_getColumn(ptrs_ast_t *node, void *base, ptrs_meta_t meta,
+	const char *key, uint32_t keyLen)
+{
+	uint8_t typeIndex;
+	struct ptrs_structmember *member = getColumn(node, meta, key, keyLen, &typeIndex);
+
+	ptrs_var_t result;
+	result.value.ptrval = (uint8_t *)base + (size_t)meta.array.size * member->offset;
+	*(uint64_t *)&result.meta = ptrs_const_arrayMeta(meta.array.size, typeIndex);
+	return result;
+}
+
+ptrs_jit_var_t ptrs_jit_structarray_getColumn(ptrs_ast_t *node, jit_function_t func,
+	ptrs_jit_var_t base, const char *key, uint32_t keyLen)
+{
+	ptrs_meta_t meta = ptrs_jit_value_getMetaConstant(base.meta);
+	uint8_t typeIndex;
+	struct ptrs_structmember *member = getColumn(node, meta, key, keyLen, &typeIndex);
+
+	ptrs_jit_var_t result;
+	result.val = jit_insn_add_relative(func, base.val, (jit_nint)meta.array.size * member->offset);
+	result.meta = ptrs_jit_const_arrayMeta(func, meta.array.size, typeIndex);
+	result.constType = PTRS_TYPE_POINTER;
+	result.addressable = false;
+	return result;
+}
@@ -67,6 +67,8 @@ ptrs_nativetype_info_t *ptrs_getNativeTypeForArray(ptrs_ast_t *node, ptrs_meta_t
 		else
 			return NULL;
 	}
+	if(meta.array.typeIndex == PTRS_NATIVETYPE_INDEX_STRUCT && node)
+		ptrs_error(node, "Arrays of structs only support indexing, sizeof and foreach");
 
 	return &ptrs_nativeTypes[meta.array.typeIndex];
 }
@@ -111,6 +113,46 @@ jit_type_t ptrs_jit_getVarType()
 	return jit_type_copy(vartype);
 }
 
+#define PTRS_SIGNATURECACHE_SIZE 1024
+typedef struct ptrs_signaturecache
+{
+	jit_type_t signature;
+	jit_abi_t abi;
+	jit_type_t retType;
+	unsigned int count;
+	struct ptrs_signaturecache *next;
+	jit_type_t params[];
+} ptrs_signaturecache_t;
+static ptrs_signaturecache_t *signatureCache[PTRS_SIGNATURECACHE_SIZE] = {0};
+
+jit_type_t ptrs_jit_getSignature(jit_abi_t abi, jit_type_t retType, jit_type_t *params, unsigned int count)
+{
+	uintptr_t hash = (uintptr_t)abi * 31 + (uintptr_t)retType;
+	for(unsigned int i = 0; i < count; i++)
+		hash = hash * 31 + (uintptr_t)params[i];
+	hash = (hash ^ (hash >> 17)) % PTRS_SIGNATURECACHE_SIZE;
+
+	ptrs_signaturecache_t *curr = signatureCache[hash];
+	for(; curr != NULL; curr = curr->next)
+	{
+		if(curr->abi == abi && curr->retType == retType && curr->count == count
+			&& memcmp(curr->params, params, count * sizeof(jit_type_t)) == 0)
+			return curr->signature;
+	}
+
+	// the cache keeps references to all types, so their addresses are never reused
+	curr = malloc(sizeof(ptrs_signaturecache_t) + count * sizeof(jit_type_t));
+	curr->signature = jit_type_create_signature(abi, retType, params, count, 1);
+	curr->abi = abi;
+	curr->retType = retType;
+	curr->count = count;
+	memcpy(curr->params, params, count * sizeof(jit_type_t));
+
+	curr->next = signatureCache[hash];
+	signatureCache[hash] = curr;
+	return curr->signature;
+}
+
 ptrs_jit_var_t ptrs_jit_valToVar(jit_function_t func, jit_value_t val)
 {
 	assert(jit_value_get_type(val) == ptrs_jit_getVarType());
@@ -161,7 +203,7 @@ ptrs_val_t ptrs_jit_value_getValConstant(jit_value_t val)
 		default: //int, uint, pointer
 			;
 			jit_long longVal2 = jit_value_get_nint_constant(val);
-			return *(ptrs_val_t *)&longVal;
+			return *(ptrs_val_t *)&longVal2;
 	}
 }
 
@@ -335,11 +377,21 @@ jit_type_t ptrs_jit_jitTypeFromTyping(ptrs_typing_t *typing)
 		return jit_type_long;
 }
 
+void ptrs_jit_markFrameReferenced(jit_function_t func)
+{
+	jit_function_set_meta(func, PTRS_JIT_FUNCTIONMETA_FRAMEREFERENCED, func, NULL, 0);
+}
+bool ptrs_jit_isFrameReferenced(jit_function_t func)
+{
+	return jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_FRAMEREFERENCED) != NULL;
+}
+
 jit_value_t ptrs_jit_allocate(jit_function_t func, jit_value_t size, bool onStack, bool allowReuse)
 {
 	jit_value_t ret;
 	if(onStack)
 	{
+		ptrs_jit_markFrameReferenced(func);
 		if(allowReuse && jit_value_is_constant(size))
 			ret = jit_insn_array(func, jit_value_get_nint_constant(size));
 		else
@@ -356,6 +408,87 @@ jit_value_t ptrs_jit_allocate(jit_function_t func, jit_value_t size, bool onStac
 	return ret;
 }
 
+// values computed at most once per call of a function, like pointers into the frames of parent functions
+// they are computed at their first use and kept in a local, which is cleared at the start of the function.
+// calls never reaching a use, e.g. of a capture only used on a cold path, do not walk the parent frames.
+// captured variables still live in the frame of the function declaring them and nested functions still
+// get the frame of their parent, there are no separate records holding only the captured variables
+typedef struct ptrs_hoisted
+{
+	void *key;
+	jit_value_t local;
+	struct ptrs_hoisted *next;
+} ptrs_hoisted_t;
+
+// returns the local caching the value of key, branches to done when it was already computed
+// the caller computes the value, stores it in the local and places the done label
+static jit_value_t getCached(jit_function_t func, void *key, jit_type_t type, jit_label_t *done)
+{
+	ptrs_hoisted_t *curr = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_HOISTED);
+	while(curr != NULL && curr->key != key)
+		curr = curr->next;
+
+	if(curr == NULL)
+	{
+		curr = malloc(sizeof(ptrs_hoisted_t));
+		curr->key = key;
+		curr->local = jit_value_create(func, type);
+		curr->next = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_HOISTED);
+		jit_function_set_meta(func, PTRS_JIT_FUNCTIONMETA_HOISTED, curr, NULL, 0);
+
+		jit_label_t start = jit_label_undefined;
+		jit_label_t end = jit_label_undefined;
+		jit_insn_label(func, &start);
+
+		jit_insn_store(func, curr->local, jit_const_int(func, void_ptr, 0));
+
+		jit_insn_label(func, &end);
+		jit_insn_move_blocks_to_start(func, start, end);
+	}
+
+	jit_insn_branch_if(func, curr->local, done);
+	return curr->local;
+}
+
+static jit_value_t importPointer(jit_function_t func, jit_value_t val)
+{
+	jit_label_t done = jit_label_undefined;
+	jit_value_t local = getCached(func, val, jit_type_void_ptr, &done);
+
+	jit_value_t ptr = jit_insn_import(func, val);
+	if(ptr == NULL)
+		return NULL;
+
+	jit_insn_store(func, local, ptr);
+	jit_insn_label(func, &done);
+	return local;
+}
+
+jit_value_t ptrs_jit_getParentFrame(jit_function_t func, jit_function_t target)
+{
+	jit_function_t parent = jit_function_get_nested_parent(target);
+	if(parent == func)
+		return jit_insn_get_parent_frame_pointer_of(func, target);
+
+	jit_label_t done = jit_label_undefined;
+	jit_value_t local = getCached(func, parent, jit_type_void_ptr, &done);
+
+	jit_insn_store(func, local, jit_insn_get_parent_frame_pointer_of(func, target));
+	jit_insn_label(func, &done);
+	return local;
+}
+
+jit_value_t ptrs_jit_hoistedCall(jit_function_t func, const char *name, void *callee, jit_type_t retType)
+{
+	jit_label_t done = jit_label_undefined;
+	jit_value_t local = getCached(func, callee, retType, &done);
+
+	jit_type_t signature = ptrs_jit_getSignature(jit_abi_cdecl, retType, NULL, 0);
+	jit_insn_store(func, local, jit_insn_call_native(func, name, callee, signature, NULL, 0, JIT_CALL_NOTHROW));
+	jit_insn_label(func, &done);
+	return local;
+}
+
 jit_value_t ptrs_jit_import(ptrs_ast_t *node, jit_function_t func, jit_value_t val, bool asPtr)
 {
 	if(jit_value_is_constant(val))
@@ -370,12 +503,15 @@ jit_value_t ptrs_jit_import(ptrs_ast_t *node, jit_function_t func, jit_value_t v
 	if(targetFunc == func)
 	{
 		if(asPtr)
+		{
+			ptrs_jit_markFrameReferenced(func);
 			return jit_insn_address_of(func, val);
+		}
 		else
 			return val;
 	}
 
-	jit_value_t ptr = jit_insn_import(func, val);
+	jit_value_t ptr = importPointer(func, val);
 	if(ptr == NULL)
 	{
 		const char *funcName = jit_function_get_meta(func, PTRS_JIT_FUNCTIONMETA_NAME);
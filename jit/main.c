@@ -10,16 +10,21 @@
 #include "include/run.h"
 #include "include/error.h"
 #include "include/conversion.h"
+#include "include/report.h"
+#include "include/slab.h"
+#include "include/struct.h"
 
 static bool handleSignals = true;
 static bool interactive = false;
 static bool dumpOps = false;
+static const char *structProfileFile = NULL;
 
 extern size_t ptrs_arraymax;
 extern bool ptrs_compileAot;
 extern bool ptrs_analyzeFlow;
 extern bool ptrs_dumpFlow;
 extern int ptrs_optimizationLevel;
+extern int ptrs_maxSpecializations;
 
 extern void ptrs_initialize_nativeTypes();
 
@@ -38,6 +43,11 @@ static struct option options[] = {
 	{"O1", no_argument, 0, 12},
 	{"O2", no_argument, 0, 13},
 	{"O3", no_argument, 0, 14},
+	{"max-specializations", required_argument, 0, 15},
+	{"prediction-report", required_argument, 0, 16},
+	{"struct-stats", no_argument, 0, 17},
+	{"struct-profile", required_argument, 0, 18},
+	{"struct-layout", required_argument, 0, 19},
 	{0, 0, 0, 0}
 };
 
@@ -61,9 +71,14 @@ static int parseOptions(int argc, char **argv)
 						"\t--no-aot             Disable AOT compilation\n"
 						"\t--no-predictions     Disable value/type predictions using data flow analyzation\n"
 						"\t-O0, -O1 or -O2      Set optimization level of the jit backend\n"
+						"\t--max-specializations <count>  Set how many argument type specialized clones are compiled per function. Default: 4\n"
 						"\t--dump-asm           Dump generated assembly code\n"
 						"\t--dump-jit           Dump JIT intermediate representation (same as --dump-asm --no-aot)\n"
 						"\t--dump-predictions   Dump value/type predictions\n"
+						"\t--prediction-report json  Output per function prediction coverage and intrinsic fallbacks\n"
+						"\t--struct-stats       Print live and allocated instances per struct type on exit\n"
+						"\t--struct-profile <file>  Count accesses of struct members and write them to 'file' on exit\n"
+						"\t--struct-layout <file>   Order members of compact structs using a profile written by --struct-profile\n"
 						"\t--asmdump            Output disassembly of generated instructions\n"
 						"\t--unsafe             Disable all assertions (including type checks)\n"
 					"Source code can be found at https://github.com/M4GNV5/PointerScript\n", UINT32_MAX);
@@ -114,6 +129,34 @@ static int parseOptions(int argc, char **argv)
 			case 14:
 				ptrs_optimizationLevel = 3;
 				break;
+			case 15:
+				ptrs_maxSpecializations = strtol(optarg, NULL, 0);
+				break;
+			case 16:
+				if(strcmp(optarg, "json") != 0)
+				{
+					fprintf(stderr, "Unsupported prediction report format %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				ptrs_predictionReport = true;
+				break;
+			case 17:
+				ptrs_slabStats = true;
+				break;
+			case 18:
+				ptrs_structProfile = true;
+				structProfileFile = optarg;
+				break;
+			case 19:
+				;
+				FILE *profile = fopen(optarg, "r");
+				if(profile == NULL || !ptrs_struct_readProfile(profile))
+				{
+					fprintf(stderr, "Could not read struct profile %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				fclose(profile);
+				break;
 			default:
 				fprintf(stderr, "Try '--help' for more information.\n");
 				exit(EXIT_FAILURE);
@@ -121,6 +164,24 @@ static int parseOptions(int argc, char **argv)
 	}
 }
 
+static void printSlabStats()
+{
+	ptrs_slab_printStats(stderr);
+}
+
+static void writeStructProfile()
+{
+	FILE *out = fopen(structProfileFile, "w");
+	if(out == NULL)
+	{
+		fprintf(stderr, "Could not open %s\n", structProfileFile);
+		return;
+	}
+
+	ptrs_struct_writeProfile(out);
+	fclose(out);
+}
+
 void exitOnError()
 {
 	ptrs_error_t *error = jit_exception_get_last();
@@ -145,6 +206,10 @@ int main(int argc, char **argv)
 
 	if(handleSignals)
 		ptrs_handle_signals();
+	if(ptrs_slabStats)
+		atexit(printSlabStats);
+	if(ptrs_structProfile)
+		atexit(writeStructProfile);
 
 	int len = argc - i;
 	ptrs_var_t arguments[len];
@@ -185,6 +250,11 @@ int main(int argc, char **argv)
 	{
 		// nothing
 	}
+	else if(ptrs_predictionReport)
+	{
+		ptrs_report_print(stdout, file);
+		return EXIT_SUCCESS;
+	}
 	else
 	{
 		ptrs_enableExceptions = true;
@@ -3,6 +3,7 @@
 #include "../include/conversion.h"
 #include "../include/error.h"
 #include "../include/util.h"
+#include "../include/report.h"
 
 #define const_typecomp(a, b) ((PTRS_TYPE_##a << 3) | PTRS_TYPE_##b)
 #define typecomp(a, b) ((a << 3) | b)
@@ -210,6 +211,7 @@ static jit_type_t getComparasionInstrinsicSignature()
 			right.meta \
 		}; \
 		\
+		ptrs_report_fallback(func, node, "(op " #operator ")"); \
 		jit_value_t retVal = jit_insn_call_native(func, "(op " #operator ")", \
 			ptrs_intrinsic_##name, getIntrinsicSignature(), args, 5, 0); \
 		\
@@ -313,6 +315,7 @@ static jit_type_t getComparasionInstrinsicSignature()
 				right.meta \
 			}; \
 			\
+			ptrs_report_fallback(func, node, "(op " #operator ")"); \
 			left.val = jit_insn_call_native(func, "(op " #operator ")", \
 				ptrs_intrinsic_##name, getComparasionInstrinsicSignature(), args, 5, 0); \
 		} \
@@ -3,6 +3,7 @@
 #include <inttypes.h>
 #include <assert.h>
 
+#include "jit.h"
 #include "../parser/ast.h"
 #include "../parser/common.h"
 #include "include/error.h"
@@ -12,6 +13,10 @@
 #include "include/util.h"
 #include "include/run.h"
 #include "include/astlist.h"
+#include "include/report.h"
+#include "include/nativeinline.h"
+#include "include/structarray.h"
+#include "include/map.h"
 #include "jit/jit-insn.h"
 #include "jit/jit-type.h"
 #include "jit/jit-value.h"
@@ -33,7 +38,14 @@ ptrs_jit_var_t ptrs_handle_call(ptrs_ast_t *node, jit_function_t func, ptrs_scop
 
 }
 
-ptrs_jit_var_t ptrs_handle_stringformat(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope)
+ptrs_jit_var_t ptrs_handle_expand(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope)
+{
+	// calls evaluate the array themselves, any other use is not supported
+	ptrs_error(node, "An array can only be expanded into the arguments of a call");
+	return (ptrs_jit_var_t){NULL, NULL, -1};
+}
+
+static ptrs_jit_var_t stringformatSnprintf(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope)
 {
 	struct ptrs_ast_strformat *expr = &node->arg.strformat;
 
@@ -59,7 +71,7 @@ ptrs_jit_var_t ptrs_handle_stringformat(ptrs_ast_t *node, jit_function_t func, p
 		curr = curr->next;
 	}
 
-	jit_type_t signature = jit_type_create_signature(jit_abi_cdecl, jit_type_sys_int, argDef, argCount, 0);
+	jit_type_t signature = ptrs_jit_getSignature(jit_abi_cdecl, jit_type_sys_int, argDef, argCount);
 
 	args[0] = jit_const_int(func, void_ptr, 0);
 	args[1] = jit_const_int(func, nuint, 0);
@@ -67,6 +79,7 @@ ptrs_jit_var_t ptrs_handle_stringformat(ptrs_ast_t *node, jit_function_t func, p
 
 	len = jit_insn_add(func, len, jit_const_int(func, sys_int, 1));
 	jit_value_t buff = jit_insn_alloca(func, len);
+	ptrs_jit_markFrameReferenced(func);
 
 	args[0] = buff;
 	args[1] = len;
@@ -80,13 +93,216 @@ ptrs_jit_var_t ptrs_handle_stringformat(ptrs_ast_t *node, jit_function_t func, p
 	return ret;
 }
 
+static size_t strformatInt(char *buff, int64_t val)
+{
+	char digits[20];
+	uint64_t absVal = val < 0 ? -(uint64_t)val : (uint64_t)val;
+	int count = 0;
+	do
+	{
+		digits[count++] = '0' + absVal % 10;
+		absVal /= 10;
+	} while(absVal != 0);
+
+	size_t len = 0;
+	if(val < 0)
+		buff[len++] = '-';
+	while(count > 0)
+		buff[len++] = digits[--count];
+
+	return len;
+}
+static size_t strformatFloat(char *buff, double val)
+{
+	return snprintf(buff, 32, "%g", val);
+}
+
+static jit_value_t appendLiteral(jit_function_t func, jit_value_t buff, jit_value_t pos,
+	const char *str, size_t len)
+{
+	if(len == 0)
+		return pos;
+
+	jit_value_t lenVal = jit_const_int(func, nuint, len);
+	jit_insn_memcpy(func, jit_insn_add(func, buff, pos),
+		jit_const_int(func, void_ptr, (uintptr_t)str), lenVal);
+	return jit_insn_add(func, pos, lenVal);
+}
+
+ptrs_jit_var_t ptrs_handle_stringformat(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope)
+{
+	struct ptrs_ast_strformat *expr = &node->arg.strformat;
+
+	// insertions with an explicit format like $%5d{val} are left to snprintf
+	struct ptrs_stringformat *curr;
+	for(curr = expr->insertions; curr != NULL; curr = curr->next)
+	{
+		if(!curr->convert)
+			return stringformatSnprintf(node, func, scope);
+	}
+
+	int count = expr->insertionCount;
+	ptrs_jit_var_t vals[count];
+	jit_value_t lengths[count];
+
+	// the format string including all %s and %% is an upper bound for the literal parts
+	size_t maxLen = strlen(expr->str) + 1;
+	jit_value_t size = NULL;
+
+	curr = expr->insertions;
+	for(int i = 0; i < count; i++)
+	{
+		ptrs_jit_var_t val = curr->entry->vtable->get(curr->entry, func, scope);
+		lengths[i] = NULL;
+
+		if(val.constType == PTRS_TYPE_INT)
+		{
+			maxLen += 20;
+		}
+		else if(val.constType == PTRS_TYPE_FLOAT)
+		{
+			maxLen += 32;
+		}
+		else if(val.constType == PTRS_TYPE_UNDEFINED)
+		{
+			maxLen += strlen("undefined");
+		}
+		else if(val.constType == PTRS_TYPE_POINTER && jit_value_is_constant(val.meta)
+			&& ptrs_jit_value_getMetaConstant(val.meta).array.typeIndex == PTRS_NATIVETYPE_INDEX_CHAR)
+		{
+			jit_value_t arraySize = ptrs_jit_getArraySize(func, val.meta);
+			ptrs_jit_reusableCall(func, strnlen, lengths[i], jit_type_nuint,
+				(jit_type_void_ptr, jit_type_nuint), (val.val, arraySize));
+		}
+		else
+		{
+			val = ptrs_jit_vartoa(func, val);
+			ptrs_jit_reusableCall(func, strlen, lengths[i], jit_type_nuint,
+				(jit_type_void_ptr), (val.val));
+		}
+
+		if(lengths[i] != NULL)
+			size = size == NULL ? lengths[i] : jit_insn_add(func, size, lengths[i]);
+
+		vals[i] = val;
+		curr = curr->next;
+	}
+
+	if(size == NULL)
+		size = jit_const_int(func, nuint, maxLen);
+	else
+		size = jit_insn_add(func, size, jit_const_int(func, nuint, maxLen));
+
+	jit_value_t buff = jit_insn_alloca(func, size);
+	ptrs_jit_markFrameReferenced(func);
+	jit_value_t pos = jit_const_int(func, nuint, 0);
+
+	const char *start = expr->str;
+	const char *str = expr->str;
+	int i = 0;
+	while(*str != 0)
+	{
+		if(str[0] == '%' && str[1] == '%')
+		{
+			pos = appendLiteral(func, buff, pos, start, str + 1 - start);
+			str += 2;
+			start = str;
+		}
+		else if(str[0] == '%' && str[1] == 's' && i < count)
+		{
+			pos = appendLiteral(func, buff, pos, start, str - start);
+			str += 2;
+			start = str;
+
+			ptrs_jit_var_t val = vals[i];
+			jit_value_t dest = jit_insn_add(func, buff, pos);
+			jit_value_t written;
+
+			if(val.constType == PTRS_TYPE_INT)
+			{
+				ptrs_jit_reusableCall(func, strformatInt, written, jit_type_nuint,
+					(jit_type_void_ptr, jit_type_long), (dest, val.val));
+			}
+			else if(val.constType == PTRS_TYPE_FLOAT)
+			{
+				val.val = ptrs_jit_reinterpretCast(func, val.val, jit_type_float64);
+				ptrs_jit_reusableCall(func, strformatFloat, written, jit_type_nuint,
+					(jit_type_void_ptr, jit_type_float64), (dest, val.val));
+			}
+			else if(val.constType == PTRS_TYPE_UNDEFINED)
+			{
+				pos = appendLiteral(func, buff, pos, "undefined", strlen("undefined"));
+				i++;
+				continue;
+			}
+			else
+			{
+				written = lengths[i];
+				jit_insn_memcpy(func, dest, val.val, written);
+			}
+
+			pos = jit_insn_add(func, pos, written);
+			i++;
+		}
+		else
+		{
+			str++;
+		}
+	}
+	pos = appendLiteral(func, buff, pos, start, str - start);
+
+	jit_insn_store_relative(func, jit_insn_add(func, buff, pos), 0, jit_const_int(func, ubyte, 0));
+	pos = jit_insn_add(func, pos, jit_const_int(func, nuint, 1));
+
+	ptrs_jit_var_t ret = {
+		.val = buff,
+		.meta = ptrs_jit_arrayMetaKnownType(func, pos, PTRS_NATIVETYPE_INDEX_CHAR),
+		.constType = PTRS_TYPE_POINTER,
+	};
+	return ret;
+}
+
 ptrs_jit_var_t ptrs_handle_new(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope)
 {
 	struct ptrs_ast_new *expr = &node->arg.newexpr;
 	ptrs_jit_var_t val = expr->value->vtable->get(expr->value, func, scope);
 
 	return ptrs_struct_construct(node, func, scope,
-		val, expr->arguments, expr->onStack);
+		val, expr->arguments, expr->onStack || expr->noEscape, expr->noEscape);
+}
+
+ptrs_jit_var_t ptrs_handle_structarray(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope)
+{
+	struct ptrs_ast_structarray *expr = &node->arg.structarray;
+	ptrs_jit_var_t constructor = expr->constructor->vtable->get(expr->constructor, func, scope);
+	ptrs_jit_var_t length = expr->length->vtable->get(expr->length, func, scope);
+
+	return ptrs_jit_structarray_create(node, func, scope, constructor, length, expr->soa, expr->onStack);
+}
+
+ptrs_jit_var_t ptrs_handle_map(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope)
+{
+	struct ptrs_ast_map *expr = &node->arg.map;
+
+	ptrs_jit_var_t map;
+	map.meta = ptrs_jit_const_meta(func, PTRS_TYPE_MAP);
+	map.constType = PTRS_TYPE_MAP;
+	map.addressable = false;
+	ptrs_jit_reusableCall(func, ptrs_map_create, map.val, jit_type_void_ptr,
+		(jit_type_uint),
+		(jit_const_int(func, uint, expr->count))
+	);
+
+	struct ptrs_astlist *key = expr->keys;
+	struct ptrs_astlist *value = expr->values;
+	for(; key != NULL; key = key->next, value = value->next)
+	{
+		ptrs_jit_var_t keyVal = key->entry->vtable->get(key->entry, func, scope);
+		ptrs_jit_var_t valueVal = value->entry->vtable->get(value->entry, func, scope);
+		ptrs_jit_map_set(node, func, map, keyVal, valueVal);
+	}
+
+	return map;
 }
 
 ptrs_jit_var_t ptrs_handle_member(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope)
@@ -142,7 +358,7 @@ ptrs_jit_var_t ptrs_handle_prefix_sizeof(ptrs_ast_t *node, jit_function_t func,
 
 	ptrs_jit_typeSwitch(node, func, scope, val,
 		(1, "Cannot get the size of a value of type %t", TYPESWITCH_TYPE),
-		(PTRS_TYPE_POINTER, PTRS_TYPE_STRUCT),
+		(PTRS_TYPE_POINTER, PTRS_TYPE_STRUCT, PTRS_TYPE_MAP),
 		case PTRS_TYPE_POINTER:
 			;
 			jit_value_t arraySize = ptrs_jit_getArraySize(func, val.meta);
@@ -163,6 +379,12 @@ ptrs_jit_var_t ptrs_handle_prefix_sizeof(ptrs_ast_t *node, jit_function_t func,
 					offsetof(ptrs_struct_t, size), jit_type_uint));
 			}
 			break;
+
+		case PTRS_TYPE_MAP:
+			// the number of entries
+			jit_insn_store(func, ret.val, jit_insn_load_relative(func, val.val,
+				offsetof(ptrs_map_t, size), jit_type_uint));
+			break;
 	);
 
 	return ret;
@@ -231,6 +453,7 @@ ptrs_jit_var_t ptrs_handle_prefix_dereference(ptrs_ast_t *node, jit_function_t f
 	else
 	{
 		jit_value_t result;
+		ptrs_report_fallback(func, node, "dereference");
 		ptrs_jit_reusableCall(func, ptrs_intrinsic_prefix_dereference, result, ptrs_jit_getVarType(),
 			(jit_type_void_ptr, jit_type_void_ptr, jit_type_ulong),
 			(jit_const_int(func, void_ptr, (uintptr_t)node), val.val, val.meta)
@@ -291,6 +514,7 @@ void ptrs_assign_prefix_dereference(ptrs_ast_t *node, jit_function_t func, ptrs_
 	else
 	{
 		jit_value_t result;
+		ptrs_report_fallback(func, node, "assign dereference");
 		ptrs_jit_reusableCallVoid(func, ptrs_intrinsic_assign_prefix_dereference,
 			(jit_type_void_ptr, jit_type_long, jit_type_ulong, jit_type_long, jit_type_ulong),
 			(jit_const_int(func, void_ptr, (uintptr_t)node), base.val, base.meta, val.val, val.meta)
@@ -319,6 +543,9 @@ ptrs_var_t ptrs_intrinsic_index(ptrs_ast_t *node, ptrs_val_t base, ptrs_meta_t b
 		if(index.intval < 0 || index.intval >= baseMeta.array.size)
 			ptrs_error(node, "Cannot get index %d of array of length %d", index.intval, baseMeta.array.size);
 
+		if(ptrs_structarray_isArray(baseMeta))
+			return ptrs_structarray_index(node, base.ptrval, baseMeta, index.intval);
+
 		ptrs_nativetype_info_t *type = ptrs_getNativeTypeForArray(node, baseMeta);
 		type->getHandler((uint8_t *)base.ptrval + index.intval * type->size, type->size, &result);
 	}
@@ -328,6 +555,10 @@ ptrs_var_t ptrs_intrinsic_index(ptrs_ast_t *node, ptrs_val_t base, ptrs_meta_t b
 		ptrs_var_t key = ptrs_vartoa(index, indexMeta, buff, 32);
 		result = ptrs_struct_get(node, base.ptrval, baseMeta, key.value.ptrval, key.meta.array.size);
 	}
+	else if(baseMeta.type == PTRS_TYPE_MAP)
+	{
+		result = ptrs_map_get(node, base.ptrval, index, indexMeta);
+	}
 	else
 	{
 		ptrs_error(node, "Cannot get index of value of type %t", baseMeta.type);
@@ -335,6 +566,29 @@ ptrs_var_t ptrs_intrinsic_index(ptrs_ast_t *node, ptrs_val_t base, ptrs_meta_t b
 
 	return result;
 }
+static void checkArrayIndex(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_jit_var_t index, jit_value_t arraySize)
+{
+	ptrs_jit_typeCheck(node, func, scope, index, PTRS_TYPE_INT, "Array index needs to be of type int not %t");
+
+	struct ptrs_assertion *sizeCheck = ptrs_jit_assert(node, func, scope,
+		jit_insn_lt(func, index.val, arraySize),
+		2, "Attempting to access index %d of an array of size %d", index.val, arraySize);
+	ptrs_jit_appendAssert(func, sizeCheck, jit_insn_ge(func, index.val, jit_const_long(func, ulong, 0)));
+}
+
+// the struct of an array whose size is only known at runtime, e.g. new Point[n], can still be
+// predicted, such arrays are indexed inline with the bound loaded from the meta
+static bool getPredictedStructArray(ptrs_ast_t *ast, ptrs_jit_var_t base, ptrs_meta_t *meta)
+{
+	if(ast->vtable != &ptrs_ast_vtable_identifier || !ast->arg.identifier.arrayPredicted
+		|| base.constType != PTRS_TYPE_POINTER || jit_value_is_constant(base.meta))
+		return false;
+
+	*meta = ast->arg.identifier.metaPrediction;
+	return true;
+}
+
 ptrs_jit_var_t ptrs_handle_index(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope)
 {
 	struct ptrs_ast_binary *expr = &node->arg.binary;
@@ -342,21 +596,32 @@ ptrs_jit_var_t ptrs_handle_index(ptrs_ast_t *node, jit_function_t func, ptrs_sco
 	ptrs_jit_var_t base = expr->left->vtable->get(expr->left, func, scope);
 
 	jit_value_t oldArraySize = scope->indexSize;
-	scope->indexSize = ptrs_jit_getArraySize(func, base.meta);
+	jit_value_t arraySize = ptrs_jit_getArraySize(func, base.meta);
+	scope->indexSize = arraySize;
 	ptrs_jit_var_t index = expr->right->vtable->get(expr->right, func, scope);
 	scope->indexSize = oldArraySize;
 
+	ptrs_meta_t arrayMeta;
+	if(getPredictedStructArray(expr->left, base, &arrayMeta))
+	{
+		checkArrayIndex(node, func, scope, index, arraySize);
+		return ptrs_jit_structarray_index(node, func, arrayMeta, base.val, index.val);
+	}
+
+	return ptrs_jit_index(node, func, scope, base, index);
+}
+ptrs_jit_var_t ptrs_jit_index(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_jit_var_t base, ptrs_jit_var_t index)
+{
 	if(base.constType == PTRS_TYPE_POINTER && jit_value_is_constant(base.meta))
 	{
-		ptrs_jit_typeCheck(node, func, scope, index, PTRS_TYPE_INT, "Array index needs to be of type int not %t");
 		ptrs_meta_t baseMeta = ptrs_jit_value_getMetaConstant(base.meta);
-		ptrs_nativetype_info_t *arrayType = ptrs_getNativeTypeForArray(node, baseMeta);
+		checkArrayIndex(node, func, scope, index, jit_const_long(func, ulong, baseMeta.array.size));
 
-		jit_value_t arraySize = jit_const_long(func, ulong, baseMeta.array.size);
-		struct ptrs_assertion *sizeCheck = ptrs_jit_assert(node, func, scope,
-			jit_insn_lt(func, index.val, arraySize),
-			2, "Attempting to access index %d of an array of size %d", index.val, arraySize);
-		ptrs_jit_appendAssert(func, sizeCheck, jit_insn_ge(func, index.val, jit_const_long(func, ulong, 0)));
+		if(ptrs_structarray_isArray(baseMeta))
+			return ptrs_jit_structarray_index(node, func, baseMeta, base.val, index.val);
+
+		ptrs_nativetype_info_t *arrayType = ptrs_getNativeTypeForArray(node, baseMeta);
 
 		ptrs_jit_var_t result;
 		result.addressable = false;
@@ -390,9 +655,14 @@ ptrs_jit_var_t ptrs_handle_index(ptrs_ast_t *node, jit_function_t func, ptrs_sco
 	{
 		return ptrs_jit_struct_get(node, func, scope, base, index.val, index.meta);
 	}
+	else if(base.constType == PTRS_TYPE_MAP)
+	{
+		return ptrs_jit_map_get(node, func, base, index);
+	}
 	else if(base.constType == -1 || base.constType == PTRS_TYPE_POINTER)
 	{
 		jit_value_t ret;
+		ptrs_report_fallback(func, node, "index");
 		ptrs_jit_reusableCall(func, ptrs_intrinsic_index, ret, ptrs_jit_getVarType(),
 			(jit_type_void_ptr, jit_type_long, jit_type_ulong, jit_type_long, jit_type_ulong),
 			(jit_const_int(func, void_ptr, (uintptr_t)node), base.val, base.meta, index.val, index.meta)
@@ -419,6 +689,12 @@ void ptrs_intrinsic_assign_index(ptrs_ast_t *node, ptrs_val_t base, ptrs_meta_t
 		if(index.intval < 0 || index.intval >= baseMeta.array.size)
 			ptrs_error(node, "Cannot get index %d of array of length %d", index.intval, baseMeta.array.size);
 
+		if(ptrs_structarray_isArray(baseMeta))
+		{
+			ptrs_structarray_assignIndex(node, base.ptrval, baseMeta, index.intval, val, valMeta);
+			return;
+		}
+
 		ptrs_nativetype_info_t *type = ptrs_getNativeTypeForArray(node, baseMeta);
 		if(type->varType != (uint8_t)-1 && type->varType != valMeta.type)
 			ptrs_error(node, "Cannot assign an array element to value of type %t", valMeta.type);
@@ -435,6 +711,10 @@ void ptrs_intrinsic_assign_index(ptrs_ast_t *node, ptrs_val_t base, ptrs_meta_t
 		ptrs_var_t key = ptrs_vartoa(index, indexMeta, buff, 32);
 		ptrs_struct_set(node, base.ptrval, baseMeta, key.value.ptrval, key.meta.array.size, val, valMeta);
 	}
+	else if(baseMeta.type == PTRS_TYPE_MAP)
+	{
+		ptrs_map_set(node, base.ptrval, index, indexMeta, val, valMeta);
+	}
 	else
 	{
 		ptrs_error(node, "Cannot assign index of value of type %t", baseMeta.type);
@@ -452,18 +732,26 @@ void ptrs_assign_index(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scop
 	ptrs_jit_var_t index = expr->right->vtable->get(expr->right, func, scope);
 	scope->indexSize = oldArraySize;
 
-	if(base.constType == PTRS_TYPE_POINTER && jit_value_is_constant(base.meta))
+	ptrs_meta_t arrayMeta;
+	if(getPredictedStructArray(expr->left, base, &arrayMeta))
+	{
+		checkArrayIndex(node, func, scope, index, baseArraySize);
+		ptrs_jit_structarray_assignIndex(node, func, scope, arrayMeta, base.val, index.val, val);
+	}
+	else if(base.constType == PTRS_TYPE_POINTER && jit_value_is_constant(base.meta))
 	{
-		ptrs_jit_typeCheck(node, func, scope, index, PTRS_TYPE_INT, "Array index needs to be of type int not %t");
 		ptrs_meta_t baseMeta = ptrs_jit_value_getMetaConstant(base.meta);
-		ptrs_nativetype_info_t *arrayType = ptrs_getNativeTypeForArray(node, baseMeta);
+		checkArrayIndex(node, func, scope, index, baseArraySize);
 
-		struct ptrs_assertion *sizeCheck = ptrs_jit_assert(node, func, scope,
-			jit_insn_lt(func, index.val, baseArraySize),
-			2, "Attempting to access index %d of an array of size %d", index.val, baseArraySize);
-		ptrs_jit_appendAssert(func, sizeCheck, jit_insn_ge(func, index.val, jit_const_long(func, ulong, 0)));
+		ptrs_nativetype_info_t *arrayType = NULL;
+		if(!ptrs_structarray_isArray(baseMeta))
+			arrayType = ptrs_getNativeTypeForArray(node, baseMeta);
 
-		if(arrayType->varType == (uint8_t)-1)
+		if(arrayType == NULL)
+		{
+			ptrs_jit_structarray_assignIndex(node, func, scope, baseMeta, base.val, index.val, val);
+		}
+		else if(arrayType->varType == (uint8_t)-1)
 		{
 			jit_value_t indexPos = jit_insn_shl(func, index.val, jit_const_long(func, ulong, 1));
 			jit_insn_store_elem(func, base.val, indexPos, val.val);
@@ -487,9 +775,14 @@ void ptrs_assign_index(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scop
 	{
 		ptrs_jit_struct_set(node, func, scope, base, index.val, index.meta, val);
 	}
+	else if(base.constType == PTRS_TYPE_MAP)
+	{
+		ptrs_jit_map_set(node, func, base, index, val);
+	}
 	else if(base.constType == -1 || base.constType == PTRS_TYPE_POINTER)
 	{
 		jit_value_t ret;
+		ptrs_report_fallback(func, node, "assign index");
 		ptrs_jit_reusableCallVoid(func, ptrs_intrinsic_assign_index,
 			(
 				jit_type_void_ptr,
@@ -580,6 +873,7 @@ ptrs_jit_var_t ptrs_addressof_index(ptrs_ast_t *node, jit_function_t func, ptrs_
 	else if(base.constType == -1)
 	{
 		jit_value_t ret;
+		ptrs_report_fallback(func, node, "address of index");
 		ptrs_jit_reusableCall(func, ptrs_intrinsic_addressof_index, ret, ptrs_jit_getVarType(),
 			(jit_type_void_ptr, jit_type_long, jit_type_ulong, jit_type_long, jit_type_ulong),
 			(jit_const_int(func, void_ptr, (uintptr_t)node), base.val, base.meta, index.val, index.meta)
@@ -651,9 +945,14 @@ ptrs_jit_var_t ptrs_call_index(ptrs_ast_t *node, jit_function_t func, ptrs_scope
 	{
 		return ptrs_jit_struct_call(node, func, scope, base, index.val, index.meta, typing, arguments);
 	}
+	else if(base.constType == PTRS_TYPE_MAP)
+	{
+		callee = ptrs_jit_map_get(node, func, base, index);
+	}
 	else if(base.constType == -1 || base.constType == PTRS_TYPE_POINTER)
 	{
 		jit_value_t ret;
+		ptrs_report_fallback(func, node, "index");
 		ptrs_jit_reusableCall(func, ptrs_intrinsic_index, ret, ptrs_jit_getVarType(),
 			(jit_type_void_ptr, jit_type_long, jit_type_ulong, jit_type_long, jit_type_ulong),
 			(jit_const_int(func, void_ptr, (uintptr_t)node), base.val, base.meta, index.val, index.meta)
@@ -843,6 +1142,14 @@ ptrs_jit_var_t ptrs_call_importedsymbol(ptrs_ast_t *node, jit_function_t func, p
 		else
 			val = ast->vtable->get(ast, func, scope);
 	}
+	else if(ptrs_jit_inlineNativeCall(node, func, scope, node, typing, arguments, &val))
+	{
+		return val;
+	}
+	else if(expr->ffi != NULL)
+	{
+		return ptrs_jit_callFfi(node, func, scope, stmt->symbols[expr->index], expr->ffi, arguments);
+	}
 	else if(expr->type == NULL)
 	{
 		val.val = jit_const_long(func, long, (uintptr_t)stmt->symbols[expr->index]);
@@ -908,6 +1215,10 @@ ptrs_jit_var_t ptrs_handle_identifier(ptrs_ast_t *node, jit_function_t func, ptr
 
 	if(expr->typePredicted)
 		ret.constType = expr->metaPrediction.type;
+	// typed variables reject values of other types, unless --unsafe disabled that check
+	// a constant meta is never overwritten by assignments, so it stays valid either way
+	else if(!target.addressable && (ptrs_enableSafety || jit_value_is_constant(target.meta)))
+		ret.constType = target.constType;
 	else
 		ret.constType = -1;
 
@@ -960,10 +1271,7 @@ void ptrs_assign_identifier(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t
 	}
 	else
 	{
-		target.val = jit_insn_import(func, target.val);
-		if(target.val == NULL)
-			ptrs_error(node, "Cannot access that variable from here");
-
+		target.val = ptrs_jit_import(node, func, target.val, true);
 		jit_insn_store_relative(func, target.val, 0, val.val);
 	}
 
@@ -1016,7 +1324,7 @@ void ptrs_assign_identifier(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t
 	}
 	else
 	{
-		target.meta = jit_insn_import(func, target.meta);
+		target.meta = ptrs_jit_import(node, func, target.meta, true);
 		jit_insn_store_relative(func, target.meta, 0, val.meta);
 	}
 }
@@ -1036,12 +1344,14 @@ ptrs_jit_var_t ptrs_addressof_identifier(ptrs_ast_t *node, jit_function_t func,
 ptrs_jit_var_t ptrs_handle_functionidentifier(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope)
 {
 	jit_function_t target = node->arg.funcval->symbol;
+	if(jit_function_get_nested_parent(target) == func)
+		ptrs_jit_markFrameReferenced(func);
 
 	ptrs_jit_var_t ret;
 	ret.val = jit_const_long(func, long, (uintptr_t)ptrs_jit_function_to_closure(node, target));
 	ret.meta = ptrs_jit_pointerMeta(func,
 		jit_const_long(func, ulong, PTRS_TYPE_FUNCTION),
-		jit_insn_get_parent_frame_pointer_of(func, target)
+		ptrs_jit_getParentFrame(func, target)
 	);
 	ret.constType = PTRS_TYPE_FUNCTION;
 
@@ -1103,18 +1413,44 @@ ptrs_jit_var_t ptrs_handle_op_in(ptrs_ast_t *node, jit_function_t func, ptrs_sco
 	ptrs_jit_var_t left = expr->left->vtable->get(expr->left, func, scope);
 	ptrs_jit_var_t right = expr->right->vtable->get(expr->right, func, scope);
 
-	if(right.constType != PTRS_TYPE_STRUCT)
-	{
-		ptrs_jit_typeCheck(node, func, scope, right, PTRS_TYPE_STRUCT,
-			"Cannot check if a value of type %t has a field, it is not a struct");
-	}
-
 	ptrs_jit_var_t ret = {
 		.val = NULL,
 		.meta = ptrs_jit_const_meta(func, PTRS_TYPE_INT),
 		.constType = PTRS_TYPE_INT
 	};
 
+	int8_t rightType = right.constType;
+	if(rightType == -1 && jit_value_is_constant(right.meta))
+		rightType = ptrs_jit_value_getMetaConstant(right.meta).type;
+
+	if(rightType == PTRS_TYPE_MAP)
+	{
+		return ptrs_jit_map_has(node, func, right, left);
+	}
+	else if(rightType != PTRS_TYPE_STRUCT && rightType != -1)
+	{
+		ptrs_error(node, "Cannot check if a value of type %t has a field, it is not a struct or map", rightType);
+	}
+
+	// without a known type maps are dispatched at runtime, everything else takes the struct path
+	jit_label_t done = jit_label_undefined;
+	if(rightType == -1)
+	{
+		ret.val = jit_value_create(func, jit_type_long);
+
+		jit_label_t notMap = jit_label_undefined;
+		jit_value_t isMap = jit_insn_eq(func, ptrs_jit_getType(func, right.meta),
+			jit_const_long(func, ulong, PTRS_TYPE_MAP));
+		jit_insn_branch_if_not(func, isMap, &notMap);
+
+		jit_insn_store(func, ret.val, ptrs_jit_map_has(node, func, right, left).val);
+		jit_insn_branch(func, &done);
+
+		jit_insn_label(func, &notMap);
+		ptrs_jit_typeCheck(node, func, scope, right, PTRS_TYPE_STRUCT,
+			"Cannot check if a value of type %t has a field, it is not a struct or map");
+	}
+
 	if(jit_value_is_constant(left.val) && jit_value_is_constant(left.meta) && jit_value_is_constant(right.meta))
 	{
 		ptrs_val_t nameVal = ptrs_jit_value_getValConstant(left.val);
@@ -1131,7 +1467,7 @@ ptrs_jit_var_t ptrs_handle_op_in(ptrs_ast_t *node, jit_function_t func, ptrs_sco
 			ret.val = jit_const_long(func, long, true);
 			return ret;
 		}
-		else if(ptrs_struct_getOverload(struc, ptrs_handle_op_in, true) == NULL)
+		else if(ptrs_struct_getOverload(struc, PTRS_STRUCTOP_IN, true) == NULL)
 		{
 			ret.val = jit_const_long(func, long, false);
 			return ret;
@@ -1142,11 +1478,21 @@ ptrs_jit_var_t ptrs_handle_op_in(ptrs_ast_t *node, jit_function_t func, ptrs_sco
 	jit_value_t struc = ptrs_jit_getMetaPointer(func, right.meta);
 	jit_value_t nodeVal = jit_const_int(func, void_ptr, (uintptr_t)node);
 
-	ptrs_jit_reusableCall(func, ptrs_struct_hasKey, ret.val, jit_type_sbyte,
+	jit_value_t hasKey;
+	ptrs_jit_reusableCall(func, ptrs_struct_hasKey, hasKey, jit_type_sbyte,
 		(jit_type_void_ptr, jit_type_void_ptr, jit_type_void_ptr, jit_type_ulong, jit_type_void_ptr),
 		(right.val, struc, name.val, name.meta, nodeVal)
 	);
 
-	ret.val = jit_insn_convert(func, ret.val, jit_type_long, 0);
+	hasKey = jit_insn_convert(func, hasKey, jit_type_long, 0);
+	if(rightType == -1)
+	{
+		jit_insn_store(func, ret.val, hasKey);
+		jit_insn_label(func, &done);
+	}
+	else
+	{
+		ret.val = hasKey;
+	}
 	return ret;
 }
@@ -15,6 +15,9 @@
 #include "include/util.h"
 #include "include/call.h"
 #include "include/run.h"
+#include "include/slab.h"
+#include "include/structarray.h"
+#include "include/map.h"
 #include "jit/jit-value.h"
 
 ptrs_jit_var_t ptrs_handle_initroot(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope)
@@ -32,6 +35,7 @@ ptrs_jit_var_t ptrs_handle_initroot(ptrs_ast_t *node, jit_function_t func, ptrs_
 	stmt->argumentsLocation.addressable = false;
 
 	// initialize the root scope
+	ptrs_jit_markFrameReferenced(func);
 	jit_insn_store_relative(func,
 		jit_const_int(func, void_ptr, (uintptr_t)scope->rootFrame), 0,
 		jit_insn_get_frame_pointer(func)
@@ -135,7 +139,7 @@ ptrs_jit_var_t ptrs_handle_array(ptrs_ast_t *node, jit_function_t func, ptrs_sco
 
 	//allocate memory
 	ptrs_jit_var_t val = {0};
-	val.val = ptrs_jit_allocate(func, byteSize, stmt->onStack, true);
+	val.val = ptrs_jit_allocate(func, byteSize, stmt->onStack || stmt->noEscape, true);
 	val.meta = ptrs_jit_arrayMetaKnownType(func, size, stmt->meta.array.typeIndex);
 	val.constType = PTRS_TYPE_POINTER;
 
@@ -260,6 +264,9 @@ static void importNative(ptrs_ast_t *node, void **values, const char *from)
 		if(error != NULL)
 			ptrs_error(node, error);
 
+		if(curr->ffi != NULL)
+			ptrs_jit_createFfiSignature(curr->ffi);
+
 		curr = curr->next;
 	}
 }
@@ -300,6 +307,19 @@ ptrs_jit_var_t ptrs_handle_return(ptrs_ast_t *node, jit_function_t func, ptrs_sc
 {
 	ptrs_ast_t *value = node->arg.astval;
 
+	// return f(...); is a tail call unless something could still refer to our frame afterwards
+	if(value != NULL && value->vtable == &ptrs_ast_vtable_call
+		&& value->arg.call.value->vtable == &ptrs_ast_vtable_functionidentifier
+		&& scope->returnAddr == NULL && scope->tryCatches == NULL && !scope->loopControlAllowed)
+	{
+		ptrs_ast_t *callee = value->arg.call.value;
+		if(ptrs_jit_tailCallNested(callee, func, scope, callee->arg.funcval->symbol, value->arg.call.arguments))
+		{
+			ptrs_jit_var_t ret = {NULL, NULL, -1};
+			return ret;
+		}
+	}
+
 	ptrs_jit_var_t ret;
 	if(value == NULL)
 	{
@@ -402,39 +422,122 @@ ptrs_jit_var_t ptrs_handle_continue_label(ptrs_ast_t *node, jit_function_t func,
 	return ret;
 }
 
+static void destructStruct(ptrs_ast_t *node, ptrs_val_t val, ptrs_meta_t meta)
+{
+	ptrs_struct_t *struc = ptrs_meta_getPointer(meta);
+	if(val.structval == NULL)
+		ptrs_error(node, "Cannot delete constructor of struct %s", struc->name);
+
+	jit_function_t dtor = ptrs_struct_getOverload(struc, PTRS_STRUCTOP_DELETE, true);
+	if(dtor != NULL)
+	{
+		ptrs_var_t result;
+		ptrs_jit_applyNested(dtor, &result, struc->parentFrame, val.structval, ());
+	}
+}
 void ptrs_delete(ptrs_ast_t *node, ptrs_val_t val, ptrs_meta_t meta)
 {
 	if(meta.type == PTRS_TYPE_STRUCT)
 	{
-		ptrs_struct_t *struc = ptrs_meta_getPointer(meta);
-		if(val.structval == NULL)
-			ptrs_error(node, "Cannot delete constructor of struct %s", struc->name);
-
-		jit_function_t dtor = ptrs_struct_getOverload(struc, ptrs_handle_delete, true);
-		if(dtor != NULL)
-		{
-			ptrs_var_t result;
-			ptrs_jit_applyNested(dtor, &result, struc->parentFrame, val.structval, ());
-		}
+		destructStruct(node, val, meta);
 	}
-	else if(meta.type != PTRS_TYPE_POINTER)
+	else if(meta.type != PTRS_TYPE_POINTER && meta.type != PTRS_TYPE_MAP)
 	{
 		ptrs_error(node, "Cannot delete value of type %m", meta);
 	}
 
-	free(val.ptrval);
+	if(node->arg.deletestmt.noFree)
+		return;
+	else if(meta.type == PTRS_TYPE_STRUCT)
+		ptrs_slab_free(ptrs_meta_getPointer(meta), val.ptrval);
+	else if(meta.type == PTRS_TYPE_MAP)
+		ptrs_map_free(val.ptrval);
+	else
+		free(val.ptrval);
+}
+// delete map[key] removes the key, delete structArray[i] only destructs the instance as its
+// memory belongs to the array, any other indexed value is deleted itself
+void ptrs_deleteIndex(ptrs_ast_t *node, ptrs_val_t base, ptrs_meta_t baseMeta,
+	ptrs_val_t index, ptrs_meta_t indexMeta)
+{
+	if(baseMeta.type == PTRS_TYPE_MAP)
+	{
+		ptrs_map_delete(node, base.ptrval, index, indexMeta);
+	}
+	else if(ptrs_structarray_isArray(baseMeta))
+	{
+		ptrs_var_t val = ptrs_intrinsic_index(node, base, baseMeta, index, indexMeta);
+		destructStruct(node, val.value, val.meta);
+	}
+	else
+	{
+		ptrs_var_t val = ptrs_intrinsic_index(node, base, baseMeta, index, indexMeta);
+		ptrs_delete(node, val.value, val.meta);
+	}
 }
 ptrs_jit_var_t ptrs_handle_delete(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope)
 {
-	ptrs_ast_t *ast = node->arg.astval;
-	ptrs_jit_var_t val = ast->vtable->get(ast, func, scope);
+	struct ptrs_ast_delete *stmt = &node->arg.deletestmt;
+	ptrs_jit_var_t ret = {NULL, NULL, -1};
+	ptrs_jit_var_t val;
+	bool isArrayElement = false;
 
-	if(val.constType == PTRS_TYPE_POINTER)
+	if(stmt->value->vtable == &ptrs_ast_vtable_index)
 	{
-		ptrs_jit_reusableCallVoid(func, free,
-			(jit_type_void_ptr),
-			(val.val)
-		);
+		struct ptrs_ast_binary *expr = &stmt->value->arg.binary;
+		ptrs_jit_var_t base = expr->left->vtable->get(expr->left, func, scope);
+
+		jit_value_t oldArraySize = scope->indexSize;
+		scope->indexSize = ptrs_jit_getArraySize(func, base.meta);
+		ptrs_jit_var_t index = expr->right->vtable->get(expr->right, func, scope);
+		scope->indexSize = oldArraySize;
+
+		if(base.constType == PTRS_TYPE_MAP)
+		{
+			ptrs_jit_map_delete(stmt->value, func, base, index);
+			return ret;
+		}
+		else if(base.constType == -1
+			|| (base.constType == PTRS_TYPE_POINTER && !jit_value_is_constant(base.meta)))
+		{
+			jit_value_t astval = jit_const_int(func, void_ptr, (uintptr_t)node);
+			ptrs_jit_reusableCallVoid(func, ptrs_deleteIndex,
+				(jit_type_void_ptr, jit_type_long, jit_type_ulong, jit_type_long, jit_type_ulong),
+				(astval, base.val, base.meta, index.val, index.meta)
+			);
+			return ret;
+		}
+		else if(base.constType == PTRS_TYPE_POINTER)
+		{
+			isArrayElement = ptrs_structarray_isArray(ptrs_jit_value_getMetaConstant(base.meta));
+		}
+
+		val = ptrs_jit_index(stmt->value, func, scope, base, index);
+	}
+	else
+	{
+		val = stmt->value->vtable->get(stmt->value, func, scope);
+	}
+
+	if(val.constType == PTRS_TYPE_MAP)
+	{
+		if(!stmt->noFree)
+		{
+			ptrs_jit_reusableCallVoid(func, ptrs_map_free,
+				(jit_type_void_ptr),
+				(val.val)
+			);
+		}
+	}
+	else if(val.constType == PTRS_TYPE_POINTER)
+	{
+		if(!stmt->noFree)
+		{
+			ptrs_jit_reusableCallVoid(func, free,
+				(jit_type_void_ptr),
+				(val.val)
+			);
+		}
 	}
 	else if(val.constType == PTRS_TYPE_STRUCT && jit_value_is_constant(val.meta))
 	{
@@ -445,14 +548,12 @@ ptrs_jit_var_t ptrs_handle_delete(ptrs_ast_t *node, jit_function_t func, ptrs_sc
 			1, "Cannot delete constructor of struct %s", jit_const_int(func, void_ptr, (uintptr_t)struc->name)
 		);
 
-		jit_function_t dtor = ptrs_struct_getOverload(struc, ptrs_handle_delete, true);
+		jit_function_t dtor = ptrs_struct_getOverload(struc, PTRS_STRUCTOP_DELETE, true);
 		if(dtor != NULL)
 			ptrs_jit_callnested(node, func, scope, val.val, dtor, NULL);
 
-		ptrs_jit_reusableCallVoid(func, free,
-			(jit_type_void_ptr),
-			(val.val)
-		);
+		if(!stmt->noFree && !isArrayElement)
+			ptrs_jit_slabFree(func, struc, val.val);
 	}
 	else if(val.constType == PTRS_TYPE_STRUCT || val.constType == -1)
 	{
@@ -466,6 +567,8 @@ ptrs_jit_var_t ptrs_handle_delete(ptrs_ast_t *node, jit_function_t func, ptrs_sc
 	{
 		ptrs_error(node, "Cannot free value of type %t", val.constType);
 	}
+
+	return ret;
 }
 
 ptrs_jit_var_t ptrs_handle_throw(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope)
@@ -599,6 +702,7 @@ ptrs_jit_var_t ptrs_handle_function(ptrs_ast_t *node, jit_function_t func, ptrs_
 	ptrs_jit_var_t ret;
 	if(ast->isExpression)
 	{
+		ptrs_jit_markFrameReferenced(func);
 		ret.val = jit_const_long(func, long, (uintptr_t)ptrs_jit_function_to_closure(node, ast->symbol));
 		ret.meta = ptrs_jit_pointerMeta(func,
 			jit_const_long(func, ulong, PTRS_TYPE_FUNCTION),
@@ -616,6 +720,33 @@ ptrs_jit_var_t ptrs_handle_function(ptrs_ast_t *node, jit_function_t func, ptrs_
 	return ret;
 }
 
+static jit_function_t createDataInitializer(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope,
+	ptrs_struct_t *struc, ptrs_scope_t *ctorScope)
+{
+	char *ctorName = malloc(strlen(struc->name) + strlen(".(data initializer)") + 1);
+	sprintf(ctorName, "%s.(data initializer)", struc->name);
+
+	ptrs_jit_reusableSignature(func, ctorSignature, ptrs_jit_getVarType(), (jit_type_void_ptr));
+	jit_function_t ctor = ptrs_jit_createFunction(node, func, ctorSignature, ctorName);
+
+	ptrs_function_t *funcAst = calloc(1, sizeof(ptrs_function_t));
+	funcAst->name = ctorName;
+	funcAst->retType.meta.type = PTRS_TYPE_UNDEFINED;
+	jit_function_set_meta(ctor, PTRS_JIT_FUNCTIONMETA_FUNCAST, funcAst, NULL, 0);
+	jit_function_set_meta(ctor, PTRS_JIT_FUNCTIONMETA_CLOSURE, ctor, NULL, 0);
+
+	ptrs_initScope(ctorScope, scope);
+	ctorScope->returnType.type = -1;
+	return ctor;
+}
+
+// instance members initialized with a constant are copied from struc->initTemplate
+static bool isTemplateMember(struct ptrs_structmember *member)
+{
+	return member->name != NULL && !member->isStatic && member->type == PTRS_STRUCTMEMBER_VAR
+		&& member->value.startval != NULL && member->value.startval->vtable == &ptrs_ast_vtable_constant;
+}
+
 ptrs_jit_var_t ptrs_handle_struct(ptrs_ast_t *node, jit_function_t func, ptrs_scope_t *scope)
 {
 	ptrs_struct_t *struc = &node->arg.structval;
@@ -624,6 +755,7 @@ ptrs_jit_var_t ptrs_handle_struct(ptrs_ast_t *node, jit_function_t func, ptrs_sc
 	if(struc->staticData != NULL)
 		staticData = jit_const_int(func, void_ptr, (uintptr_t)struc->staticData);
 
+	ptrs_jit_markFrameReferenced(func);
 	jit_insn_store_relative(func, jit_const_int(func, void_ptr, (uintptr_t)struc),
 		offsetof(ptrs_struct_t, parentFrame), jit_insn_get_frame_pointer(func));
 
@@ -647,7 +779,7 @@ ptrs_jit_var_t ptrs_handle_struct(ptrs_ast_t *node, jit_function_t func, ptrs_sc
 	{
 		curr->handlerFunc = ptrs_jit_createFunctionFromAst(node, func, curr->handler);
 
-		if(curr->op == (void *)ptrs_handle_new)
+		if(curr->op == PTRS_STRUCTOP_NEW)
 		{
 			ctor = curr->handlerFunc;
 			ctorData = jit_value_get_param(ctor, 0);
@@ -658,6 +790,45 @@ ptrs_jit_var_t ptrs_handle_struct(ptrs_ast_t *node, jit_function_t func, ptrs_sc
 		}
 	}
 
+	// copy all constant initializers using a single memcpy, the range also
+	// covers members in between which are either initialized afterwards or zeroed
+	uint32_t templateStart = UINT32_MAX;
+	uint32_t templateEnd = 0;
+	for(int i = 0; i < struc->memberCount; i++)
+	{
+		struct ptrs_structmember *curr = &struc->member[i];
+		if(!isTemplateMember(curr))
+			continue;
+
+		if(curr->offset < templateStart)
+			templateStart = curr->offset;
+		if(curr->offset + sizeof(ptrs_var_t) > templateEnd)
+			templateEnd = curr->offset + sizeof(ptrs_var_t);
+	}
+
+	if(templateEnd > templateStart)
+	{
+		free(struc->initTemplate);
+		struc->initTemplate = calloc(templateEnd - templateStart, 1);
+		for(int i = 0; i < struc->memberCount; i++)
+		{
+			struct ptrs_structmember *curr = &struc->member[i];
+			if(isTemplateMember(curr))
+				memcpy(struc->initTemplate + curr->offset - templateStart,
+					&curr->value.startval->arg.constval, sizeof(ptrs_var_t));
+		}
+
+		if(ctor == NULL)
+		{
+			ctor = createDataInitializer(node, func, scope, struc, &ctorScope);
+			ctorData = jit_value_get_param(ctor, 0);
+		}
+
+		jit_insn_memcpy(ctor, jit_insn_add_relative(ctor, ctorData, templateStart),
+			jit_const_int(ctor, void_ptr, (uintptr_t)struc->initTemplate),
+			jit_const_int(ctor, nuint, templateEnd - templateStart));
+	}
+
 	for(int i = 0; i < struc->memberCount; i++)
 	{
 		struct ptrs_structmember *curr = &struc->member[i];
@@ -665,6 +836,8 @@ ptrs_jit_var_t ptrs_handle_struct(ptrs_ast_t *node, jit_function_t func, ptrs_sc
 			continue;
 		else if(curr->type == PTRS_STRUCTMEMBER_VAR && curr->value.startval == NULL)
 			continue;
+		else if(isTemplateMember(curr))
+			continue;
 		else if(curr->type == PTRS_STRUCTMEMBER_ARRAY)
 			continue; // TODO allow initializers of arrays
 
@@ -682,21 +855,8 @@ ptrs_jit_var_t ptrs_handle_struct(ptrs_ast_t *node, jit_function_t func, ptrs_sc
 		{
 			if(ctor == NULL)
 			{
-				char *ctorName = malloc(strlen(struc->name) + strlen(".(data initializer)") + 1);
-				sprintf(ctorName, "%s.(data initializer)", struc->name);
-
-				ptrs_jit_reusableSignature(func, ctorSignature, ptrs_jit_getVarType(), (jit_type_void_ptr));
-				ctor = ptrs_jit_createFunction(node, func, ctorSignature, ctorName);
-
-				ptrs_function_t *func = calloc(1, sizeof(ptrs_function_t));
-				func->name = ctorName;
-				func->retType.meta.type = PTRS_TYPE_UNDEFINED;
-				jit_function_set_meta(ctor, PTRS_JIT_FUNCTIONMETA_FUNCAST, func, NULL, 0);
-				jit_function_set_meta(ctor, PTRS_JIT_FUNCTIONMETA_CLOSURE, ctor, NULL, 0);
-
+				ctor = createDataInitializer(node, func, scope, struc, &ctorScope);
 				ctorData = jit_value_get_param(ctor, 0);
-				ptrs_initScope(&ctorScope, scope);
-				ctorScope.returnType.type = -1;
 			}
 
 			currFunc = ctor;
@@ -738,15 +898,24 @@ ptrs_jit_var_t ptrs_handle_struct(ptrs_ast_t *node, jit_function_t func, ptrs_sc
 			ptrs_error(node, "Failed compiling the constructor of function %s", struc->name);
 
 		struct ptrs_opoverload *ctorOverload = malloc(sizeof(struct ptrs_opoverload));
-		ctorOverload->op = ptrs_handle_new;
+		ctorOverload->op = PTRS_STRUCTOP_NEW;
 		ctorOverload->isStatic = true;
 		ctorOverload->handler = NULL;
 		ctorOverload->handlerFunc = ctor;
+		ctorOverload->handlerClosure = jit_function_to_closure(ctor);
 
 		ctorOverload->next = struc->overloads;
 		struc->overloads = ctorOverload;
 	}
 
+	for(struct ptrs_opoverload *curr = struc->overloads; curr != NULL; curr = curr->next)
+	{
+		if(curr->handler != NULL)
+			curr->handlerClosure = ptrs_jit_function_to_closure(node, curr->handlerFunc);
+	}
+	ptrs_struct_fillOverloadTable(struc);
+	ptrs_struct_fillForeachPlan(struc);
+
 	//build all functions
 	for(int i = 0; i < struc->memberCount; i++)
 	{
@@ -983,6 +1152,11 @@ struct struct_iterator_save
 	ptrs_struct_t *struc;
 	size_t pos;
 };
+struct map_iterator_save
+{
+	ptrs_map_t *map;
+	size_t pos;
+};
 static bool pointerIterator(void *parentFrame, uint8_t *array, ptrs_var_t *varlist, ptrs_meta_t varlistMeta,
 	struct array_iterator_save *saveArea, ptrs_meta_t saveAreaMeta)
 {
@@ -994,7 +1168,19 @@ static bool pointerIterator(void *parentFrame, uint8_t *array, ptrs_var_t *varli
 		varlist[0].value.intval = saveArea->pos;
 		varlist[0].meta.type = PTRS_TYPE_INT;
 	}
-	if(varlistMeta.array.size > 1)
+	if(varlistMeta.array.size > 1 && ptrs_structarray_isArray(saveArea->meta))
+	{
+		if(ptrs_structarray_isSoa(saveArea->meta))
+		{
+			varlist[1].value.intval = 0;
+			varlist[1].meta.type = PTRS_TYPE_UNDEFINED;
+		}
+		else
+		{
+			varlist[1] = ptrs_structarray_index(NULL, array, saveArea->meta, saveArea->pos);
+		}
+	}
+	else if(varlistMeta.array.size > 1)
 	{
 		ptrs_nativetype_info_t *type = &ptrs_nativeTypes[saveArea->meta.array.typeIndex];
 		type->getHandler(array + type->size * saveArea->pos, type->size, varlist + 1);
@@ -1014,19 +1200,11 @@ static bool structIterator(void *parentFrame, void *data, ptrs_var_t *varlist, p
 {
 	ptrs_struct_t *struc = saveArea->struc;
 	bool isInstance = data != NULL;
-	struct ptrs_structmember *curr;
-	while(true)
-	{
-		if(saveArea->pos >= struc->memberCount)
-			return false;
-
-		curr = &struc->member[saveArea->pos];
-		saveArea->pos++;
+	if(saveArea->pos >= struc->foreachPlanSize[isInstance])
+		return false;
 
-		if(curr->name != NULL && curr->type != PTRS_STRUCTMEMBER_SETTER
-			&& (curr->isStatic || isInstance))
-			break;
-	}
+	struct ptrs_structmember *curr = struc->foreachPlan[isInstance][saveArea->pos];
+	saveArea->pos++;
 
 	if(varlistMeta.array.size > 0)
 	{
@@ -1048,6 +1226,27 @@ static bool structIterator(void *parentFrame, void *data, ptrs_var_t *varlist, p
 
 	return true;
 }
+static bool mapIterator(void *parentFrame, void *data, ptrs_var_t *varlist, ptrs_meta_t varlistMeta,
+	struct map_iterator_save *saveArea, ptrs_meta_t saveAreaMeta)
+{
+	ptrs_var_t key;
+	ptrs_var_t value;
+	if(!ptrs_map_next(saveArea->map, &saveArea->pos, &key, &value))
+		return false;
+
+	if(varlistMeta.array.size > 0)
+		varlist[0] = key;
+	if(varlistMeta.array.size > 1)
+		varlist[1] = value;
+
+	for(int i = 2; i < varlistMeta.array.size; i++)
+	{
+		varlist[i].value.intval = 0;
+		varlist[i].meta.type = PTRS_TYPE_UNDEFINED;
+	}
+
+	return true;
+}
 static void *getForeachIterator(ptrs_ast_t *node, void **parentFrame, void *saveArea,
 	ptrs_val_t val, ptrs_meta_t meta)
 {
@@ -1063,7 +1262,7 @@ static void *getForeachIterator(ptrs_ast_t *node, void **parentFrame, void *save
 		ptrs_struct_t *struc = ptrs_meta_getPointer(meta);
 		*parentFrame = struc->parentFrame;
 
-		void *handler = ptrs_struct_getOverloadClosure(struc, ptrs_handle_forin_step, val.ptrval != NULL);
+		void *handler = ptrs_struct_getOverloadClosure(struc, PTRS_STRUCTOP_FOREACH, val.ptrval != NULL);
 		if(handler != NULL)
 		{
 			ptrs_var_t *varSave = saveArea;
@@ -1079,6 +1278,13 @@ static void *getForeachIterator(ptrs_ast_t *node, void **parentFrame, void *save
 			return structIterator;
 		}
 	}
+	else if(meta.type == PTRS_TYPE_MAP)
+	{
+		struct map_iterator_save *mapSave = saveArea;
+		mapSave->map = val.ptrval;
+		mapSave->pos = 0;
+		return mapIterator;
+	}
 	else
 	{
 		ptrs_error(node, "Cannot iterate over value of type %t", meta.type);
@@ -1098,14 +1304,41 @@ ptrs_jit_var_t ptrs_handle_forin_setup(ptrs_ast_t *node, jit_function_t func, pt
 
 		// calling ptrs_getNativeTypeForArray makes sure the type and the typeIndex are correct
 		ptrs_meta_t meta = ptrs_jit_value_getMetaConstant(stmt->value.meta);
-		ptrs_getNativeTypeForArray(node, meta);
+		if(!ptrs_structarray_isArray(meta))
+			ptrs_getNativeTypeForArray(node, meta);
+		else if(ptrs_structarray_isSoa(meta) && stmt->varcount > 1)
+			ptrs_error(node, "Iterating over an array of structs with soa layout only yields the indices");
 
 		return stmt->value;
 	}
 
-	if(stmt->value.constType != -1 && stmt->value.constType != PTRS_TYPE_STRUCT)
+	if(stmt->value.constType != -1 && stmt->value.constType != PTRS_TYPE_STRUCT
+		&& stmt->value.constType != PTRS_TYPE_MAP)
 		ptrs_error(node, "Cannot iterate over value of type %t", stmt->value.constType);
 
+	if(jit_value_is_constant(stmt->value.meta))
+	{
+		ptrs_meta_t meta = ptrs_jit_value_getMetaConstant(stmt->value.meta);
+		ptrs_struct_t *struc = ptrs_meta_getPointer(meta);
+		bool isInstance = !jit_value_is_constant(stmt->value.val) || jit_value_is_true(stmt->value.val);
+
+		if(meta.type != PTRS_TYPE_STRUCT && meta.type != PTRS_TYPE_MAP)
+			ptrs_error(node, "Cannot iterate over value of type %t", meta.type);
+
+		if(meta.type == PTRS_TYPE_STRUCT
+			&& ptrs_struct_getOverloadInfo(struc, PTRS_STRUCTOP_FOREACH, isInstance) == NULL)
+		{
+			// set up variables for `iterateStructMembers`
+			stmt->value.constType = PTRS_TYPE_STRUCT;
+			stmt->saveArea = stmt->value.meta;
+			stmt->varlist = NULL;
+			stmt->iterator = jit_value_create(func, jit_type_nuint);
+			jit_insn_store(func, stmt->iterator, jit_const_int(func, nuint, 0));
+			return stmt->value;
+		}
+	}
+
+	ptrs_jit_markFrameReferenced(func);
 	stmt->saveArea = jit_insn_array(func, sizeof(ptrs_var_t));
 	stmt->varlist = jit_insn_array(func, stmt->varcount * sizeof(ptrs_var_t));
 	stmt->parentFrame = jit_value_create(func, jit_type_void_ptr);
@@ -1136,6 +1369,16 @@ void iterateArray(struct ptrs_ast_forin *stmt, jit_function_t func, ptrs_scope_t
 	stmt->varsymbols[0].constType = PTRS_TYPE_INT;
 	stmt->varsymbols[0].addressable = false;
 
+	if(ptrs_structarray_isArray(meta))
+	{
+		// instances are not copied, the variable refers to the element inside the array
+		if(!ptrs_structarray_isSoa(meta))
+			stmt->varsymbols[1] = ptrs_jit_structarray_index(NULL, func, meta, stmt->value.val, stmt->iterator);
+
+		jit_insn_store(func, stmt->iterator, jit_insn_add(func, stmt->iterator, jit_const_long(func, ulong, 1)));
+		return;
+	}
+
 	ptrs_nativetype_info_t *type = &ptrs_nativeTypes[meta.array.typeIndex];
 	jit_value_t loadedValue = jit_insn_load_elem(func, stmt->value.val, stmt->iterator, type->jitType);
 
@@ -1158,6 +1401,79 @@ void iterateArray(struct ptrs_ast_forin *stmt, jit_function_t func, ptrs_scope_t
 
 	jit_insn_store(func, stmt->iterator, jit_insn_add(func, stmt->iterator, jit_const_long(func, ulong, 1)));
 }
+void iterateStructMembers(ptrs_ast_t *node, struct ptrs_ast_forin *stmt, jit_function_t func, ptrs_scope_t *scope)
+{
+	// the struct is known at compile time, every member gets its own entry in a jump table
+	// stmt->iterator holds the index of the next member
+	// stmt->saveArea holds the constant meta
+
+	ptrs_meta_t meta = ptrs_jit_value_getMetaConstant(stmt->saveArea);
+	ptrs_struct_t *struc = ptrs_meta_getPointer(meta);
+	bool isInstance = !jit_value_is_constant(stmt->value.val) || jit_value_is_true(stmt->value.val);
+
+	uint16_t count;
+	struct ptrs_structmember **plan = ptrs_struct_getForeachPlan(struc, isInstance, &count);
+
+	jit_value_t key = jit_value_create(func, jit_type_long);
+	jit_value_t keyMeta = jit_value_create(func, jit_type_ulong);
+	jit_value_t val = jit_value_create(func, jit_type_long);
+	jit_value_t valMeta = jit_value_create(func, jit_type_ulong);
+
+	jit_label_t table[count > 0 ? count : 1];
+	for(int i = 0; i < count; i++)
+		table[i] = jit_label_undefined;
+
+	// indices past the last member fall through to the end of the loop
+	jit_label_t done = jit_label_undefined;
+	if(count > 0)
+		jit_insn_jump_table(func, stmt->iterator, table, count);
+	jit_insn_branch(func, &scope->breakLabel);
+
+	for(int i = 0; i < count; i++)
+	{
+		struct ptrs_structmember *member = plan[i];
+		jit_insn_label(func, table + i);
+
+		jit_insn_store(func, key, jit_const_long(func, long, (uintptr_t)member->name));
+		jit_insn_store(func, keyMeta, ptrs_jit_const_arrayMeta(func, member->namelen + 1, PTRS_NATIVETYPE_INDEX_CHAR));
+
+		if(stmt->varcount > 1)
+		{
+			ptrs_jit_var_t result = ptrs_jit_struct_getMember(node, func, scope, stmt->value, struc, member);
+			jit_insn_store(func, val, ptrs_jit_reinterpretCast(func, result.val, jit_type_long));
+			jit_insn_store(func, valMeta, result.meta);
+		}
+
+		jit_insn_branch(func, &done);
+	}
+
+	jit_insn_label(func, &done);
+
+	for(int i = 0; i < stmt->varcount; i++)
+	{
+		if(i == 0)
+		{
+			stmt->varsymbols[i].val = key;
+			stmt->varsymbols[i].meta = keyMeta;
+			stmt->varsymbols[i].constType = PTRS_TYPE_POINTER;
+		}
+		else if(i == 1)
+		{
+			stmt->varsymbols[i].val = val;
+			stmt->varsymbols[i].meta = valMeta;
+			stmt->varsymbols[i].constType = -1;
+		}
+		else
+		{
+			stmt->varsymbols[i].val = jit_const_long(func, long, 0);
+			stmt->varsymbols[i].meta = ptrs_jit_const_meta(func, PTRS_TYPE_UNDEFINED);
+			stmt->varsymbols[i].constType = PTRS_TYPE_UNDEFINED;
+		}
+		stmt->varsymbols[i].addressable = false;
+	}
+
+	jit_insn_store(func, stmt->iterator, jit_insn_add(func, stmt->iterator, jit_const_int(func, nuint, 1)));
+}
 void iterateWithIteratorFunction(struct ptrs_ast_forin *stmt, jit_function_t func, ptrs_scope_t *scope)
 {
 	static jit_type_t iteratorSig = NULL;
@@ -1171,7 +1487,7 @@ void iterateWithIteratorFunction(struct ptrs_ast_forin *stmt, jit_function_t fun
 			jit_type_long, //saveArea.val
 			jit_type_ulong, //saveArea.meta
 		};
-		iteratorSig = jit_type_create_signature(jit_abi_cdecl, jit_type_ubyte, args, 6, 0);
+		iteratorSig = ptrs_jit_getSignature(jit_abi_cdecl, jit_type_ubyte, args, 6);
 	}
 
 	jit_value_t args[6] = {
@@ -1203,6 +1519,8 @@ ptrs_jit_var_t ptrs_handle_forin_step(ptrs_ast_t *node, jit_function_t func, ptr
 
 	if(stmt->value.constType == PTRS_TYPE_POINTER)
 		iterateArray(stmt, func, scope);
+	else if(stmt->varlist == NULL) // see ptrs_handle_forin_setup
+		iterateStructMembers(node, stmt, func, scope);
 	else
 		iterateWithIteratorFunction(stmt, func, scope);
 }
@@ -1235,6 +1553,7 @@ ptrs_jit_var_t ptrs_handle_scopestatement(ptrs_ast_t *node, jit_function_t func,
 		returnAddr = scope->returnAddr;
 	else
 		returnAddr = jit_insn_address_of(func, jit_value_create(func, ptrs_jit_getVarType()));
+	ptrs_jit_markFrameReferenced(func);
 	jit_value_t status = jit_insn_call(func, "(scoped body)", bodyFunc, bodySignature, &returnAddr, 1, 0);
 
 	jit_label_t ok = jit_label_undefined;
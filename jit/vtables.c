@@ -40,8 +40,11 @@ GETONLY(scopestatement)
 GETONLY(exprstatement)
 
 GETONLY(call)
+GETONLY(expand)
 GETONLY(stringformat)
 GETONLY(new)
+GETONLY(structarray)
+GETONLY(map)
 GETONLY(indexlength)
 GETONLY(slice)
 GETONLY(as)
@@ -27,8 +27,11 @@ extern ptrs_ast_vtable_t ptrs_ast_vtable_scopestatement;
 extern ptrs_ast_vtable_t ptrs_ast_vtable_exprstatement;
 
 extern ptrs_ast_vtable_t ptrs_ast_vtable_call;
+extern ptrs_ast_vtable_t ptrs_ast_vtable_expand;
 extern ptrs_ast_vtable_t ptrs_ast_vtable_stringformat;
 extern ptrs_ast_vtable_t ptrs_ast_vtable_new;
+extern ptrs_ast_vtable_t ptrs_ast_vtable_structarray;
+extern ptrs_ast_vtable_t ptrs_ast_vtable_map;
 extern ptrs_ast_vtable_t ptrs_ast_vtable_indexlength;
 extern ptrs_ast_vtable_t ptrs_ast_vtable_slice;
 extern ptrs_ast_vtable_t ptrs_ast_vtable_as;
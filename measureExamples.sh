@@ -26,6 +26,7 @@ function measureExample
 
 measureExample circle
 measureExample pi
+measureExample fibrec
 measureExample array
 measureExample struct
 measureExample bubblesort
@@ -34,6 +34,7 @@ struct symbollist
 		struct
 		{
 			ptrs_nativetype_info_t *type; //optional
+			struct ptrs_ffideclaration *ffi; //optional
 			ptrs_ast_t *import;
 			unsigned index;
 		} imported;
@@ -68,6 +69,7 @@ struct ptrs_symboltable
 struct code
 {
 	const char *filename;
+	uint32_t module; // the id of filename, see getModuleId
 	char *src;
 	char curr;
 	int pos;
@@ -83,12 +85,13 @@ static ptrs_ast_t *parseExpression(code_t *code, bool required);
 static ptrs_ast_t *parseBinaryExpr(code_t *code, ptrs_ast_t *left, int minPrec);
 static ptrs_ast_t *parseUnaryExpr(code_t *code, bool ignoreCalls);
 static ptrs_ast_t *parseUnaryExtension(code_t *code, ptrs_ast_t *ast, bool ignoreCalls);
-static struct ptrs_astlist *parseExpressionList(code_t *code, char end);
+static struct ptrs_astlist *parseExpressionList(code_t *code, char end, bool allowExpansion);
 static ptrs_ast_t *parseNew(code_t *code, bool onStack);
 static void parseTyping(code_t *code, ptrs_typing_t *typing);
 static void parseOptionalTyping(code_t *code, ptrs_typing_t *typing);
 static void parseArrayTyping(code_t *code, ptrs_nativetype_info_t *nativeType, ptrs_meta_t *result, struct ptrs_ast **sizePtr);
-static void parseMap(code_t *code, ptrs_ast_t *expr);
+static ptrs_ast_t *parseMap(code_t *code);
+static void parseMapStruct(code_t *code, ptrs_ast_t *expr);
 static void parseStruct(code_t *code, ptrs_struct_t *struc);
 static void parseImport(code_t *code, ptrs_ast_t *stmt);
 static void parseSwitchCase(code_t *code, ptrs_ast_t *stmt);
@@ -126,10 +129,30 @@ static void unexpectedm(code_t *code, const char *expected, const char *msg);
 #define unexpected(code, expected) \
 	unexpectedm(code, expected, NULL)
 
+// files get an integer id so checking whether a member is internal does not need to compare names
+static const char **moduleNames = NULL;
+static uint32_t moduleCount = 0;
+static uint32_t getModuleId(const char *filename)
+{
+	if(filename == NULL)
+		return 0;
+
+	for(uint32_t i = 0; i < moduleCount; i++)
+	{
+		if(strcmp(moduleNames[i], filename) == 0)
+			return i + 1;
+	}
+
+	moduleNames = realloc(moduleNames, (moduleCount + 1) * sizeof(const char *));
+	moduleNames[moduleCount] = filename;
+	return ++moduleCount;
+}
+
 ptrs_ast_t *ptrs_parse(char *src, const char *filename, ptrs_symboltable_t **symbols, bool addInitRoot)
 {
 	code_t code;
 	code.filename = filename;
+	code.module = getModuleId(filename);
 	code.src = src;
 	code.curr = src[0];
 	code.pos = 0;
@@ -168,6 +191,7 @@ ptrs_ast_t *ptrs_parse(char *src, const char *filename, ptrs_symboltable_t **sym
 		initRoot->code = code.src;
 		initRoot->codepos = 0;
 		initRoot->file = code.filename;
+		initRoot->module = code.module;
 		addSymbol(&code, strdup("arguments"), &initRoot->arg.initroot.argumentsLocation);
 	}
 
@@ -216,6 +240,7 @@ int ptrs_ast_getSymbol(ptrs_symboltable_t *symbols, char *text, ptrs_ast_t **nod
 						ast->arg.identifier.typePredicted = false;
 						ast->arg.identifier.valuePredicted = false;
 						ast->arg.identifier.metaPredicted = false;
+						ast->arg.identifier.arrayPredicted = false;
 
 						if(functionBoundary)
 							ast->arg.identifier.location->addressable = 1;
@@ -240,6 +265,7 @@ int ptrs_ast_getSymbol(ptrs_symboltable_t *symbols, char *text, ptrs_ast_t **nod
 						ast->arg.importedsymbol.import = curr->arg.imported.import;
 						ast->arg.importedsymbol.index = curr->arg.imported.index;
 						ast->arg.importedsymbol.type = curr->arg.imported.type;
+						ast->arg.importedsymbol.ffi = curr->arg.imported.ffi;
 						break;
 
 					case PTRS_SYMBOL_THISMEMBER:
@@ -270,6 +296,7 @@ static ptrs_ast_t *parseStmtList(code_t *code, char end)
 	elem->codepos = code->pos;
 	elem->code = code->src;
 	elem->file = code->filename;
+	elem->module = code->module;
 
 	if(code->curr == end || code->curr == 0)
 	{
@@ -568,6 +595,7 @@ static ptrs_ast_t *parseStatement(code_t *code)
 	stmt->codepos = code->pos;
 	stmt->code = code->src;
 	stmt->file = code->filename;
+	stmt->module = code->module;
 
 	if(lookahead(code, "var"))
 	{
@@ -583,7 +611,7 @@ static ptrs_ast_t *parseStatement(code_t *code)
 			if(lookahead(code, "="))
 			{
 				consumec(code, '[');
-				stmt->arg.definearray.initVal = parseExpressionList(code, ']');
+				stmt->arg.definearray.initVal = parseExpressionList(code, ']', false);
 				consumec(code, ']');
 			}
 
@@ -629,7 +657,7 @@ static ptrs_ast_t *parseStatement(code_t *code)
 	else if(lookahead(code, "delete"))
 	{
 		stmt->vtable = &ptrs_ast_vtable_delete;
-		stmt->arg.astval = parseExpression(code, true);
+		stmt->arg.deletestmt.value = parseExpression(code, true);
 		consumec(code, ';');
 	}
 	else if(lookahead(code, "throw"))
@@ -712,6 +740,7 @@ static ptrs_ast_t *parseStatement(code_t *code)
 		ptrs_struct_t *struc = &stmt->arg.structval;
 		parseStruct(code, struc);
 		struc->ast = stmt;
+		struc->firstCodepos = stmt->codepos;
 	}
 	else if(lookahead(code, "if"))
 	{
@@ -986,6 +1015,7 @@ static ptrs_ast_t *parseBinaryExpr(code_t *code, ptrs_ast_t *left, int minPrec)
 			left->codepos = pos;
 			left->code = code->src;
 			left->file = code->filename;
+			left->module = code->module;
 			continue;
 		}
 
@@ -996,6 +1026,7 @@ static ptrs_ast_t *parseBinaryExpr(code_t *code, ptrs_ast_t *left, int minPrec)
 		left->codepos = pos;
 		left->code = code->src;
 		left->file = code->filename;
+		left->module = code->module;
 
 		if(op->isAssignOp && _left->vtable->set == NULL)
 			PTRS_HANDLE_ASTERROR(left, "Invalid assign expression, left side is not a valid lvalue");
@@ -1010,6 +1041,7 @@ static ptrs_ast_t *parseBinaryExpr(code_t *code, ptrs_ast_t *left, int minPrec)
 			left->codepos = pos;
 			left->code = code->src;
 			left->file = code->filename;
+			left->module = code->module;
 		}
 	}
 	return left;
@@ -1065,6 +1097,7 @@ static ptrs_ast_t *parseUnaryExpr(code_t *code, bool ignoreCalls)
 		ast->codepos = pos;
 		ast->code = code->src;
 		ast->file = code->filename;
+		ast->module = code->module;
 
 		return ast;
 	}
@@ -1223,13 +1256,11 @@ static ptrs_ast_t *parseUnaryExpr(code_t *code, bool ignoreCalls)
 	{
 		ast = talloc(ptrs_ast_t);
 		ast->arg.newexpr.onStack = true;
-		parseMap(code, ast);
+		parseMapStruct(code, ast);
 	}
 	else if(lookahead(code, "map"))
 	{
-		ast = talloc(ptrs_ast_t);
-		ast->arg.newexpr.onStack = false;
-		parseMap(code, ast);
+		ast = parseMap(code);
 	}
 	else if(isalpha(curr) || curr == '_')
 	{
@@ -1401,6 +1432,7 @@ static ptrs_ast_t *parseUnaryExpr(code_t *code, bool ignoreCalls)
 	ast->codepos = pos;
 	ast->code = code->src;
 	ast->file = code->filename;
+	ast->module = code->module;
 
 	ptrs_ast_t *old;
 	do
@@ -1422,6 +1454,7 @@ static ptrs_ast_t *parseUnaryExtension(code_t *code, ptrs_ast_t *ast, bool ignor
 		member->codepos = code->pos;
 		member->code = code->src;
 		member->file = code->filename;
+		member->module = code->module;
 
 		consumec(code, '.');
 		char *name = readIdentifier(code);
@@ -1465,8 +1498,9 @@ static ptrs_ast_t *parseUnaryExtension(code_t *code, ptrs_ast_t *ast, bool ignor
 		call->codepos = code->pos;
 		call->code = code->src;
 		call->file = code->filename;
+		call->module = code->module;
 		call->arg.call.value = ast;
-		call->arg.call.arguments = parseExpressionList(code, ')');
+		call->arg.call.arguments = parseExpressionList(code, ')', true);
 
 		ast = call;
 		consumec(code, ')');
@@ -1480,6 +1514,7 @@ static ptrs_ast_t *parseUnaryExtension(code_t *code, ptrs_ast_t *ast, bool ignor
 		indexExpr->codepos = code->pos;
 		indexExpr->code = code->src;
 		indexExpr->file = code->filename;
+		indexExpr->module = code->module;
 
 		consumec(code, '[');
 
@@ -1513,6 +1548,7 @@ static ptrs_ast_t *parseUnaryExtension(code_t *code, ptrs_ast_t *ast, bool ignor
 			opAst->codepos = pos;
 			opAst->code = code->src;
 			opAst->file = code->filename;
+			opAst->module = code->module;
 			opAst->arg.astval = ast;
 			opAst->vtable = vtable;
 			return opAst;
@@ -1522,7 +1558,7 @@ static ptrs_ast_t *parseUnaryExtension(code_t *code, ptrs_ast_t *ast, bool ignor
 	return ast;
 }
 
-static struct ptrs_astlist *parseExpressionList(code_t *code, char end)
+static struct ptrs_astlist *parseExpressionList(code_t *code, char end, bool allowExpansion)
 {
 	if(code->curr == end || code->curr == 0)
 		return NULL;
@@ -1532,10 +1568,28 @@ static struct ptrs_astlist *parseExpressionList(code_t *code, char end)
 
 	for(;;)
 	{
+		int pos = code->pos;
 		if(lookahead(code, "_"))
 		{
 			curr->entry = NULL;
 		}
+		else if(allowExpansion && lookahead(code, "..."))
+		{
+			curr->entry = talloc(ptrs_ast_t);
+			curr->entry->vtable = &ptrs_ast_vtable_expand;
+			curr->entry->arg.astval = parseExpression(code, true);
+			curr->entry->codepos = pos;
+			curr->entry->code = code->src;
+			curr->entry->file = code->filename;
+			curr->entry->module = code->module;
+
+			if(curr->entry->arg.astval == NULL)
+				unexpected(code, "Expression");
+			if(code->curr != end)
+				unexpectedm(code, NULL, "An expanded array has to be the last argument");
+
+			break;
+		}
 		else
 		{
 			curr->entry = parseExpression(code, true);
@@ -1651,6 +1705,61 @@ static void parseArrayTyping(code_t *code, ptrs_nativetype_info_t *nativeType, p
 }
 
 
+static struct ptrs_ffideclaration *parseFfiReturnType(code_t *code)
+{
+	int start = code->pos;
+	ptrs_nativetype_info_t *retType = NULL;
+
+	// a declaration starts with a return type followed by the name, e.g. double pow(double, double)
+	if(!lookahead(code, "void") && (retType = readNativeType(code)) == NULL)
+		return NULL;
+
+	if(!isalpha(code->curr) && code->curr != '_')
+	{
+		code->pos = start;
+		code->curr = code->src[start];
+		return NULL;
+	}
+
+	if(retType != NULL && retType->varType == (uint8_t)-1)
+		unexpectedm(code, NULL, "Native functions cannot return a value of type var");
+
+	struct ptrs_ffideclaration *ffi = talloc(struct ptrs_ffideclaration);
+	ffi->retType = retType;
+	return ffi;
+}
+static void parseFfiParameters(code_t *code, struct ptrs_ffideclaration *ffi)
+{
+	ptrs_nativetype_info_t *types[32];
+	int argc = 0;
+
+	consumec(code, '(');
+	if(code->curr != ')' && !lookahead(code, "void"))
+	{
+		for(;;)
+		{
+			if(argc >= 32)
+				unexpectedm(code, NULL, "Native function declarations are limited to 32 parameters");
+
+			types[argc] = readNativeType(code);
+			if(types[argc] == NULL)
+				unexpected(code, "Native type name");
+			if(types[argc]->varType == (uint8_t)-1)
+				unexpectedm(code, NULL, "Native functions cannot take a parameter of type var");
+			argc++;
+
+			if(code->curr == ')')
+				break;
+			consumec(code, ',');
+		}
+	}
+	consumec(code, ')');
+
+	ffi->argc = argc;
+	ffi->argTypes = malloc(argc * sizeof(ptrs_nativetype_info_t *));
+	memcpy(ffi->argTypes, types, argc * sizeof(ptrs_nativetype_info_t *));
+}
+
 static void parseImport(code_t *code, ptrs_ast_t *stmt)
 {
 	stmt->vtable = &ptrs_ast_vtable_import;
@@ -1662,8 +1771,13 @@ static void parseImport(code_t *code, ptrs_ast_t *stmt)
 
 	for(;;)
 	{
+		struct ptrs_ffideclaration *ffi = parseFfiReturnType(code);
 		char *name = readIdentifier(code);
-		if(code->curr == '*')
+		if(ffi != NULL)
+		{
+			parseFfiParameters(code, ffi);
+		}
+		else if(code->curr == '*')
 		{
 			next(code);
 
@@ -1683,13 +1797,15 @@ static void parseImport(code_t *code, ptrs_ast_t *stmt)
 			nextPtr = &curr->next;
 
 			curr->name = name;
+			curr->ffi = ffi;
 			curr->next = NULL;
 
 			struct symbollist *symbol = addSpecialSymbol(code, NULL, PTRS_SYMBOL_IMPORTED);
 			symbol->arg.imported.import = stmt;
 			symbol->arg.imported.index = stmt->arg.import.count++;
+			symbol->arg.imported.ffi = ffi;
 
-			if(code->curr == ':')
+			if(code->curr == ':' && ffi == NULL)
 			{
 				next(code);
 
@@ -1884,7 +2000,7 @@ static ptrs_ast_t *parseNew(code_t *code, bool onStack)
 
 		if(lookahead(code, "["))
 		{
-			ast->arg.definearray.initVal = parseExpressionList(code, ']');
+			ast->arg.definearray.initVal = parseExpressionList(code, ']', false);
 			consumec(code, ']');
 		}
 	}
@@ -1895,8 +2011,20 @@ static ptrs_ast_t *parseNew(code_t *code, bool onStack)
 		ast->arg.newexpr.onStack = onStack;
 		ast->arg.newexpr.value = parseUnaryExpr(code, true);
 
+		// new Struct[n] creates an array of n instances stored next to each other
+		ptrs_ast_t *value = ast->arg.newexpr.value;
+		if(value->vtable == &ptrs_ast_vtable_index && code->curr != '(')
+		{
+			ast->vtable = &ptrs_ast_vtable_structarray;
+			ast->arg.structarray.onStack = onStack;
+			ast->arg.structarray.constructor = value->arg.binary.left;
+			ast->arg.structarray.length = value->arg.binary.right;
+			ast->arg.structarray.soa = lookahead(code, "soa");
+			return ast;
+		}
+
 		consumec(code, '(');
-		ast->arg.newexpr.arguments = parseExpressionList(code, ')');
+		ast->arg.newexpr.arguments = parseExpressionList(code, ')', true);
 		consumec(code, ')');
 	}
 
@@ -1944,6 +2072,9 @@ static void createStructHashmap(code_t *code, ptrs_struct_t *struc, struct ptrs_
 		}
 
 		memcpy(&member[i], &curr->member, sizeof(struct ptrs_structmember));
+		member[i].typePredicted = false;
+		member[i].metaPredicted = false;
+		member[i].accessCount = 0;
 		curr = curr->next;
 	}
 
@@ -1951,7 +2082,160 @@ static void createStructHashmap(code_t *code, ptrs_struct_t *struc, struct ptrs_
 	struc->memberCount = count;
 }
 
-static void parseMap(code_t *code, ptrs_ast_t *ast)
+static bool isInstanceData(struct ptrs_structmember *member)
+{
+	return !member->isStatic && (member->type == PTRS_STRUCTMEMBER_VAR
+		|| member->type == PTRS_STRUCTMEMBER_TYPED || member->type == PTRS_STRUCTMEMBER_ARRAY);
+}
+static size_t getMemberAlignment(struct ptrs_structmember *member)
+{
+	size_t size;
+	if(member->type == PTRS_STRUCTMEMBER_VAR)
+		size = sizeof(ptrs_val_t);
+	else if(member->type == PTRS_STRUCTMEMBER_TYPED)
+		size = member->value.type->size;
+	else
+		size = ptrs_nativeTypes[member->value.array.array.typeIndex].size;
+
+	return size < 8 ? size : 8;
+}
+static size_t getMemberSize(struct ptrs_structmember *member)
+{
+	if(member->type == PTRS_STRUCTMEMBER_VAR)
+		return sizeof(ptrs_var_t);
+	else if(member->type == PTRS_STRUCTMEMBER_TYPED)
+		return member->value.type->size;
+	else
+		return ptrs_nativeTypes[member->value.array.array.typeIndex].size * member->value.array.array.size;
+}
+
+struct ptrs_compactmember
+{
+	struct ptrs_structmember *member;
+	bool isHot;
+	size_t alignment;
+};
+// compact structs place members that were accessed often in a --struct-profile run first,
+// the members of both groups are ordered by alignment so typed members are packed without padding
+static void layoutCompactStruct(ptrs_struct_t *struc, struct ptrs_structParseList *list, int count)
+{
+	if(count == 0)
+		return;
+
+	struct ptrs_compactmember members[count];
+
+	int n = 0;
+	int64_t maxCount = 0;
+	int64_t counts[count];
+	for(struct ptrs_structParseList *curr = list; curr != NULL; curr = curr->next)
+	{
+		if(!isInstanceData(&curr->member))
+			continue;
+
+		counts[n] = ptrs_struct_getProfiledCount(struc->name, curr->member.name);
+		if(counts[n] > maxCount)
+			maxCount = counts[n];
+
+		members[n].member = &curr->member;
+		members[n].alignment = getMemberAlignment(&curr->member);
+		n++;
+	}
+
+	// without a profile all members are considered hot
+	for(int i = 0; i < n; i++)
+		members[i].isHot = counts[i] == -1 || counts[i] * 16 >= maxCount;
+
+	// insertion sort, it is stable and structs have at most 96 members
+	for(int i = 1; i < n; i++)
+	{
+		for(int j = i; j > 0; j--)
+		{
+			bool swap;
+			if(members[j].isHot != members[j - 1].isHot)
+				swap = members[j].isHot;
+			else
+				swap = members[j].alignment > members[j - 1].alignment;
+
+			if(!swap)
+				break;
+
+			struct ptrs_compactmember tmp = members[j];
+			members[j] = members[j - 1];
+			members[j - 1] = tmp;
+		}
+	}
+
+	size_t offset = 0;
+	for(int i = 0; i < n; i++)
+	{
+		size_t alignment = members[i].alignment;
+		offset = (offset + alignment - 1) & ~(alignment - 1);
+		members[i].member->offset = offset;
+		offset += getMemberSize(members[i].member);
+	}
+
+	struc->size = (offset + 7) & ~7;
+}
+
+static ptrs_ast_t *parseMap(code_t *code)
+{
+	ptrs_ast_t *ast = talloc(ptrs_ast_t);
+	ast->vtable = &ptrs_ast_vtable_map;
+
+	struct ptrs_ast_map *expr = &ast->arg.map;
+	struct ptrs_astlist **nextKey = &expr->keys;
+	struct ptrs_astlist **nextValue = &expr->values;
+	expr->count = 0;
+
+	consumec(code, '{');
+	while(code->curr != '}')
+	{
+		ptrs_ast_t *key;
+		if(isalpha(code->curr) || code->curr == '_')
+		{
+			// identifiers are used as string keys
+			key = talloc(ptrs_ast_t);
+			key->vtable = &ptrs_ast_vtable_constant;
+			key->codepos = code->pos;
+			key->code = code->src;
+			key->file = code->filename;
+			key->module = code->module;
+
+			char *name = readIdentifier(code);
+			key->arg.constval.meta.type = PTRS_TYPE_POINTER;
+			key->arg.constval.meta.array.typeIndex = PTRS_NATIVETYPE_INDEX_CHAR;
+			key->arg.constval.meta.array.size = strlen(name) + 1;
+			key->arg.constval.value.ptrval = name;
+		}
+		else
+		{
+			key = parseUnaryExpr(code, false);
+		}
+
+		consumec(code, ':');
+
+		*nextKey = talloc(struct ptrs_astlist);
+		(*nextKey)->entry = key;
+		nextKey = &(*nextKey)->next;
+
+		*nextValue = talloc(struct ptrs_astlist);
+		(*nextValue)->entry = parseExpression(code, true);
+		nextValue = &(*nextValue)->next;
+
+		expr->count++;
+
+		if(code->curr == '}')
+			break;
+		consumec(code, ',');
+	}
+	consumec(code, '}');
+
+	*nextKey = NULL;
+	*nextValue = NULL;
+	return ast;
+}
+
+static void parseMapStruct(code_t *code, ptrs_ast_t *ast)
 {
 	ptrs_ast_t *structExpr = talloc(ptrs_ast_t);
 	ptrs_struct_t *struc = &structExpr->arg.structval;
@@ -1966,6 +2250,12 @@ static void parseMap(code_t *code, ptrs_ast_t *ast)
 	struc->size = 0;
 	struc->name = "(map)";
 	struc->overloads = NULL;
+	struc->slabId = 0;
+	struc->module = code->module;
+	struc->firstCodepos = code->pos;
+	memset(struc->overloadTable, 0, sizeof(struc->overloadTable));
+	memset(struc->foreachPlan, 0, sizeof(struc->foreachPlan));
+	struc->initTemplate = NULL;
 	struc->staticData = NULL;
 
 	consumec(code, '{');
@@ -2112,7 +2402,14 @@ static void parseStruct(code_t *code, ptrs_struct_t *struc)
 
 	struc->name = structName;
 	struc->overloads = NULL;
+	struc->slabId = 0;
+	struc->module = code->module;
+	memset(struc->overloadTable, 0, sizeof(struc->overloadTable));
+	memset(struc->foreachPlan, 0, sizeof(struc->foreachPlan));
+	struc->initTemplate = NULL;
 	struc->size = 0;
+
+	bool isCompact = lookahead(code, "compact");
 	consumec(code, '{');
 
 	symbolScope_increase(code, false);
@@ -2166,7 +2463,7 @@ static void parseStruct(code_t *code, ptrs_struct_t *struc)
 						parseOptionalTyping(code, &func->retType);
 
 						nameFormat = "%1$s.op &this[%3$s]";
-						overload->op = ptrs_ast_vtable_member.addressof;
+						overload->op = PTRS_STRUCTOP_ADDRESSOF_MEMBER;
 					}
 					else if(lookahead(code, "="))
 					{
@@ -2178,7 +2475,7 @@ static void parseStruct(code_t *code, ptrs_struct_t *struc)
 						func->retType.meta.type = -1;
 
 						nameFormat = "%1$s.op this[%3$s] = %2$s";
-						overload->op = ptrs_ast_vtable_member.set;
+						overload->op = PTRS_STRUCTOP_ASSIGN_MEMBER;
 					}
 					else if(code->curr == '(')
 					{
@@ -2197,7 +2494,7 @@ static void parseStruct(code_t *code, ptrs_struct_t *struc)
 						addSymbol(code, strdup(otherName), &nameArg->arg);
 
 						nameFormat = "%1$s.op this[%3$s]()";
-						overload->op = ptrs_ast_vtable_member.call;
+						overload->op = PTRS_STRUCTOP_CALL_MEMBER;
 					}
 					else
 					{
@@ -2205,14 +2502,14 @@ static void parseStruct(code_t *code, ptrs_struct_t *struc)
 						parseOptionalTyping(code, &func->retType);
 
 						nameFormat = "%1$s.op this[%3$s]";
-						overload->op = ptrs_ast_vtable_member.get;
+						overload->op = PTRS_STRUCTOP_MEMBER;
 					}
 				}
 				else if(curr == '(')
 				{
 					func->args = parseArgumentDefinitionList(code, &func->vararg, &func->retType);
 					parseOptionalTyping(code, &func->retType);
-					overload->op = ptrs_ast_vtable_call.get;
+					overload->op = PTRS_STRUCTOP_CALL;
 
 					nameFormat = "%1$s.op this()";
 				}
@@ -2226,7 +2523,7 @@ static void parseStruct(code_t *code, ptrs_struct_t *struc)
 				consume(code, "this");
 
 				nameFormat = "%1$s.op sizeof this";
-				overload->op = ptrs_ast_vtable_prefix_sizeof.get;
+				overload->op = PTRS_STRUCTOP_SIZEOF;
 
 				func->args = NULL;
 				func->retType.meta.type = PTRS_TYPE_INT;
@@ -2243,7 +2540,7 @@ static void parseStruct(code_t *code, ptrs_struct_t *struc)
 				consume(code, "this");
 
 				nameFormat = "%1$s.op foreach(%2$s, %3$s) in this";
-				overload->op = ptrs_ast_vtable_forin_step.get;
+				overload->op = PTRS_STRUCTOP_FOREACH;
 
 				func->args = createParameterList(code, 2,
 					opLabel, PTRS_TYPE_POINTER, PTRS_NATIVETYPE_INDEX_VAR, 1,
@@ -2259,7 +2556,7 @@ static void parseStruct(code_t *code, ptrs_struct_t *struc)
 				{
 					otherName = NULL;
 					nameFormat = "%1$s.op cast<string>this";
-					overload->op = ptrs_ast_vtable_tostring.get;
+					overload->op = PTRS_STRUCTOP_TOSTRING;
 
 					func->args = NULL;
 					func->retType.meta.type = PTRS_TYPE_POINTER;
@@ -2270,7 +2567,7 @@ static void parseStruct(code_t *code, ptrs_struct_t *struc)
 				{
 					otherName = readIdentifier(code);
 					nameFormat = "%1$s.op cast<%3$s>this";
-					overload->op = ptrs_ast_vtable_cast_builtin.get;
+					overload->op = PTRS_STRUCTOP_CAST;
 
 					func->args = createParameterList(code, 1, otherName, PTRS_TYPE_INT);
 					// TODO add seprate overloads for cast<int> and cast<float>?
@@ -2287,14 +2584,14 @@ static void parseStruct(code_t *code, ptrs_struct_t *struc)
 				{
 					consume(code, "this");
 					nameFormat = "%1$s.op %3$s in this";
-					overload->op = ptrs_ast_vtable_op_in.get;
+					overload->op = PTRS_STRUCTOP_IN;
 
 					func->args = createParameterList(code, 1, otherName, PTRS_TYPE_POINTER, PTRS_NATIVETYPE_INDEX_CHAR, 0);
 					func->retType.meta.type = PTRS_TYPE_INT;
 				}
 			}
 
-			if(overload->op == NULL)
+			if(overload->op == PTRS_STRUCTOP_NONE)
 				unexpected(code, "Operator");
 
 			func->name = malloc(snprintf(NULL, 0, nameFormat, structName, opLabel, otherName) + 1);
@@ -2314,7 +2611,7 @@ static void parseStruct(code_t *code, ptrs_struct_t *struc)
 			sprintf(name, "%s.constructor", structName);
 
 			struct ptrs_opoverload *overload = talloc(struct ptrs_opoverload);
-			overload->op = ptrs_ast_vtable_new.get;
+			overload->op = PTRS_STRUCTOP_NEW;
 			overload->handler = parseFunction(code, name);
 			overload->isStatic = isStatic;
 
@@ -2328,7 +2625,7 @@ static void parseStruct(code_t *code, ptrs_struct_t *struc)
 			sprintf(name, "%s.destructor", structName);
 
 			struct ptrs_opoverload *overload = talloc(struct ptrs_opoverload);
-			overload->op = ptrs_ast_vtable_delete.get;
+			overload->op = PTRS_STRUCTOP_DELETE;
 			overload->handler = parseFunction(code, name);
 			overload->isStatic = isStatic;
 
@@ -2510,8 +2807,13 @@ static void parseStruct(code_t *code, ptrs_struct_t *struc)
 
 	if(memberCount != 0)
 		currList->next = NULL;
+	if(isCompact)
+		layoutCompactStruct(struc, start, memberCount);
 	createStructHashmap(code, struc, start, memberCount);
 
+	if(ptrs_structProfile)
+		ptrs_struct_addToProfile(struc);
+
 	symbolScope_decrease(code);
 	consumec(code, '}');
 	consumec(code, ';');
@@ -2526,6 +2828,7 @@ const char * const typeNames[] = {
 	[PTRS_TYPE_POINTER] = "pointer",
 	[PTRS_TYPE_STRUCT] = "struct",
 	[PTRS_TYPE_FUNCTION] = "function",
+	[PTRS_TYPE_MAP] = "map",
 };
 static int typeNameCount = sizeof(typeNames) / sizeof(const char *);
 
@@ -2546,6 +2849,10 @@ static ptrs_nativetype_info_t *readNativeType(code_t *code)
 {
 	for(int i = 0; i < ptrs_nativeTypeCount; i++)
 	{
+		// arrays of structs are created using `new Struct[n]`
+		if(i == PTRS_NATIVETYPE_INDEX_STRUCT)
+			continue;
+
 		if(lookahead(code, ptrs_nativeTypes[i].name))
 			return &ptrs_nativeTypes[i];
 	}
@@ -2869,6 +3176,7 @@ static ptrs_ast_t *getSymbol(code_t *code, char *text)
 	if(ptrs_ast_getSymbol(code->symbols, text, &ast) == 0)
 	{
 		ast->file = code->filename;
+		ast->module = code->module;
 		ast->codepos = code->pos;
 		return ast;
 	}
@@ -3093,6 +3401,7 @@ static void unexpectedm(code_t *code, const char *expected, const char *msg)
 	node.codepos = code->pos;
 	node.code = code->src;
 	node.file = code->filename;
+	node.module = code->module;
 
 	char actual[16] = {0};
 	char *curr = &code->src[code->pos];
@@ -27,6 +27,7 @@ struct ptrs_ast_definearray
 {
 	ptrs_jit_var_t location;
 	bool onStack;
+	bool noEscape; // set by flow analysis, the array can live in the functions frame
 	ptrs_meta_t meta;
 	struct ptrs_ast *length;
 	struct ptrs_astlist *initVal;
@@ -40,6 +41,7 @@ struct ptrs_ast_identifier
 	uint8_t typePredicted : 1;
 	uint8_t valuePredicted : 1;
 	uint8_t metaPredicted : 1;
+	uint8_t arrayPredicted : 1; // metaPrediction is an array of structs of unknown size
 };
 
 struct ptrs_ast_member
@@ -63,9 +65,18 @@ struct ptrs_ast_import
 	const char *from;
 };
 
+struct ptrs_ffideclaration
+{
+	ptrs_nativetype_info_t *retType; // NULL for void
+	ptrs_nativetype_info_t **argTypes;
+	int argc;
+	jit_type_t signature; // created when the import statement is compiled
+};
+
 struct ptrs_ast_importedsymbol
 {
 	ptrs_nativetype_info_t *type; //optional
+	struct ptrs_ffideclaration *ffi; //optional
 	struct ptrs_ast *import;
 	int index;
 };
@@ -133,10 +144,32 @@ struct ptrs_ast_call
 struct ptrs_ast_new
 {
 	bool onStack;
+	bool noEscape; // set by flow analysis, the instance can live in the functions frame
 	struct ptrs_ast *value;
 	struct ptrs_astlist *arguments;
 };
 
+struct ptrs_ast_structarray
+{
+	bool onStack;
+	bool soa; // store each member in its own column instead of storing the instances
+	struct ptrs_ast *constructor;
+	struct ptrs_ast *length;
+};
+
+struct ptrs_ast_map
+{
+	struct ptrs_astlist *keys;
+	struct ptrs_astlist *values;
+	uint32_t count;
+};
+
+struct ptrs_ast_delete
+{
+	struct ptrs_ast *value;
+	bool noFree; // set by flow analysis when value was allocated in the frame
+};
+
 struct ptrs_ast_case
 {
 	int64_t min;
@@ -218,6 +251,9 @@ union ptrs_ast_arg
 	struct ptrs_ast_slice slice;
 	struct ptrs_ast_call call;
 	struct ptrs_ast_new newexpr;
+	struct ptrs_ast_structarray structarray;
+	struct ptrs_ast_map map;
+	struct ptrs_ast_delete deletestmt;
 	struct ptrs_ast_ifelse ifelse;
 	struct ptrs_ast_switch switchcase;
 	struct ptrs_ast_for forstatement;
@@ -246,6 +282,7 @@ struct ptrs_ast
 	size_t codepos;
 	char *code;
 	const char *file;
+	uint32_t module;
 };
 typedef struct ptrs_ast ptrs_ast_t;
 
@@ -265,6 +302,7 @@ struct ptrs_stringformat
 struct ptrs_importlist
 {
 	char *name;
+	struct ptrs_ffideclaration *ffi; //optional
 	union
 	{
 		ptrs_jit_var_t location;
@@ -32,7 +32,7 @@ typedef struct
 		struct
 		{
 			uint8_t typeIndex;
-			uint16_t padding;
+			uint16_t structId; // only used by arrays of struct instances
 			uint32_t size;
 		} __attribute__((packed)) array;
 		uint8_t pointer[7]; //actually 8, use the ptrs_meta_getPointer macro below
@@ -46,6 +46,7 @@ typedef struct
 		struct
 		{
 			uint32_t size;
+			uint16_t structId;
 			uint8_t typeIndex;
 		} __attribute__((packed)) array;
 		uint8_t pointer[7]; //actually 8, use the ptrs_meta_getPointer macro below
@@ -76,6 +77,7 @@ typedef enum
 	PTRS_TYPE_POINTER,
 	PTRS_TYPE_STRUCT,
 	PTRS_TYPE_FUNCTION,
+	PTRS_TYPE_MAP,
 
 	PTRS_NUM_TYPES
 } ptrs_vartype_t;
@@ -127,6 +129,7 @@ extern const int ptrs_nativeTypeCount;
 #define PTRS_NATIVETYPE_INDEX_U8 ((size_t)14)
 #define PTRS_NATIVETYPE_INDEX_CFUNC ((size_t)22)
 #define PTRS_NATIVETYPE_INDEX_VAR ((size_t)30)
+#define PTRS_NATIVETYPE_INDEX_STRUCT ((size_t)31)
 
 typedef struct
 {
@@ -142,6 +145,11 @@ typedef enum
 	PTRS_JIT_FUNCTIONMETA_CALLBACK,
 	PTRS_JIT_FUNCTIONMETA_CLOSURE,
 	PTRS_JIT_FUNCTIONMETA_UNCHECKED,
+	PTRS_JIT_FUNCTIONMETA_INVOKER,
+	PTRS_JIT_FUNCTIONMETA_TRAMPOLINES,
+	PTRS_JIT_FUNCTIONMETA_FRAMEREFERENCED,
+	PTRS_JIT_FUNCTIONMETA_HOISTED,
+	PTRS_JIT_FUNCTIONMETA_VARIADICCLOSURES,
 } ptrs_jit_functionmeta_t;
 typedef struct ptrs_funcparameter
 {
@@ -149,17 +157,26 @@ typedef struct ptrs_funcparameter
 	ptrs_jit_var_t arg;
 	ptrs_typing_t typing;
 	struct ptrs_ast *argv;
+	bool neverAssigned; // set by flow analysis
 	struct ptrs_funcparameter *next;
 } ptrs_funcparameter_t;
+struct ptrs_specialization;
 typedef struct
 {
 	char *name;
 	ptrs_jit_var_t thisVal;
 	bool usesTryCatch;
+	bool canSpecialize; // set by flow analysis, the body can be compiled more than once
+	bool retTypeInferred; // set by flow analysis, retType was not declared
+	bool isBuilt;
+	bool inlining; // the body is currently compiled into an accessing function, see struct.c
+	struct ptrs_struct *thisType;
+	struct ptrs_specialization *specializations;
 	ptrs_jit_var_t *vararg;
 	ptrs_funcparameter_t *args;
 	ptrs_typing_t retType;
 	struct ptrs_ast *body;
+	jit_label_t selfCallLabel; // placed after the parameters were retrieved, used for self recursion
 } ptrs_function_t;
 
 enum ptrs_structmembertype
@@ -178,6 +195,10 @@ struct ptrs_structmember
 	uint16_t namelen;
 	uint8_t protection : 2; //0 = public, 1 = internal, 2 = private
 	uint8_t isStatic : 1;
+	uint8_t typePredicted : 1; // set by flow analysis for VAR members
+	uint8_t metaPredicted : 1;
+	ptrs_meta_t metaPrediction;
+	uint64_t accessCount; // only counted with --struct-profile
 	enum ptrs_structmembertype type;
 	union
 	{
@@ -191,12 +212,30 @@ struct ptrs_structmember
 		ptrs_nativetype_info_t *type;
 	} value;
 };
+enum ptrs_structop
+{
+	PTRS_STRUCTOP_NONE,
+	PTRS_STRUCTOP_MEMBER,
+	PTRS_STRUCTOP_ASSIGN_MEMBER,
+	PTRS_STRUCTOP_ADDRESSOF_MEMBER,
+	PTRS_STRUCTOP_CALL_MEMBER,
+	PTRS_STRUCTOP_CALL,
+	PTRS_STRUCTOP_SIZEOF,
+	PTRS_STRUCTOP_FOREACH,
+	PTRS_STRUCTOP_TOSTRING,
+	PTRS_STRUCTOP_CAST,
+	PTRS_STRUCTOP_IN,
+	PTRS_STRUCTOP_NEW,
+	PTRS_STRUCTOP_DELETE,
+	PTRS_STRUCTOP_COUNT
+};
 struct ptrs_opoverload
 {
 	uint8_t isStatic : 1;
-	void *op;
+	enum ptrs_structop op;
 	ptrs_function_t *handler;
 	jit_function_t handlerFunc;
+	void *handlerClosure; // set by ptrs_handle_struct
 	struct ptrs_opoverload *next;
 };
 typedef struct ptrs_struct
@@ -206,10 +245,19 @@ typedef struct ptrs_struct
 	ptrs_jit_var_t *location;
 	struct ptrs_structmember *member;
 	struct ptrs_opoverload *overloads;
+	// the overload used for each operator, [op][0] only holds static overloads
+	struct ptrs_opoverload *overloadTable[PTRS_STRUCTOP_COUNT][2];
+	// the members visited by foreach, [0] only holds static members
+	struct ptrs_structmember **foreachPlan[2];
+	uint16_t foreachPlanSize[2];
 	uint32_t size;
+	uint32_t slabId; // assigned when the first instance is allocated, see slab.c
 	uint16_t memberCount;
+	uint32_t module; // private and internal members are accessible from the same module only
+	size_t firstCodepos; // private members are accessible from within this range only
 	size_t lastCodepos;
 	void *staticData;
+	void *initTemplate; // constant initializers of instance members, see ptrs_handle_struct
 	void *parentFrame;
 } ptrs_struct_t;
 
@@ -43,6 +43,9 @@ ptrs_nativetype_info_t ptrs_nativeTypes[] = {
 	define_nativetype("uintptr",   intptr_t,           PTRS_TYPE_INT, UInt),
 	define_nativetype("ptrdiff",   ptrdiff_t,          PTRS_TYPE_INT, Int),
 	define_nativetype("var",       ptrs_var_t,         (uint8_t)-1, Var),
+
+	// arrays of struct instances, the element size is taken from the struct, see structarray.c
+	{0, "struct", NULL, PTRS_TYPE_STRUCT, ptrs_handle_native_getStruct, ptrs_handle_native_setStruct},
 };
 
 const int ptrs_nativeTypeCount = sizeof(ptrs_nativeTypes) / sizeof(ptrs_nativetype_info_t);
@@ -88,6 +91,7 @@ void ptrs_initialize_nativeTypes()
 		jit_type_nint, //ptrdiff
 
 		ptrs_jit_getVarType(), //var
+		jit_type_void, //struct
 	};
 
 	// sanity checks
@@ -95,6 +99,7 @@ void ptrs_initialize_nativeTypes()
 	assert(sizeof(ptrs_nativeTypes) / sizeof(ptrs_nativetype_info_t) == ptrs_nativeTypeCount);
 	assert(strcmp(ptrs_nativeTypes[PTRS_NATIVETYPE_INDEX_CHAR].name, "char") == 0);
 	assert(strcmp(ptrs_nativeTypes[PTRS_NATIVETYPE_INDEX_VAR].name, "var") == 0);
+	assert(strcmp(ptrs_nativeTypes[PTRS_NATIVETYPE_INDEX_STRUCT].name, "struct") == 0);
 
 	for(int i = 0; i < ptrs_nativeTypeCount; i++)
 		ptrs_nativeTypes[i].jitType = types[i];